@@ -0,0 +1,372 @@
+#include <canbus/AsyncReceiver.hpp>
+#include <base-logging/Logging.hpp>
+#include <iodrivers_base/Driver.hpp>
+#include <iodrivers_base/Timeout.hpp>
+
+#include <pthread.h>
+#include <sched.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+using namespace canbus;
+using iodrivers_base::Timeout;
+using iodrivers_base::TimeoutError;
+using iodrivers_base::UnixError;
+
+AsyncReceiver::AsyncReceiver(Driver* driver, size_t queue_size,
+        RingBuffer<Message>::OVERFLOW_POLICY policy)
+    : m_driver(driver)
+    , m_queue(queue_size, policy)
+    , m_read_timeout(DEFAULT_TIMEOUT)
+    , m_cpu(-1)
+    , m_priority(0)
+    , m_stop(false)
+    , m_bus_ok(true)
+    , m_error_count(0)
+{
+    m_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_stop_fd == -1)
+        throw UnixError("AsyncReceiver: cannot create eventfd");
+    m_notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_notify_fd == -1) {
+        ::close(m_stop_fd);
+        throw UnixError("AsyncReceiver: cannot create eventfd");
+    }
+}
+
+AsyncReceiver::~AsyncReceiver()
+{
+    stop();
+    ::close(m_stop_fd);
+    ::close(m_notify_fd);
+}
+
+Driver& AsyncReceiver::getDriver()
+{
+    return *m_driver;
+}
+
+void AsyncReceiver::setCPUAffinity(int cpu)
+{
+    m_cpu = cpu;
+}
+
+void AsyncReceiver::setRealtimePriority(int priority)
+{
+    m_priority = priority;
+}
+
+bool AsyncReceiver::start()
+{
+    if (isRunning())
+        return true;
+
+    uint64_t value;
+    if (::read(m_stop_fd, &value, sizeof(value)) == -1 && errno != EAGAIN)
+        throw UnixError("AsyncReceiver: cannot reset eventfd");
+    m_stop.store(false);
+
+    // The RX thread applies the CPU affinity and priority before it
+    // touches the driver, and reports whether it could
+    std::promise<bool> started;
+    std::future<bool> result = started.get_future();
+    m_thread = std::thread(&AsyncReceiver::run, this, std::move(started));
+    if (!result.get()) {
+        m_thread.join();
+        return false;
+    }
+    return true;
+}
+
+bool AsyncReceiver::applySchedulingParameters()
+{
+    pthread_t handle = pthread_self();
+    if (m_cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(m_cpu, &cpus);
+        int ret = pthread_setaffinity_np(handle, sizeof(cpus), &cpus);
+        if (ret != 0) {
+            LOG_WARN("AsyncReceiver: cannot pin RX thread to CPU %i: %s", m_cpu, strerror(ret));
+            return false;
+        }
+    }
+    if (m_priority > 0) {
+        struct sched_param param;
+        param.sched_priority = m_priority;
+        int ret = pthread_setschedparam(handle, SCHED_FIFO, &param);
+        if (ret != 0) {
+            LOG_WARN("AsyncReceiver: cannot set SCHED_FIFO priority %i: %s", m_priority, strerror(ret));
+            return false;
+        }
+    }
+    return true;
+}
+
+void AsyncReceiver::stop()
+{
+    if (!isRunning())
+        return;
+
+    m_stop.store(true);
+    uint64_t value = 1;
+    if (::write(m_stop_fd, &value, sizeof(value)) == -1)
+        throw UnixError("AsyncReceiver: cannot signal eventfd");
+    m_thread.join();
+}
+
+bool AsyncReceiver::isRunning() const
+{
+    return m_thread.joinable();
+}
+
+uint64_t AsyncReceiver::getDroppedCount() const
+{
+    return m_queue.getDroppedCount();
+}
+
+void AsyncReceiver::run(std::promise<bool> started)
+{
+    bool ok = applySchedulingParameters();
+    started.set_value(ok);
+    if (!ok)
+        return;
+
+    {
+        // The writers wait for the blocking read() of the drivers that have
+        // no file descriptor, keep it short
+        std::lock_guard<std::mutex> lock(m_driver_lock);
+        if (m_driver->getFileDescriptor() == iodrivers_base::Driver::INVALID_FD)
+            m_driver->setReadTimeout(LOCKED_READ_TIMEOUT);
+    }
+
+    while (!m_stop.load())
+    {
+        try {
+            bool received;
+            {
+                std::lock_guard<std::mutex> lock(m_driver_lock);
+                received = drain();
+                m_bus_ok.store(m_driver->checkBusOk());
+                m_error_count.store(m_driver->getErrorCount());
+            }
+            if (received)
+                notify();
+            waitForInput();
+        }
+        catch(std::exception const& e) {
+            LOG_WARN("AsyncReceiver: %s", e.what());
+            // Do not spin if the device keeps failing
+            struct pollfd pfd;
+            pfd.fd = m_stop_fd;
+            pfd.events = POLLIN;
+            poll(&pfd, 1, POLL_PERIOD);
+        }
+    }
+}
+
+bool AsyncReceiver::drain()
+{
+    bool received = false;
+    while (m_driver->getPendingMessagesCount() > 0)
+    {
+        push(m_driver->read());
+        received = true;
+    }
+    return received;
+}
+
+void AsyncReceiver::push(Message msg)
+{
+    if (msg.time.isNull())
+        msg.time = base::Time::now();
+    m_queue.push(msg);
+}
+
+void AsyncReceiver::waitForInput()
+{
+    int fd = m_driver->getFileDescriptor();
+    if (fd == iodrivers_base::Driver::INVALID_FD) {
+        // Nothing to wait on, let the driver block within its read timeout
+        try {
+            {
+                std::lock_guard<std::mutex> lock(m_driver_lock);
+                push(m_driver->read());
+            }
+            notify();
+        }
+        catch(TimeoutError&) {}
+        return;
+    }
+
+    struct pollfd pfd[2];
+    pfd[0].fd = fd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = m_stop_fd;
+    pfd[1].events = POLLIN;
+    if (poll(pfd, 2, POLL_PERIOD) == -1 && errno != EINTR)
+        throw UnixError("AsyncReceiver: error in poll()");
+}
+
+void AsyncReceiver::notify()
+{
+    uint64_t value = 1;
+    if (::write(m_notify_fd, &value, sizeof(value)) == -1 && errno != EAGAIN)
+        throw UnixError("AsyncReceiver: cannot signal eventfd");
+}
+
+void AsyncReceiver::clearNotification()
+{
+    uint64_t value;
+    if (::read(m_notify_fd, &value, sizeof(value)) == -1 && errno != EAGAIN)
+        throw UnixError("AsyncReceiver: cannot reset eventfd");
+    // The RX thread may have queued messages between the time the consumer
+    // emptied the queue and the reset, make sure they are not missed
+    if (!m_queue.empty())
+        notify();
+}
+
+bool AsyncReceiver::open(std::string const& path)
+{
+    stop();
+    if (!m_driver->open(path))
+        return false;
+    return start();
+}
+
+bool AsyncReceiver::resetBoard()
+{
+    bool running = isRunning();
+    stop();
+    bool result = m_driver->resetBoard();
+    if (running)
+        start();
+    return result;
+}
+
+bool AsyncReceiver::reset()
+{
+    bool running = isRunning();
+    stop();
+    bool result = m_driver->reset();
+    m_queue.clear();
+    clearNotification();
+    if (running)
+        start();
+    return result;
+}
+
+void AsyncReceiver::setWriteTimeout(uint32_t timeout)
+{
+    m_driver->setWriteTimeout(timeout);
+}
+
+uint32_t AsyncReceiver::getWriteTimeout() const
+{
+    return m_driver->getWriteTimeout();
+}
+
+void AsyncReceiver::setReadTimeout(uint32_t timeout)
+{
+    m_read_timeout = timeout;
+}
+
+uint32_t AsyncReceiver::getReadTimeout() const
+{
+    return m_read_timeout;
+}
+
+Message AsyncReceiver::read()
+{
+    Message msg;
+    if (!read(msg))
+        throw TimeoutError(TimeoutError::PACKET, "read(): timeout");
+    return msg;
+}
+
+bool AsyncReceiver::read(Message& msg)
+{
+    Timeout timeout(m_read_timeout);
+    while (!m_queue.pop(msg))
+    {
+        if (timeout.elapsed())
+            return false;
+
+        struct pollfd pfd;
+        pfd.fd = m_notify_fd;
+        pfd.events = POLLIN;
+        int ret = poll(&pfd, 1, timeout.timeLeft());
+        if (ret == -1 && errno != EINTR)
+            throw UnixError("read(): error in poll()");
+        else if (ret == 0)
+            return false;
+        clearNotification();
+    }
+
+    if (m_queue.empty())
+        clearNotification();
+    return true;
+}
+
+void AsyncReceiver::write(Message const& msg)
+{
+    std::lock_guard<std::mutex> lock(m_driver_lock);
+    m_driver->write(msg);
+}
+
+size_t AsyncReceiver::writeBatch(Message const* msgs, size_t count)
+{
+    std::lock_guard<std::mutex> lock(m_driver_lock);
+    return m_driver->writeBatch(msgs, count);
+}
+
+int AsyncReceiver::getPendingMessagesCount()
+{
+    return m_queue.size();
+}
+
+bool AsyncReceiver::checkBusOk()
+{
+    return m_bus_ok.load();
+}
+
+void AsyncReceiver::clear()
+{
+    m_queue.clear();
+    clearNotification();
+}
+
+int AsyncReceiver::getFileDescriptor() const
+{
+    return m_notify_fd;
+}
+
+bool AsyncReceiver::isValid() const
+{
+    return m_driver->isValid();
+}
+
+void AsyncReceiver::close()
+{
+    stop();
+    m_driver->close();
+}
+
+uint32_t AsyncReceiver::getErrorCount() const
+{
+    return m_error_count.load();
+}
+
+bool AsyncReceiver::setFilters(std::vector<Filter> const& filters)
+{
+    bool running = isRunning();
+    stop();
+    Driver::setFilters(filters);
+    bool result = m_driver->setFilters(filters);
+    if (running)
+        start();
+    return result;
+}
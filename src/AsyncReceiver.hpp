@@ -0,0 +1,179 @@
+#ifndef CANBUS_ASYNC_RECEIVER_HH
+#define CANBUS_ASYNC_RECEIVER_HH
+
+#include <canbus/Driver.hpp>
+#include <canbus/RingBuffer.hpp>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace canbus
+{
+    /** Receives the frames of another driver in a background thread
+     *
+     * The wrapped driver is drained by a dedicated RX thread as soon as its
+     * file descriptor becomes readable, so that frames keep being pulled
+     * out of the kernel or board buffers even when the consumer stalls. The
+     * frames are handed over to the consumer through a lock-free queue.
+     *
+     * The RX thread can be pinned to a CPU and run with SCHED_FIFO
+     * priority. Both must be configured before start().
+     *
+     * write() and writeBatch() are forwarded to the wrapped driver from the
+     * caller's thread. They are serialized with the RX thread's accesses to
+     * the driver, since drivers may share state between their read and
+     * write paths (e.g. DriverNetGateway flushes its TX buffer from read()).
+     * A write therefore waits for the RX thread to finish draining the
+     * driver, or, for drivers without a file descriptor, for its blocking
+     * read() to return (see LOCKED_READ_TIMEOUT).
+     */
+    class AsyncReceiver : public Driver
+    {
+    public:
+        /** How long the RX thread blocks at most before checking whether it
+         * should stop, in milliseconds
+         */
+        static const int POLL_PERIOD = 100;
+
+        /** The read timeout the RX thread gives to wrapped drivers that
+         * have no file descriptor, in milliseconds. write() waits for
+         * their read() to return, so it bounds the added write latency
+         */
+        static const int LOCKED_READ_TIMEOUT = 5;
+
+        /** Wraps \c driver. AsyncReceiver takes ownership of it
+         *
+         * @param queue_size the capacity of the queue between the RX thread
+         *   and the consumer
+         */
+        explicit AsyncReceiver(Driver* driver,
+                size_t queue_size = RingBuffer<Message>::DEFAULT_CAPACITY,
+                RingBuffer<Message>::OVERFLOW_POLICY policy = RingBuffer<Message>::DROP_OLDEST);
+        ~AsyncReceiver();
+
+        /** The wrapped driver */
+        Driver& getDriver();
+
+        /** Pins the RX thread to the given CPU. Set to -1 (the default) to
+         * let the scheduler decide
+         */
+        void setCPUAffinity(int cpu);
+
+        /** Runs the RX thread with the SCHED_FIFO policy and this priority.
+         * Set to 0 (the default) to keep the normal scheduling policy
+         */
+        void setRealtimePriority(int priority);
+
+        /** Starts the RX thread
+         *
+         * The thread sets its CPU affinity and priority before it reads
+         * from the driver, and start() waits for it to do so.
+         *
+         * @return false if the thread could not be given the configured CPU
+         *   affinity or priority. The thread is not running in this case.
+         */
+        bool start();
+
+        /** Stops the RX thread */
+        void stop();
+
+        /** Whether the RX thread is running */
+        bool isRunning() const;
+
+        /** How many received messages have been dropped because the
+         * consumer did not read them fast enough
+         */
+        uint64_t getDroppedCount() const;
+
+        /** Opens the wrapped driver and starts the RX thread */
+        bool open(std::string const& path);
+
+        bool resetBoard();
+        bool reset();
+
+        void     setWriteTimeout(uint32_t timeout);
+        uint32_t getWriteTimeout() const;
+        void     setReadTimeout(uint32_t timeout);
+        uint32_t getReadTimeout() const;
+
+        /** Reads the next message received by the RX thread. It is
+         * guaranteed to not block longer than the timeout provided by
+         * setReadTimeout().
+         */
+        Message read();
+
+        /** Reads the next message received by the RX thread. It is
+         * guaranteed to not block longer than the timeout provided by
+         * setReadTimeout().
+         *
+         * @param msg   The Message will be put here, if any
+         * @return   true if msg was filled in, false on timeout.
+         */
+        bool read(Message& msg);
+
+        void write(Message const& msg);
+        size_t writeBatch(Message const* msgs, size_t count);
+
+        /** Returns the number of messages received by the RX thread and not
+         * read yet
+         */
+        int getPendingMessagesCount();
+
+        /** Returns the bus state, as last reported by the wrapped driver to
+         * the RX thread
+         */
+        bool checkBusOk();
+
+        /** Removes all messages received by the RX thread so far */
+        void clear();
+
+        /** Returns a file descriptor that becomes readable when received
+         * messages are pending, to be used in poll() or select()
+         */
+        int getFileDescriptor() const;
+
+        bool isValid() const;
+
+        /** Stops the RX thread and closes the wrapped driver */
+        void close();
+
+        uint32_t getErrorCount() const;
+
+        /** Sets the filters on the wrapped driver
+         *
+         * The RX thread is stopped while the filters are changed
+         */
+        bool setFilters(std::vector<Filter> const& filters);
+
+    private:
+        std::unique_ptr<Driver> m_driver;
+        /** Serializes the RX thread's and the writers' calls to m_driver */
+        std::mutex m_driver_lock;
+        RingBuffer<Message> m_queue;
+        uint32_t m_read_timeout;
+
+        int m_cpu;
+        int m_priority;
+
+        std::thread m_thread;
+        std::atomic<bool> m_stop;
+        std::atomic<bool> m_bus_ok;
+        std::atomic<uint32_t> m_error_count;
+        /** eventfd used to wake up the RX thread on stop() */
+        int m_stop_fd;
+        /** eventfd signalled by the RX thread when it queued messages */
+        int m_notify_fd;
+
+        void run(std::promise<bool> started);
+        bool drain();
+        void push(Message msg);
+        void waitForInput();
+        void notify();
+        void clearNotification();
+        bool applySchedulingParameters();
+    };
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include <canbus/Dispatcher.hpp>
+#include <algorithm>
+#include <map>
+
+using namespace canbus;
+
+Dispatcher::Dispatcher()
+    : mNextHandle(0)
+{
+    rebuild();
+}
+
+int Dispatcher::subscribe(uint32_t can_id, Handler const& handler)
+{
+    Subscription subscription = { mNextHandle++, false, Filter(can_id, 0xFFFFFFFF), handler };
+    mSubscriptions.push_back(subscription);
+    rebuild();
+    return subscription.handle;
+}
+
+int Dispatcher::subscribe(Filter const& filter, Handler const& handler)
+{
+    Subscription subscription = { mNextHandle++, true, filter, handler };
+    mSubscriptions.push_back(subscription);
+    rebuild();
+    return subscription.handle;
+}
+
+void Dispatcher::unsubscribe(int handle)
+{
+    mSubscriptions.erase(std::remove_if(mSubscriptions.begin(), mSubscriptions.end(),
+                [handle](Subscription const& s) { return s.handle == handle; }),
+            mSubscriptions.end());
+    rebuild();
+}
+
+void Dispatcher::unsubscribeID(uint32_t can_id)
+{
+    mSubscriptions.erase(std::remove_if(mSubscriptions.begin(), mSubscriptions.end(),
+                [can_id](Subscription const& s) {
+                    return !s.wildcard && s.filter.id == can_id;
+                }),
+            mSubscriptions.end());
+    rebuild();
+}
+
+void Dispatcher::clear()
+{
+    mSubscriptions.clear();
+    rebuild();
+}
+
+bool Dispatcher::empty() const
+{
+    return mSubscriptions.empty();
+}
+
+size_t Dispatcher::dispatchWildcards(Message const& msg) const
+{
+    size_t count = 0;
+    for (uint32_t index : mWildcards)
+    {
+        Subscription const& subscription = mSubscriptions[index];
+        if (subscription.filter.matches(msg.can_id))
+        {
+            subscription.handler(msg);
+            ++count;
+        }
+    }
+    return count;
+}
+
+void Dispatcher::rebuild()
+{
+    std::map<uint32_t, std::vector<uint32_t>> exact;
+    mWildcards.clear();
+    for (uint32_t i = 0; i < mSubscriptions.size(); ++i)
+    {
+        if (mSubscriptions[i].wildcard)
+            mWildcards.push_back(i);
+        else
+            exact[mSubscriptions[i].filter.id].push_back(i);
+    }
+
+    mLists.clear();
+    mStandard.resize(STANDARD_ID_COUNT);
+    for (uint32_t can_id = 0; can_id < STANDARD_ID_COUNT; ++can_id)
+    {
+        Range& range = mStandard[can_id];
+        range.begin = mLists.size();
+        auto it = exact.find(can_id);
+        if (it != exact.end())
+            mLists.insert(mLists.end(), it->second.begin(), it->second.end());
+        for (uint32_t index : mWildcards)
+        {
+            if (mSubscriptions[index].filter.matches(can_id))
+                mLists.push_back(index);
+        }
+        range.end = mLists.size();
+    }
+
+    // Keep the table at most half full, so that the probe sequences stay
+    // short and always end on a free entry
+    auto other = exact.lower_bound(static_cast<uint32_t>(STANDARD_ID_COUNT));
+    size_t count = std::distance(other, exact.end());
+    uint32_t bits = 1;
+    while ((1u << bits) < count * 2)
+        ++bits;
+    mTableShift = 32 - bits;
+    mTable.assign(1u << bits, Entry());
+
+    uint32_t mask = mTable.size() - 1;
+    for (; other != exact.end(); ++other)
+    {
+        uint32_t i = hash(other->first, mTableShift);
+        while (mTable[i].range.begin != mTable[i].range.end)
+            i = (i + 1) & mask;
+
+        mTable[i].can_id = other->first;
+        mTable[i].range.begin = mLists.size();
+        mLists.insert(mLists.end(), other->second.begin(), other->second.end());
+        mTable[i].range.end = mLists.size();
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef CANBUS_DISPATCHER_HH
+#define CANBUS_DISPATCHER_HH
+
+#include <canbus/Filter.hpp>
+#include <canbus/Message.hpp>
+#include <functional>
+#include <vector>
+
+namespace canbus
+{
+    /** Calls the handlers subscribed to the ID of a message
+     *
+     * Handlers are subscribed either to a single ID, which is matched
+     * against Message::can_id flags included, or to a Filter (wildcard
+     * subscription).
+     *
+     * The lookup structures are rebuilt on every subscription change, so
+     * that dispatching costs:
+     *
+     * - one lookup in a flat 2048-entry table for the 11-bit IDs. The
+     *   matching wildcard subscriptions are precomputed in the table
+     * - one lookup in an open-addressing hash table for the other IDs,
+     *   followed by a check of each wildcard subscription
+     *
+     * For a given message, the handlers subscribed to its ID are called
+     * first, then the matching wildcard handlers, both in subscription
+     * order.
+     *
+     * The handlers must not change the subscriptions.
+     */
+    class Dispatcher
+    {
+    public:
+        typedef std::function<void (Message const& msg)> Handler;
+
+        Dispatcher();
+
+        /** Calls \c handler for the messages with the given ID
+         *
+         * @return a handle to pass to unsubscribe()
+         */
+        int subscribe(uint32_t can_id, Handler const& handler);
+
+        /** Calls \c handler for the messages whose ID matches the filter
+         *
+         * @return a handle to pass to unsubscribe()
+         */
+        int subscribe(Filter const& filter, Handler const& handler);
+
+        /** Removes a subscription. Unknown handles are ignored */
+        void unsubscribe(int handle);
+
+        /** Removes all the handlers subscribed to the given ID. It does
+         * not affect the wildcard subscriptions
+         */
+        void unsubscribeID(uint32_t can_id);
+
+        /** Removes all subscriptions */
+        void clear();
+
+        bool empty() const;
+
+        /** Calls the handlers subscribed to the message's ID
+         *
+         * @return the number of handlers called
+         */
+        size_t dispatch(Message const& msg) const
+        {
+            Range range;
+            if (msg.can_id < STANDARD_ID_COUNT)
+                range = mStandard[msg.can_id];
+            else
+                range = find(msg.can_id);
+
+            for (uint32_t i = range.begin; i < range.end; ++i)
+                mSubscriptions[mLists[i]].handler(msg);
+
+            size_t count = range.end - range.begin;
+            if (msg.can_id < STANDARD_ID_COUNT)
+                return count;
+            return count + dispatchWildcards(msg);
+        }
+
+    private:
+        static const uint32_t STANDARD_ID_COUNT = 2048;
+
+        struct Subscription
+        {
+            int handle;
+            bool wildcard;
+            Filter filter;
+            Handler handler;
+        };
+
+        /** Range of mLists holding the indexes of the subscriptions for a
+         * given ID
+         */
+        struct Range
+        {
+            uint32_t begin;
+            uint32_t end;
+        };
+
+        /** Hash table entry. Entries with an empty range are free */
+        struct Entry
+        {
+            uint32_t can_id;
+            Range range;
+        };
+
+        int mNextHandle;
+        std::vector<Subscription> mSubscriptions;
+
+        std::vector<uint32_t> mLists;
+        std::vector<Range> mStandard;
+        std::vector<Entry> mTable;
+        uint32_t mTableShift;
+        /** Indexes of the wildcard subscriptions */
+        std::vector<uint32_t> mWildcards;
+
+        static uint32_t hash(uint32_t can_id, uint32_t shift)
+        {
+            return (can_id * 0x9E3779B1u) >> shift;
+        }
+
+        Range find(uint32_t can_id) const
+        {
+            uint32_t mask = mTable.size() - 1;
+            for (uint32_t i = hash(can_id, mTableShift); ; i = (i + 1) & mask)
+            {
+                Entry const& entry = mTable[i];
+                if (entry.range.begin == entry.range.end || entry.can_id == can_id)
+                    return entry.range;
+            }
+        }
+
+        size_t dispatchWildcards(Message const& msg) const;
+        void rebuild();
+    };
+}
+
+#endif
@@ -3,9 +3,13 @@
 #include <canbus/DriverHicoPCI.hpp>
 #include <canbus/Driver2Web.hpp>
 #include <canbus/DriverEasySYNC.hpp>
+#include <canbus/DriverLoopback.hpp>
 #include <canbus/DriverSocket.hpp>
+#include <canbus/DriverSocketMmap.hpp>
 #include <canbus/DriverNetGateway.hpp>
+#include <canbus/DriverReplay.hpp>
 #include <base-logging/Logging.hpp>
+#include <iodrivers_base/Exceptions.hpp>
 
 #include <stdio.h>
 #include <algorithm>
@@ -18,6 +22,27 @@ Driver::~Driver()
 {
 }
 
+bool Driver::setFilters(std::vector<Filter> const& filters)
+{
+    m_filters = FilterSet(filters);
+    return true;
+}
+
+std::vector<Filter> const& Driver::getFilters() const
+{
+    return m_filters.getFilters();
+}
+
+size_t Driver::writeBatch(Message const* msgs, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        try { write(msgs[i]); }
+        catch(iodrivers_base::TimeoutError&) { return i; }
+    }
+    return count;
+}
+
 Driver *canbus::openCanDevice(std::string const& path, DRIVER_TYPE dType)
 {
     std::unique_ptr<Driver> driver;
@@ -47,6 +72,18 @@ Driver *canbus::openCanDevice(std::string const& path, DRIVER_TYPE dType)
             driver.reset(new DriverEasySYNC());
             break;
 
+        case SOCKET_MMAP:
+            driver.reset(new DriverSocketMmap());
+            break;
+
+        case REPLAY:
+            driver.reset(new DriverReplay());
+            break;
+
+        case LOOPBACK:
+            driver.reset(new DriverLoopback());
+            break;
+
         default:
             return NULL; 
     }
@@ -90,6 +127,18 @@ Driver *canbus::openCanDevice(std::string const& path, std::string const& type_u
         return openCanDevice(path, EASY_SYNC);
     }
 
+    if (type == std::string("socket_mmap")) {
+        return openCanDevice(path, SOCKET_MMAP);
+    }
+
+    if (type == std::string("replay")) {
+        return openCanDevice(path, REPLAY);
+    }
+
+    if (type == std::string("loopback")) {
+        return openCanDevice(path, LOOPBACK);
+    }
+
     return NULL;
 }
 
@@ -2,7 +2,9 @@
 #define CANBUS_DRIVER_HH
 
 #include <canbus/Message.hpp>
+#include <canbus/Filter.hpp>
 #include <string>
+#include <vector>
 
 #define CANBUS_VERSION 101
 
@@ -89,6 +91,17 @@ namespace canbus
          */
         virtual void write(Message const& msg) = 0;
 
+        /** Writes a batch of messages, in order
+         *
+         * Drivers that can send several frames in one system call do so.
+         * The default implementation calls write() for each message.
+         *
+         * @return the number of messages from \c msgs that have been
+         *   written before the write timeout expired. This is \c count on
+         *   success.
+         */
+        virtual size_t writeBatch(Message const* msgs, size_t count);
+
         /** Returns the number of messages queued in the board's RX queue
          */
         virtual int getPendingMessagesCount() = 0;
@@ -131,6 +144,34 @@ namespace canbus
         virtual uint32_t getErrorCount() const{
             return 0;
         }
+
+        /** Sets the acceptance filters on the CAN ID
+         *
+         * Only the messages that match at least one of the filters are
+         * returned by read(). An empty list accepts all messages.
+         *
+         * Drivers that can do it filter in the kernel or in the hardware,
+         * so that unwanted frames never reach user space. The default
+         * implementation filters in user space.
+         *
+         * @return false if the filters could not be applied
+         */
+        virtual bool setFilters(std::vector<Filter> const& filters);
+
+        /** Returns the filters set with setFilters */
+        std::vector<Filter> const& getFilters() const;
+
+    protected:
+        /** Whether a received message passes the acceptance filters
+         *
+         * Drivers that do not filter in hardware must drop the messages
+         * for which this returns false.
+         */
+        bool acceptsMessage(Message const& msg) const {
+            return m_filters.accepts(msg.can_id);
+        }
+
+        FilterSet m_filters;
     };
 
     Driver *openCanDevice(std::string const& path, DRIVER_TYPE dType = SOCKET);
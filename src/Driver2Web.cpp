@@ -1,5 +1,6 @@
 #include <canbus/Driver2Web.hpp>
 #include "vendor/can2web_api.h"
+#include <iodrivers_base/Exceptions.hpp>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -7,6 +8,7 @@
 #include <string.h>
 #include <fcntl.h>
 #include <iostream>
+#include <algorithm>
 #include <boost/lexical_cast.hpp>
 
 #define CANSTR_XMTFULL          "controller send buffer is full, can be ignored"
@@ -34,8 +36,8 @@ Driver2Web::Driver2Web()
 
 bool Driver2Web::reset()
 {
-    char *sz = new char[128];
-    sprintf(sz, "can_baudrate %i\r", (int) m_baudrate);
+    char sz[128];
+    snprintf(sz, sizeof(sz), "can_baudrate %i\r", (int) m_baudrate);
     write((uint8_t*) sz);
     usleep(1000);
     sprintf(sz, "can_extended 2\r");
@@ -147,16 +149,25 @@ bool Driver2Web::resetBoard()
 }
 
 Message Driver2Web::read()
+{
+    iodrivers_base::Timeout timeout(m_read_timeout);
+    while (true) {
+        Message result = readMessage(timeout.timeLeft());
+        if (acceptsMessage(result))
+            return result;
+        if (timeout.elapsed())
+            throw iodrivers_base::TimeoutError(iodrivers_base::TimeoutError::PACKET,
+                    "read(): timeout");
+    }
+}
+
+Message Driver2Web::readMessage(uint32_t read_timeout)
 {
     uint8_t msg[CAN_MSG_SIZE_MIN + 16];
     msg[0] = 0;
     Message result;
-    try {
-        while (msg[0] < CAN_START || msg[0] > CAN_START_TIME) {
-            readPacket(msg, CAN_MSG_SIZE_MIN + 16, m_read_timeout);
-        }
-    } catch (iodrivers_base::TimeoutError& ) {
-
+    while (msg[0] < CAN_START || msg[0] > CAN_START_TIME) {
+        readPacket(msg, CAN_MSG_SIZE_MIN + 16, read_timeout);
     }
     can_msg canMsg;
     canMsg << msg;
@@ -188,12 +199,13 @@ void Driver2Web::write(Message const& msg)
     out.start = CAN_START;
     out.status = 0;
     out.can_id = msg.can_id;
-    out.rtr_mode_len = CAN_MODE | msg.size;
+    // The length field is also the frame's DLC on the wire, it must
+    // match the encoded payload
+    out.rtr_mode_len = CAN_MODE | std::min<uint8_t>(msg.size, 8);
     memcpy(out.data, msg.data, 8);
-    uint8_t* s;
-    out >> s;
-    int len = CAN_MSG_SIZE_MIN + (out.rtr_mode_len & 0xF);
-    writePacket(s, len, m_write_timeout);
+    uint8_t buffer[CAN_MSG_SIZE_MAX];
+    int len = out.encode(buffer);
+    writePacket(buffer, len, m_write_timeout);
 }
 
 void Driver2Web::write(uint8_t *sz)
@@ -247,7 +259,7 @@ bool Driver2Web::checkBusOk()
 void Driver2Web::clear()
 {
     while (hasPacket()) {
-        read();
+        readMessage(0);
     }
 }
 
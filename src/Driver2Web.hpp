@@ -38,6 +38,7 @@ namespace canbus
         Status m_status;
 
         int extractPacket(uint8_t const* buffer, size_t buffer_size) const;
+        Message readMessage(uint32_t read_timeout);
 
     public:
         /** The default timeout value in milliseconds
@@ -104,6 +105,9 @@ namespace canbus
          * timeout provided by setReadTimeout().
          *
          * The default timeout value is given by DEFAULT_TIMEOUT
+         *
+         * @throw iodrivers_base::TimeoutError if no message passing the
+         *   filters arrived before the timeout
          */
         Message read();
 
@@ -1,5 +1,6 @@
 #include <string>
 #include <canbus/DriverEasySYNC.hpp>
+#include <canbus/Hex.hpp>
 #include <base/Time.hpp>
 #include <linux/serial.h>
 #include <sys/ioctl.h>
@@ -23,29 +24,93 @@ BAUD_RATE_ARGUMENTS baud_rates[] = {
 
 DriverEasySYNC::DriverEasySYNC(int queue_size)
     : iodrivers_base::Driver(MAX_PACKET_SIZE)
+    , mQueue(queue_size)
 {
-    mQueue.reserve(queue_size);
 }
 
-bool DriverEasySYNC::open(string const& path)
+/** The bus configuration given after the last colon of the URI */
+struct BusOptions
 {
-    std::string uri;
-    unsigned int colon = path.find_last_of(":");
-    char const* rate_cmd = 0;
-    if (colon != string::npos)
+    char const* rate_cmd = nullptr;
+    string btr_cmd;
+    string code_cmd;
+    string mask_cmd;
+};
+
+/** Builds a command made of a letter followed by hex_size hex characters,
+ * validating them
+ */
+static bool hexCommand(string& cmd, char letter, string const& value, int hex_size)
+{
+    uint8_t decoded[4];
+    if (static_cast<int>(value.size()) != hex_size ||
+        !hex::decode(decoded, reinterpret_cast<uint8_t const*>(value.c_str()), hex_size / 2))
+        return false;
+    cmd = letter + value + "\r";
+    return true;
+}
+
+/** Parses a comma-separated list of bus options: a rate from baud_rates,
+ * btr=XXYY, code=XXXXXXXX and mask=XXXXXXXX
+ *
+ * @return false if \c suffix is not a list of bus options
+ */
+static bool parseBusOptions(string const& suffix, BusOptions& options)
+{
+    size_t start = 0;
+    while (start <= suffix.size())
     {
-        string potential_rate(path, colon + 1, path.size() - colon - 1);
+        size_t end = suffix.find(',', start);
+        if (end == string::npos)
+            end = suffix.size();
+        string option(suffix, start, end - start);
+        start = end + 1;
+
+        bool valid = false;
         for (int i = 0; baud_rates[i].cmd; ++i)
         {
-            if (baud_rates[i].asString == potential_rate) {
-                rate_cmd = baud_rates[i].cmd;
+            if (baud_rates[i].asString == option) {
+                options.rate_cmd = baud_rates[i].cmd;
+                valid = true;
             }
         }
+        if (valid)
+            continue;
+
+        size_t equal = option.find('=');
+        if (equal == string::npos)
+            return false;
+        string name(option, 0, equal);
+        string value(option, equal + 1);
+        if (name == "btr")
+            valid = hexCommand(options.btr_cmd, 's', value, 4);
+        else if (name == "code")
+            valid = hexCommand(options.code_cmd, 'M', value, 8);
+        else if (name == "mask")
+            valid = hexCommand(options.mask_cmd, 'm', value, 8);
+
+        if (!valid)
+            throw std::invalid_argument("invalid bus option '" + option + "' in " + suffix);
+    }
+
+    if (options.rate_cmd && !options.btr_cmd.empty())
+        throw std::invalid_argument("cannot give both a bus rate and btr in " + suffix);
+    return true;
+}
+
+bool DriverEasySYNC::open(string const& path)
+{
+    std::string uri = path;
+    BusOptions options;
+    size_t colon = path.find_last_of(":");
+    if (colon != string::npos)
+    {
+        string suffix(path, colon + 1, path.size() - colon - 1);
+        if (parseBusOptions(suffix, options))
+            uri = string(path, 0, colon);
+        else
+            options = BusOptions();
     }
-    if (rate_cmd)
-        uri = string(path, 0, colon);
-    else
-        uri = path;
 
     setReadTimeout(100);
     setWriteTimeout(100);
@@ -68,8 +133,14 @@ bool DriverEasySYNC::open(string const& path)
         processSimpleCommand("Z1\r", 3);
     else
         processSimpleCommand("Z0\r", 3);
-    if (rate_cmd)
-        processSimpleCommand(rate_cmd, 3);
+    if (options.rate_cmd)
+        processSimpleCommand(options.rate_cmd, 3);
+    if (!options.btr_cmd.empty())
+        processSimpleCommand(options.btr_cmd.c_str(), options.btr_cmd.size());
+    if (!options.code_cmd.empty())
+        processSimpleCommand(options.code_cmd.c_str(), options.code_cmd.size());
+    if (!options.mask_cmd.empty())
+        processSimpleCommand(options.mask_cmd.c_str(), options.mask_cmd.size());
     processSimpleCommand("O\r", 2);
     processSimpleCommand("E\r", 2);
     return true;
@@ -108,25 +179,6 @@ bool DriverEasySYNC::reset()
     return true;
 }
 
-static int nibbleToInt(char c)
-{
-    if (c <= '9')
-        return c - '0';
-    else
-        return 0xA + (c - 'A');
-}
-
-uint8_t const* parseBytes(uint8_t* output, uint8_t const* input, int byte_size)
-{
-    for (int i = 0; i < byte_size; ++i)
-    {
-        int msn = nibbleToInt(input[i * 2]);
-        int lsn = nibbleToInt(input[i * 2 + 1]);
-        output[i] = msn << 4 | lsn;
-    }
-    return input + byte_size * 2;
-}
-
 template<typename T>
 static void commandWithRetries(T lambda, int retries, int timeout) {
     base::Time deadline = base::Time::now() + base::Time::fromMilliseconds(timeout);
@@ -146,8 +198,9 @@ int DriverEasySYNC::getPendingMessagesCount()
     try {
         while(mQueue.size() < mQueue.capacity())
         {
-            auto msg = readFromIO(0);
-            mQueue.insert(mQueue.begin(), msg);
+            Message msg;
+            if (readFrameOrAck(msg, 0))
+                queueReceivedFrame(msg);
         }
     }
     catch(iodrivers_base::TimeoutError&) {}
@@ -161,110 +214,248 @@ Message DriverEasySYNC::read()
 
 Message DriverEasySYNC::read(int timeout_ms)
 {
-    if (!mQueue.empty()) {
-        canbus::Message msg = mQueue.back();
-        mQueue.pop_back();
-        return msg;
+    canbus::Message queued;
+    if (mQueue.pop(queued))
+        return queued;
+
+    base::Time deadline = base::Time::now() + base::Time::fromMilliseconds(timeout_ms);
+    while (true) {
+        int remaining = std::max<int64_t>(0, (deadline - base::Time::now()).toMilliseconds());
+        canbus::Message msg;
+        if (readFrameOrAck(msg, remaining) && acceptsMessage(msg))
+            return msg;
     }
-    return readFromIO(timeout_ms);
 }
 
+/** Returns the number of characters of the ID of a received frame, or 0 if
+ * the packet is not a frame
+ */
+static int getFrameIDSize(uint8_t type)
+{
+    switch(type)
+    {
+        case 't':
+        case 'r':
+            return 3;
+        case 'T':
+        case 'R':
+            return 8;
+        default:
+            return 0;
+    }
+}
 
-Message DriverEasySYNC::readFromIO(int timeout_ms)
+static bool isRemoteFrame(uint8_t type)
+{
+    return type == 'r' || type == 'R';
+}
+
+bool DriverEasySYNC::readFrameOrAck(Message& msg, int timeout_ms)
 {
     uint8_t buffer[MAX_PACKET_SIZE];
     int size = readPacket(buffer, MAX_PACKET_SIZE, timeout_ms);
-    canbus::Message message;
-    message.time = base::Time::now();
-
-    uint8_t const* cursor;
+    return processFrameOrAck(msg, buffer, size);
+}
 
-    uint8_t raw_can_id[4] = { 0, 0, 0, 0 };
-    if (buffer[0] == 'T')
-        cursor = parseBytes(raw_can_id, buffer + 1, 4);
-    else
+bool DriverEasySYNC::processFrameOrAck(Message& msg, uint8_t const* buffer, int size)
+{
+    if (getFrameIDSize(buffer[0]))
     {
-        buffer[0] = '0'; // round at the nibble ...
-        cursor = parseBytes(raw_can_id + 2, buffer, 2);
+        msg = parseFrame(buffer, size);
+        return true;
     }
-    message.can_id =
-        static_cast<int>(raw_can_id[0]) << 24 |
-        static_cast<int>(raw_can_id[1]) << 16 |
-        static_cast<int>(raw_can_id[2]) << 8 |
-        static_cast<int>(raw_can_id[3]) << 0;
-
-    int length = *cursor - '0';
-    message.size = length;
-
-    cursor = parseBytes(message.data, cursor + 1, length);
-    if (cursor + 4 == buffer + size)
-    {
-        uint8_t raw_can_time[2] = { 0, 0 };
-        cursor = parseBytes(raw_can_time, cursor, 2);
+    else if (buffer[0] == 'z' || buffer[0] == 'Z' || buffer[0] == '\x7')
+        processAck(buffer[0]);
+    return false;
+}
 
-        if (cursor != buffer + size)
-            throw std::runtime_error("size mismatch while parsing a received frame");
+void DriverEasySYNC::queueReceivedFrame(Message const& msg)
+{
+    if (acceptsMessage(msg))
+        mQueue.push(msg);
+}
 
-        uint32_t can_time =
-            static_cast<int>(raw_can_time[0]) << 8 |
-            static_cast<int>(raw_can_time[1]) << 0;
-	    message.can_time = base::Time::fromMilliseconds(can_time);
-    }
-    else if (cursor != buffer + size)
-        throw std::runtime_error("size mismatch while parsing a received frame");
-    return message;
+void DriverEasySYNC::setReceiveQueueSize(size_t capacity,
+        RingBuffer<Message>::OVERFLOW_POLICY policy)
+{
+    mQueue.reset(capacity, policy);
 }
 
-static char intToNibble(int v)
+uint64_t DriverEasySYNC::getReceiveQueueDropCount() const
 {
-    if (v < 0xA)
-        return v + '0';
-    else
-        return (v - 0xA) + 'A';
+    return mQueue.getDroppedCount();
 }
 
-uint8_t* dumpBytes(uint8_t* output, uint8_t const* input, int byte_size)
+Message DriverEasySYNC::parseFrame(uint8_t const* buffer, int size) const
 {
-    for (int i = 0; i < byte_size; ++i)
+    canbus::Message message;
+    message.time = base::Time::now();
+
+    // Everything between the frame type and the final \r is hexadecimal.
+    // Convert and validate it in one pass, then assemble the fields
+    int id_size = getFrameIDSize(buffer[0]);
+    bool remote = isRemoteFrame(buffer[0]);
+    int nibble_count = size - 2;
+    uint8_t nibbles[MAX_PACKET_SIZE];
+    if (hex::toNibbles(nibbles, buffer + 1, nibble_count) != nibble_count)
+        throw std::runtime_error("invalid character while parsing a received frame");
+    if (nibble_count < id_size + 1)
+        throw std::runtime_error("size mismatch while parsing a received frame");
+
+    uint32_t can_id = 0;
+    for (int i = 0; i < id_size; ++i)
+        can_id = can_id << 4 | nibbles[i];
+    message.can_id = remote ? (can_id | FLAG_REMOTE_TRANSMISSION_REQUEST) : can_id;
+
+    // Remote frames only have the requested length, without data
+    int length = nibbles[id_size];
+    int data_end = id_size + 1 + (remote ? 0 : length * 2);
+    if (length > 8 || data_end > nibble_count)
+        throw std::runtime_error("size mismatch while parsing a received frame");
+    message.size = length;
+    if (!remote)
+        hex::packNibbles(message.data, nibbles + id_size + 1, length);
+
+    if (data_end + 4 == nibble_count)
     {
-        output[i * 2]     = intToNibble((input[i] >> 4) & 0xF);
-        output[i * 2 + 1] = intToNibble(input[i] & 0xF);
+        uint8_t const* raw_can_time = nibbles + data_end;
+        uint32_t can_time =
+            raw_can_time[0] << 12 | raw_can_time[1] << 8 |
+            raw_can_time[2] << 4 | raw_can_time[3];
+        message.can_time = base::Time::fromMilliseconds(can_time);
     }
-    return output + byte_size * 2;
+    else if (data_end != nibble_count)
+        throw std::runtime_error("size mismatch while parsing a received frame");
+    return message;
 }
 
-void DriverEasySYNC::write(Message const& msg)
+int DriverEasySYNC::encodeFrame(uint8_t* buffer, Message const& msg) const
 {
     uint8_t raw_can_id[4];
     raw_can_id[0] = (msg.can_id >> 24) & 0xFF;
     raw_can_id[1] = (msg.can_id >> 16) & 0xFF;
     raw_can_id[2] = (msg.can_id >>  8) & 0xFF;
     raw_can_id[3] = (msg.can_id >>  0) & 0xFF;
-    uint8_t buffer[MAX_PACKET_SIZE];
     uint8_t* cursor;
     if ((msg.can_id & ~0x7FF) != 0)
     {
         buffer[0] = 'T';
-        cursor = dumpBytes(buffer + 1, raw_can_id, 4);
+        cursor = hex::encode(buffer + 1, raw_can_id, 4);
     }
     else
     {
-        cursor = dumpBytes(buffer, raw_can_id + 2, 2);
+        cursor = hex::encode(buffer, raw_can_id + 2, 2);
         buffer[0] = 't';
     }
 
     *cursor = msg.size + '0';
-    cursor = dumpBytes(cursor + 1, msg.data, msg.size);
+    cursor = hex::encode(cursor + 1, msg.data, msg.size);
     *cursor = '\r';
+    return cursor - buffer + 1;
+}
+
+void DriverEasySYNC::write(Message const& msg)
+{
+    uint8_t buffer[MAX_PACKET_SIZE];
+    int bufferSize = encodeFrame(buffer, msg);
+
+    if (mMaxInFlight > 1)
+    {
+        base::Time deadline = base::Time::now() + base::Time::fromMilliseconds(getWriteTimeout());
+        if (!waitForAcks(mMaxInFlight - 1, deadline))
+        {
+            failInFlight();
+            throw iodrivers_base::TimeoutError(iodrivers_base::TimeoutError::PACKET,
+                    "write(): timeout while waiting for the acknowledgement of previous frames");
+        }
+
+        mCurrentCommand = 't';
+        writePacket(buffer, bufferSize);
+        mInFlight.push_back(msg);
+        return;
+    }
 
-    int bufferSize = cursor - buffer + 1;
     uint8_t replyBuffer[MAX_PACKET_SIZE];
-    commandWithRetries([this, buffer, bufferSize, &replyBuffer](int timeout) {
+    commandWithRetries([this, &buffer, bufferSize, &replyBuffer](int timeout) {
         writePacket(buffer, bufferSize);
         readReply('t', replyBuffer, timeout);
     }, 10, getReadTimeout());
 }
 
+void DriverEasySYNC::processAck(uint8_t reply)
+{
+    if (mInFlight.empty())
+        return;
+    if (reply == '\x7')
+        mFailedWrites.push_back(mInFlight.front());
+    mInFlight.pop_front();
+}
+
+bool DriverEasySYNC::waitForAcks(size_t max_in_flight, base::Time const& deadline)
+{
+    while (mInFlight.size() > max_in_flight)
+    {
+        int64_t remaining = (deadline - base::Time::now()).toMilliseconds();
+        if (remaining < 0)
+            return false;
+
+        uint8_t buffer[MAX_PACKET_SIZE];
+        int size;
+        try { size = readPacket(buffer, MAX_PACKET_SIZE, remaining); }
+        catch(iodrivers_base::TimeoutError&) {
+            return false;
+        }
+
+        // As in readReply, a corrupted frame is dropped, it is not the
+        // failure of the write
+        Message msg;
+        try {
+            if (processFrameOrAck(msg, buffer, size))
+                queueReceivedFrame(msg);
+        }
+        catch(std::runtime_error&) { }
+    }
+    return true;
+}
+
+void DriverEasySYNC::failInFlight()
+{
+    mFailedWrites.insert(mFailedWrites.end(), mInFlight.begin(), mInFlight.end());
+    mInFlight.clear();
+}
+
+bool DriverEasySYNC::flush()
+{
+    base::Time deadline = base::Time::now() + base::Time::fromMilliseconds(getWriteTimeout());
+    if (waitForAcks(0, deadline))
+        return true;
+
+    failInFlight();
+    return false;
+}
+
+void DriverEasySYNC::setMaxInFlight(size_t count)
+{
+    mMaxInFlight = std::max<size_t>(1, count);
+}
+
+size_t DriverEasySYNC::getMaxInFlight() const
+{
+    return mMaxInFlight;
+}
+
+size_t DriverEasySYNC::getInFlightCount() const
+{
+    return mInFlight.size();
+}
+
+std::vector<Message> DriverEasySYNC::takeFailedWrites()
+{
+    std::vector<Message> failed;
+    failed.swap(mFailedWrites);
+    return failed;
+}
+
 int DriverEasySYNC::getFileDescriptor() const
 {
     return iodrivers_base::Driver::getFileDescriptor();
@@ -283,6 +474,8 @@ void DriverEasySYNC::close()
 
 DriverEasySYNC::Status DriverEasySYNC::getStatus()
 {
+    flush();
+
     uint8_t buffer[MAX_PACKET_SIZE];
     commandWithRetries([this, &buffer](int timeout) {
         writeCommand("F\r", 2);
@@ -290,7 +483,8 @@ DriverEasySYNC::Status DriverEasySYNC::getStatus()
     }, 10, getReadTimeout());
 
     uint8_t raw_status;
-    parseBytes(&raw_status, buffer, 2);
+    if (!hex::decode(&raw_status, buffer, 1))
+        throw std::runtime_error("invalid status reply");
     Status status;
     status.time = base::Time::now();
     if (raw_status & 0x20) {
@@ -332,10 +526,15 @@ void DriverEasySYNC::clear()
 {
     processSimpleCommand("E\r", 2);
     iodrivers_base::Driver::clear();
+    mQueue.clear();
 }
 
 void DriverEasySYNC::processSimpleCommand(char const* cmd, int commandSize)
 {
+    // Replies are not tagged, they are matched to the command. Wait for
+    // the pipelined writes to be acknowledged before sending a command
+    flush();
+
     uint8_t buffer[MAX_PACKET_SIZE];
     commandWithRetries([this, cmd, commandSize, &buffer](int timeout) {
         writeCommand(cmd, commandSize);
@@ -371,24 +570,25 @@ int DriverEasySYNC::readReply(char command, uint8_t* buffer, int timeout)
         int size = readPacket(buffer, MAX_PACKET_SIZE, (deadline - base::Time::now()).toMilliseconds());
         if (buffer[0] == '\x7')
             throw FailedCommand(string(&command, 1) + " command failed");
-        else if (buffer[0] != 't' && buffer[0] != 'T')
+        else if (!getFrameIDSize(buffer[0]))
             return size;
-    }
-}
 
-static bool isNibble(char c)
-{
-    return (c >= '0' && c <= '9') ||
-        (c >= 'A' && c <= 'F');
+        // Frames received while waiting for the reply are kept for read().
+        // A corrupted one is dropped, it is not the command's failure
+        try { queueReceivedFrame(parseFrame(buffer, size)); }
+        catch(std::runtime_error&) { }
+    }
 }
 
 static int checkNibbleSequence(uint8_t const* buffer, int bufferSize, int offset, int expectedSize)
 {
     int size = std::min(offset + expectedSize, bufferSize);
-    for (int i = offset; i < size; ++i)
-        if (!isNibble(buffer[i]))
-            return -i;
-    return 0;
+    if (size <= offset)
+        return 0;
+    int valid = hex::findInvalid(buffer + offset, size - offset);
+    if (offset + valid == size)
+        return 0;
+    return -std::max(1, offset + valid);
 }
 
 void DriverEasySYNC::setUseBoardTimestamps(bool use)
@@ -407,25 +607,30 @@ int DriverEasySYNC::extractPacket(uint8_t const* buffer, size_t bufferSize) cons
         return 0;
     else if (buffer[0] == '\x7')
         return 1;
-    else if (buffer[0] == 't')
+    else if (int id_size = getFrameIDSize(buffer[0]))
     {
-        // Reception of a standard frame
-        int r = checkNibbleSequence(buffer, bufferSize, 1, 4);
-        if (r)
-            return r;
-        if (bufferSize < 5)
+        // Reception of a frame: tIIIL<data><timestamp>\r for standard
+        // frames, TIIIIIIIIL<data><timestamp>\r for extended frames, and r
+        // or R for the remote frames, which have no data. Only the length
+        // and the final \r are checked here, the characters are validated
+        // while parseFrame() decodes them
+        size_t length_index = 1 + id_size;
+        if (bufferSize <= length_index)
             return 0;
+        uint8_t length = buffer[length_index];
+        if (length < '0' || length > '8')
+            return -1;
 
-        // remaining N bytes per packet and 4 for timestamp
-        int remainingLength = (buffer[4] - '0') * 2;
+        // N bytes of data, 4 characters of timestamp and the \r
+        size_t expectedLength = length_index + 2;
+        if (!isRemoteFrame(buffer[0]))
+            expectedLength += (length - '0') * 2;
         if (useBoardTimestamps())
-            remainingLength += 4;
-        size_t expectedLength = remainingLength + 5;
-        r = checkNibbleSequence(buffer, bufferSize, 5, remainingLength);
-        if (r)
-            return r;
-        else if (bufferSize < expectedLength)
+            expectedLength += 4;
+        if (bufferSize < expectedLength)
             return 0;
+        else if (buffer[expectedLength - 1] != '\r')
+            return -1;
         else
             return expectedLength;
     }
@@ -479,23 +684,13 @@ int DriverEasySYNC::extractPacket(uint8_t const* buffer, size_t bufferSize) cons
                 return 2;
             else return -2;
         }
-        case 't':
-            if (bufferSize >= 1 && buffer[0] == '\x7')
-                return 1;
-            else if (bufferSize < 2)
-                return 0;
-            else if (buffer[0] != 'z')
-                return -1;
-            else if (buffer[1] != '\r')
-                return -2;
-            else
-                return 2;
+        case 't': // replies with z\r to t and Z\r to T
         case 'T':
             if (bufferSize >= 1 && buffer[0] == '\x7')
                 return 1;
             else if (bufferSize < 2)
                 return 0;
-            else if (buffer[0] != 'Z')
+            else if (buffer[0] != 'z' && buffer[0] != 'Z')
                 return -1;
             else if (buffer[1] != '\r')
                 return -2;
@@ -3,6 +3,9 @@
 
 #include <iodrivers_base/Driver.hpp>
 #include <canbus/Driver.hpp>
+#include <canbus/RingBuffer.hpp>
+#include <deque>
+#include <vector>
 
 namespace canbus
 {
@@ -50,6 +53,20 @@ namespace canbus
          * For instance, serial:///dev/ttyUSB0:115200:10k will open the device
          * on /dev/ttyUSB0 with a serial baud rate of 115200, using 10k CAN
          * rate.
+         *
+         * Instead of a rate, btr=XXYY sets the bit timing registers BTR0 and
+         * BTR1 (in hex) of the SJA1000-compatible controller, for rates that
+         * are not in the list. The acceptance code and mask registers can be
+         * set as well with code=XXXXXXXX and mask=XXXXXXXX, so that the
+         * adapter drops the unwanted frames before they cross the serial
+         * link. The options are separated by commas, e.g.
+         * serial:///dev/ttyUSB0:115200:btr=0016,code=00000000,mask=FFFFFFFF
+         *
+         * The acceptance filter is coarse (see the SJA1000 documentation for
+         * how the registers map to the ID). Use setFilters() on top of it
+         * for an exact filtering.
+         *
+         * @throw std::invalid_argument if one of the options is invalid
          */
         virtual bool open(std::string const& path);
 
@@ -87,6 +104,59 @@ namespace canbus
 
         int readWriteReply(int timeout = 0);
 
+        /** Sets the capacity of the receive queue, and whether the oldest or
+         * the newest message is dropped when it overflows
+         *
+         * Frames received while waiting for command replies or write
+         * acknowledgements are stored there until read() returns them. This
+         * discards the messages currently queued
+         */
+        void setReceiveQueueSize(size_t capacity,
+                RingBuffer<Message>::OVERFLOW_POLICY policy = RingBuffer<Message>::DROP_OLDEST);
+
+        /** How many received messages have been dropped because the receive
+         * queue was full
+         */
+        uint64_t getReceiveQueueDropCount() const;
+
+        /** Sets how many frames write() may send before it waits for their
+         * acknowledgements
+         *
+         * With the default of 1, write() waits for the acknowledgement of
+         * each frame and retries the frames the board rejects. With more,
+         * write() returns as soon as the frame is sent, as long as fewer than
+         * \c count frames are waiting for their acknowledgement. The
+         * acknowledgements are matched to the frames in order. Rejected
+         * frames are not retried, but reported by takeFailedWrites(). So are
+         * the frames still waiting for their acknowledgement when write()
+         * times out.
+         *
+         * Frames received while waiting for acknowledgements are queued for
+         * read()
+         */
+        void setMaxInFlight(size_t count);
+
+        /** @see setMaxInFlight */
+        size_t getMaxInFlight() const;
+
+        /** The number of written frames whose acknowledgement has not been
+         * received yet
+         */
+        size_t getInFlightCount() const;
+
+        /** Waits, up to the write timeout, for the acknowledgement of all
+         * written frames
+         *
+         * @return false on timeout. The frames that have not been
+         *   acknowledged are then reported by takeFailedWrites()
+         */
+        bool flush();
+
+        /** Returns the frames the board rejected, or did not acknowledge in
+         * time, since the last call
+         */
+        std::vector<Message> takeFailedWrites();
+
         /** Read the CAN timestamps from the board
          *
          * They are fairly unreliable in full-duplex situations, so they are
@@ -135,6 +205,9 @@ namespace canbus
     private:
         char mCurrentCommand;
         bool mUseBoardTimestamps = false;
+        size_t mMaxInFlight = 1;
+        std::deque<Message> mInFlight;
+        std::vector<Message> mFailedWrites;
         void writeCommand(char const* cmd, int commandSize);
         void writeCommand(uint8_t const* cmd, int commandSize);
         int readReply(char cmd, uint8_t* buffer);
@@ -143,8 +216,25 @@ namespace canbus
         void processSimpleCommand(uint8_t const* cmd, int commandSize);
         int extractPacket(uint8_t const* buffer, size_t buffer_size) const;
 
-        std::vector<canbus::Message> mQueue;
-        Message readFromIO(int timeout_ms);
+        RingBuffer<Message> mQueue;
+        Message parseFrame(uint8_t const* buffer, int size) const;
+        int encodeFrame(uint8_t* buffer, Message const& msg) const;
+
+        /** Reads one packet. Acknowledgements of pipelined writes are
+         * processed, frames are returned
+         *
+         * @return true if a frame was read into msg
+         */
+        bool readFrameOrAck(Message& msg, int timeout_ms);
+        bool processFrameOrAck(Message& msg, uint8_t const* buffer, int size);
+        void queueReceivedFrame(Message const& msg);
+        void processAck(uint8_t reply);
+        bool waitForAcks(size_t max_in_flight, base::Time const& deadline);
+
+        /** Moves the frames waiting for their acknowledgement to the failed
+         * writes
+         */
+        void failInFlight();
     };
 }
 
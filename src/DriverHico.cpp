@@ -92,17 +92,22 @@ bool DriverHico::open(std::string const& path)
 
 Message DriverHico::read()
 {
-    can_msg msg;
-    readPacket(reinterpret_cast<uint8_t*>(&msg), sizeof(can_msg), m_read_timeout);
-
-    Message result;
-    result.time     = base::Time::now();
-    result.can_time = base::Time::fromMicroseconds(msg.ts) +
-      timestampBase;
-    result.can_id        = msg.id;
-    memcpy(result.data, msg.data, 8);
-    result.size          = msg.dlc;
-    return result;
+    iodrivers_base::Timeout timeout(m_read_timeout);
+    while (true)
+    {
+        can_msg msg;
+        readPacket(reinterpret_cast<uint8_t*>(&msg), sizeof(can_msg), timeout.timeLeft());
+
+        Message result;
+        result.time     = base::Time::now();
+        result.can_time = base::Time::fromMicroseconds(msg.ts) +
+          timestampBase;
+        result.can_id        = msg.id;
+        memcpy(result.data, msg.data, 8);
+        result.size          = msg.dlc;
+        if (acceptsMessage(result))
+            return result;
+    }
 }
 
 void DriverHico::write(Message const& msg)
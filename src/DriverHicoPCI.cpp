@@ -133,18 +133,23 @@ bool DriverHicoPCI::open(std::string const& path)
 
 Message DriverHicoPCI::read()
 {//done (have a look at the timestamp)
-    canMsg msg;
-    readPacket(reinterpret_cast<uint8_t*>(&msg), sizeof(canMsg), m_read_timeout);
-
-    Message result;
-    
-    result.time     = base::Time::now();
-    result.can_time = base::Time::fromMicroseconds(msg.ts.us) +
-      timestampBase;
-    result.can_id        = msg.id;
-    memcpy(result.data, msg.data, 8);
-    result.size          = msg.dlc;
-    return result;
+    iodrivers_base::Timeout timeout(m_read_timeout);
+    while (true)
+    {
+        canMsg msg;
+        readPacket(reinterpret_cast<uint8_t*>(&msg), sizeof(canMsg), timeout.timeLeft());
+
+        Message result;
+
+        result.time     = base::Time::now();
+        result.can_time = base::Time::fromMicroseconds(msg.ts.us) +
+          timestampBase;
+        result.can_id        = msg.id;
+        memcpy(result.data, msg.data, 8);
+        result.size          = msg.dlc;
+        if (acceptsMessage(result))
+            return result;
+    }
 }
 
 void DriverHicoPCI::write(Message const& msg)
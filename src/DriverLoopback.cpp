@@ -0,0 +1,563 @@
+#include <canbus/DriverLoopback.hpp>
+#include <base-logging/Logging.hpp>
+#include <iodrivers_base/Driver.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+
+#include <stdlib.h>
+#include <chrono>
+#include <map>
+#include <thread>
+
+using namespace canbus;
+using iodrivers_base::TimeoutError;
+
+LoopbackBus::Config::Config()
+    : bitrate(0)
+    , drop_rate(0)
+    , error_rate(0)
+    , seed(1)
+    , capacity(DEFAULT_CAPACITY) {}
+
+bool LoopbackBus::Config::operator == (Config const& other) const
+{
+    return bitrate == other.bitrate &&
+        drop_rate == other.drop_rate &&
+        error_rate == other.error_rate &&
+        seed == other.seed &&
+        capacity == other.capacity;
+}
+
+std::shared_ptr<LoopbackBus> LoopbackBus::get(std::string const& name,
+                                              Config const& config)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<LoopbackBus>> buses;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<LoopbackBus> bus = buses[name].lock();
+    if (!bus) {
+        bus.reset(new LoopbackBus(config));
+        buses[name] = bus;
+    }
+    return bus;
+}
+
+LoopbackBus::LoopbackBus(Config const& config)
+    : m_config(config)
+    , m_head(0)
+    , m_arbitrating(false)
+    , m_paused_by(std::thread::id())
+    , m_random(config.seed ? config.seed : 1)
+    , m_epoch(base::Time::now())
+    , m_bus_time_ns(0)
+    , m_bus_time_us(0)
+    , m_transmitted(0)
+    , m_dropped(0)
+    , m_errors(0)
+    , m_waiters(0)
+{
+    size_t slots = 1;
+    while (slots < config.capacity)
+        slots <<= 1;
+    m_slots = std::vector<Slot>(slots);
+    for (size_t i = 0; i < slots; ++i)
+        m_slots[i].sequence.store(0);
+    m_mask = slots - 1;
+
+    for (size_t i = 0; i < MAX_NODES; ++i) {
+        m_attached[i].store(false);
+        m_has_candidate[i] = false;
+    }
+}
+
+LoopbackBus::Config const& LoopbackBus::getConfig() const
+{
+    return m_config;
+}
+
+int LoopbackBus::attach()
+{
+    std::lock_guard<std::mutex> lock(m_nodes_mutex);
+    for (size_t i = 0; i < MAX_NODES; ++i) {
+        if (m_attached[i].load())
+            continue;
+
+        if (!m_tx_queues[i])
+            m_tx_queues[i].reset(new RingBuffer<Message>(
+                        TX_QUEUE_SIZE, RingBuffer<Message>::DROP_NEWEST));
+        m_attached[i].store(true);
+        return i;
+    }
+    return -1;
+}
+
+void LoopbackBus::detach(int node)
+{
+    std::lock_guard<std::mutex> lock(m_nodes_mutex);
+    // Become the arbiter, as it is the only consumer of the TX queues. If
+    // the calling thread paused the bus, it already is
+    bool paused_by_caller = (m_paused_by.load() == std::this_thread::get_id());
+    if (!paused_by_caller)
+        lockArbitration();
+    m_attached[node].store(false);
+    m_has_candidate[node] = false;
+    m_tx_queues[node]->clear();
+    if (paused_by_caller)
+        return;
+    unlockArbitration();
+    arbitrate();
+}
+
+void LoopbackBus::lockArbitration()
+{
+    while (m_arbitrating.exchange(true, std::memory_order_acquire))
+        std::this_thread::yield();
+}
+
+void LoopbackBus::unlockArbitration()
+{
+    m_arbitrating.store(false, std::memory_order_release);
+}
+
+bool LoopbackBus::transmit(int node, Message const& msg)
+{
+    if (!m_tx_queues[node]->push(msg)) {
+        arbitrate();
+        if (!m_tx_queues[node]->push(msg))
+            return false;
+    }
+    arbitrate();
+    return true;
+}
+
+void LoopbackBus::pause()
+{
+    lockArbitration();
+    m_paused_by.store(std::this_thread::get_id());
+}
+
+void LoopbackBus::resume()
+{
+    m_paused_by.store(std::thread::id());
+    unlockArbitration();
+    arbitrate();
+}
+
+void LoopbackBus::arbitrate()
+{
+    while (true) {
+        // If another node is arbitrating, it will transmit our frames
+        if (m_arbitrating.exchange(true, std::memory_order_acquire))
+            return;
+        transmitPending();
+        unlockArbitration();
+
+        // Frames queued after the arbiter's last check but before it
+        // released the flag would otherwise stay in their queue
+        if (!hasPending())
+            return;
+    }
+}
+
+bool LoopbackBus::hasPending() const
+{
+    for (size_t i = 0; i < MAX_NODES; ++i) {
+        if (m_attached[i].load() && !m_tx_queues[i]->empty())
+            return true;
+    }
+    return false;
+}
+
+/** Value of the arbitration field, lower values win
+ *
+ * The 11 bits of a standard ID (or the 11 first bits of an extended ID)
+ * are compared first, then the standard frame's RTR bit against the
+ * extended frame's recessive SRR bit, then the IDE bit.
+ */
+static uint32_t arbitrationKey(uint32_t can_id)
+{
+    uint32_t rtr = (can_id & FLAG_REMOTE_TRANSMISSION_REQUEST) ? 1 : 0;
+    if (can_id & FLAG_EXTENDED_FRAME) {
+        uint32_t id = can_id & 0x1FFFFFFF;
+        return ((id >> 18) << 21) | (1 << 20) | (1 << 19) |
+            ((id & 0x3FFFF) << 1) | rtr;
+    }
+    return ((can_id & 0x7FF) << 21) | (rtr << 20);
+}
+
+void LoopbackBus::transmitPending()
+{
+    while (true) {
+        int winner = -1;
+        uint32_t winner_key = 0;
+        for (size_t i = 0; i < MAX_NODES; ++i) {
+            if (!m_attached[i].load(std::memory_order_relaxed))
+                continue;
+            if (!m_has_candidate[i])
+                m_has_candidate[i] = m_tx_queues[i]->pop(m_candidates[i]);
+            if (!m_has_candidate[i])
+                continue;
+
+            uint32_t key = arbitrationKey(m_candidates[i].can_id);
+            if (winner == -1 || key < winner_key) {
+                winner = i;
+                winner_key = key;
+            }
+        }
+        if (winner == -1)
+            return;
+
+        m_has_candidate[winner] = false;
+        send(winner, m_candidates[winner]);
+    }
+}
+
+/** Duration of a frame in bits, without bit stuffing */
+static uint32_t frameBits(Message const& msg)
+{
+    uint32_t data = (msg.can_id & FLAG_REMOTE_TRANSMISSION_REQUEST) ? 0 : msg.size;
+    uint32_t header = (msg.can_id & FLAG_EXTENDED_FRAME) ? 67 : 47;
+    return header + 8 * data;
+}
+
+/** Error flag, error delimiter and interframe space */
+static const uint32_t ERROR_FRAME_BITS = 6 + 8 + 3;
+
+void LoopbackBus::send(int source, Message msg)
+{
+    uint64_t bits = frameBits(msg);
+    int attempts = 0;
+    while (m_config.error_rate > 0 && random() < m_config.error_rate) {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+        bits += frameBits(msg) + ERROR_FRAME_BITS;
+        if (++attempts > MAX_RETRANSMISSIONS) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    if (m_config.bitrate) {
+        m_bus_time_ns += bits * 1000000000ULL / m_config.bitrate;
+        m_bus_time_us.store(m_bus_time_ns / 1000, std::memory_order_relaxed);
+        msg.time = m_epoch + base::Time::fromMicroseconds(m_bus_time_ns / 1000);
+    }
+    else
+        msg.time = base::Time::now();
+    msg.can_time = msg.time;
+
+    if (m_config.drop_rate > 0 && random() < m_config.drop_rate) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Receivers get the frame the way SocketCAN returns it
+    msg.can_id &= (0x1FFFFFFF | FLAG_REMOTE_TRANSMISSION_REQUEST);
+    publish(source, msg);
+    m_transmitted.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LoopbackBus::publish(int source, Message const& msg)
+{
+    uint64_t position = m_head.load(std::memory_order_relaxed);
+    Slot& slot = m_slots[position & m_mask];
+
+    // Per-slot seqlock. An odd sequence marks a slot being written
+    slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.source = source;
+    slot.msg = msg;
+    slot.sequence.store(2 * position + 2, std::memory_order_release);
+    m_head.store(position + 1, std::memory_order_seq_cst);
+
+    if (m_waiters.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(m_wait_mutex);
+        m_wait_cond.notify_all();
+    }
+}
+
+bool LoopbackBus::receive(uint64_t& position, Message& msg, int& source, uint64_t& dropped) const
+{
+    while (true) {
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        if (position >= head)
+            return false;
+
+        Slot const& slot = m_slots[position & m_mask];
+        uint64_t expected = 2 * position + 2;
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before == expected) {
+            msg = slot.msg;
+            source = slot.source;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+                ++position;
+                return true;
+            }
+        }
+
+        // The slot got overwritten, skip to the oldest frame that is not
+        // about to be
+        uint64_t oldest = head + 1 > m_slots.size() ? head + 1 - m_slots.size() : 0;
+        if (oldest <= position)
+            oldest = position + 1;
+        dropped += oldest - position;
+        position = oldest;
+    }
+}
+
+void LoopbackBus::wait(uint64_t position, base::Time const& deadline)
+{
+    base::Time now = base::Time::now();
+    if (deadline <= now)
+        return;
+
+    std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() +
+        std::chrono::microseconds((deadline - now).toMicroseconds());
+
+    m_waiters.fetch_add(1, std::memory_order_seq_cst);
+    {
+        std::unique_lock<std::mutex> lock(m_wait_mutex);
+        m_wait_cond.wait_until(lock, until, [this, position]() {
+            return m_head.load(std::memory_order_seq_cst) > position;
+        });
+    }
+    m_waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+uint64_t LoopbackBus::getHead() const
+{
+    return m_head.load(std::memory_order_acquire);
+}
+
+base::Time LoopbackBus::getBusTime() const
+{
+    if (!m_config.bitrate)
+        return base::Time();
+    return m_epoch + base::Time::fromMicroseconds(
+            m_bus_time_us.load(std::memory_order_relaxed));
+}
+
+uint64_t LoopbackBus::getTransmittedCount() const
+{
+    return m_transmitted.load(std::memory_order_relaxed);
+}
+
+uint64_t LoopbackBus::getDroppedCount() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+uint64_t LoopbackBus::getErrorCount() const
+{
+    return m_errors.load(std::memory_order_relaxed);
+}
+
+double LoopbackBus::random()
+{
+    // xorshift64*
+    m_random ^= m_random >> 12;
+    m_random ^= m_random << 25;
+    m_random ^= m_random >> 27;
+    uint64_t value = m_random * 2685821657736338717ULL;
+    return (value >> 11) * (1.0 / 9007199254740992.0);
+}
+
+DriverLoopback::DriverLoopback()
+    : m_read_timeout(DEFAULT_TIMEOUT)
+    , m_write_timeout(DEFAULT_TIMEOUT)
+    , m_node(-1)
+    , m_position(0)
+    , m_receive_dropped(0)
+    , m_errors_at_clear(0) {}
+
+DriverLoopback::~DriverLoopback()
+{
+    close();
+}
+
+void DriverLoopback::setReadTimeout(uint32_t timeout)
+{ m_read_timeout = timeout; }
+uint32_t DriverLoopback::getReadTimeout() const
+{ return m_read_timeout; }
+void DriverLoopback::setWriteTimeout(uint32_t timeout)
+{ m_write_timeout = timeout; }
+uint32_t DriverLoopback::getWriteTimeout() const
+{ return m_write_timeout; }
+
+static bool parseConfig(std::string const& options, LoopbackBus::Config& config)
+{
+    std::string::size_type start = 0;
+    while (start < options.size()) {
+        std::string::size_type end = options.find(',', start);
+        if (end == std::string::npos)
+            end = options.size();
+        std::string option = options.substr(start, end - start);
+        start = end + 1;
+
+        std::string::size_type equal = option.find('=');
+        if (equal == std::string::npos)
+            return false;
+        std::string key = option.substr(0, equal);
+        char const* value = option.c_str() + equal + 1;
+        char* value_end;
+        if (key == "bitrate")
+            config.bitrate = strtoul(value, &value_end, 0);
+        else if (key == "drop")
+            config.drop_rate = strtod(value, &value_end);
+        else if (key == "error")
+            config.error_rate = strtod(value, &value_end);
+        else if (key == "seed")
+            config.seed = strtoull(value, &value_end, 0);
+        else if (key == "capacity")
+            config.capacity = strtoul(value, &value_end, 0);
+        else
+            return false;
+        if (*value_end != 0 || value_end == value)
+            return false;
+    }
+    return true;
+}
+
+bool DriverLoopback::open(std::string const& path)
+{
+    std::string::size_type colon = path.find(':');
+    std::string name = path.substr(0, colon);
+    LoopbackBus::Config config;
+    bool has_config = (colon != std::string::npos);
+    if (has_config && !parseConfig(path.substr(colon + 1), config)) {
+        LOG_WARN("DriverLoopback: invalid bus configuration in %s", path.c_str());
+        return false;
+    }
+
+    std::shared_ptr<LoopbackBus> bus = LoopbackBus::get(name, config);
+    if (has_config && !(bus->getConfig() == config)) {
+        LOG_WARN("DriverLoopback: bus %s already exists with a different configuration", name.c_str());
+        return false;
+    }
+    return open(bus);
+}
+
+bool DriverLoopback::open(std::shared_ptr<LoopbackBus> bus)
+{
+    close();
+    int node = bus->attach();
+    if (node == -1)
+        return false;
+
+    m_bus = bus;
+    m_node = node;
+    m_position = bus->getHead();
+    m_receive_dropped = 0;
+    m_errors_at_clear = bus->getErrorCount();
+    return true;
+}
+
+bool DriverLoopback::reset()
+{
+    clear();
+    return isValid();
+}
+
+bool DriverLoopback::receive(Message& msg)
+{
+    int source;
+    while (m_bus->receive(m_position, msg, source, m_receive_dropped)) {
+        if (source != m_node && acceptsMessage(msg))
+            return true;
+    }
+    return false;
+}
+
+Message DriverLoopback::read()
+{
+    Message msg;
+    if (!read(msg))
+        throw TimeoutError(TimeoutError::PACKET, "read(): timeout");
+    return msg;
+}
+
+bool DriverLoopback::read(Message& msg)
+{
+    base::Time deadline = base::Time::now() +
+        base::Time::fromMilliseconds(m_read_timeout);
+    while (true) {
+        if (receive(msg))
+            return true;
+        if (base::Time::now() >= deadline)
+            return false;
+        m_bus->wait(m_position, deadline);
+    }
+}
+
+void DriverLoopback::write(Message const& msg)
+{
+    base::Time deadline;
+    while (!m_bus->transmit(m_node, msg)) {
+        if (deadline.isNull())
+            deadline = base::Time::now() + base::Time::fromMilliseconds(m_write_timeout);
+        else if (base::Time::now() >= deadline)
+            throw TimeoutError(TimeoutError::PACKET, "write(): timeout");
+        std::this_thread::yield();
+    }
+}
+
+int DriverLoopback::getPendingMessagesCount()
+{
+    uint64_t position = m_position;
+    uint64_t dropped = 0;
+    int count = 0;
+    Message msg;
+    int source;
+    while (m_bus->receive(position, msg, source, dropped)) {
+        if (source != m_node && acceptsMessage(msg))
+            ++count;
+    }
+    return count;
+}
+
+bool DriverLoopback::checkBusOk()
+{
+    return m_bus->getErrorCount() == m_errors_at_clear;
+}
+
+void DriverLoopback::clear()
+{
+    if (!m_bus)
+        return;
+    m_position = m_bus->getHead();
+    m_errors_at_clear = m_bus->getErrorCount();
+}
+
+int DriverLoopback::getFileDescriptor() const
+{
+    return iodrivers_base::Driver::INVALID_FD;
+}
+
+bool DriverLoopback::isValid() const
+{
+    return m_bus.get() != NULL;
+}
+
+void DriverLoopback::close()
+{
+    if (!m_bus)
+        return;
+    m_bus->detach(m_node);
+    m_bus.reset();
+    m_node = -1;
+}
+
+uint32_t DriverLoopback::getErrorCount() const
+{
+    return m_bus ? m_bus->getErrorCount() : 0;
+}
+
+uint64_t DriverLoopback::getReceiveDropCount() const
+{
+    return m_receive_dropped;
+}
+
+std::shared_ptr<LoopbackBus> DriverLoopback::getBus() const
+{
+    return m_bus;
+}
@@ -0,0 +1,264 @@
+#ifndef CANBUS_DRIVER_LOOPBACK_HH
+#define CANBUS_DRIVER_LOOPBACK_HH
+
+#include <canbus/Driver.hpp>
+#include <canbus/RingBuffer.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace canbus
+{
+    /** A virtual CAN bus shared by DriverLoopback instances of one process
+     *
+     * Each node queues its frames in its own TX queue. The node that
+     * writes a frame becomes the arbiter if no other node is: it transmits
+     * all queued frames, lowest arbitration field first, into a broadcast
+     * ring. Nodes that could not become the arbiter return immediately,
+     * their frames are transmitted by the current arbiter.
+     *
+     * Every node reads the broadcast ring at its own pace. A node that falls
+     * behind by more than the ring capacity loses the oldest frames.
+     *
+     * When a bitrate is set, frames are timestamped with a virtual bus time
+     * which advances by the duration of each frame (without bit stuffing).
+     * Frames can be randomly dropped, or hit by errors which cost a
+     * retransmission, to test how the code above copes with it. The random
+     * generator is seeded so that runs are reproducible.
+     */
+    class LoopbackBus
+    {
+    public:
+        static const size_t MAX_NODES = 64;
+        static const size_t DEFAULT_CAPACITY = 65536;
+        static const size_t TX_QUEUE_SIZE = 1024;
+        /** How many times a frame hit by an injected error is retransmitted
+         * before being given up
+         */
+        static const int MAX_RETRANSMISSIONS = 16;
+
+        struct Config
+        {
+            /** Bus bitrate in bit/s, 0 to not model the frame durations */
+            uint32_t bitrate;
+            /** Probability that a frame is lost */
+            double drop_rate;
+            /** Probability that a transmission is hit by an error */
+            double error_rate;
+            /** Seed of the random generator used for the injection */
+            uint64_t seed;
+            /** Capacity of the broadcast ring */
+            size_t capacity;
+
+            Config();
+            bool operator == (Config const& other) const;
+        };
+
+        /** Returns the bus with the given name, creating it with the given
+         * configuration if it does not exist yet
+         *
+         * The bus is destroyed when the last node that uses it is
+         */
+        static std::shared_ptr<LoopbackBus> get(std::string const& name,
+                                                Config const& config = Config());
+
+        explicit LoopbackBus(Config const& config);
+
+        Config const& getConfig() const;
+
+        /** Registers a node
+         *
+         * @return the node index, or -1 if MAX_NODES nodes are already
+         *   registered
+         */
+        int attach();
+
+        /** Unregisters a node, discarding its queued frames */
+        void detach(int node);
+
+        /** Queues a frame for transmission and runs the arbitration
+         *
+         * @return false if the node's TX queue is full
+         */
+        bool transmit(int node, Message const& msg);
+
+        /** Stops transmitting frames until resume() is called
+         *
+         * The frames written in the meantime are queued, and compete for
+         * the bus when it resumes. It is meant to test the arbitration.
+         *
+         * The thread that paused the bus may detach nodes (e.g. close
+         * drivers) before resuming it. Other threads that detach a node
+         * wait for resume().
+         */
+        void pause();
+
+        /** Transmits the frames queued since pause() */
+        void resume();
+
+        /** Reads the next frame from the broadcast ring
+         *
+         * @param position the reader's position in the ring. It is advanced
+         *   past the returned frame, or past the frames that were lost
+         * @param source set to the node that sent the frame
+         * @param dropped incremented by the number of frames lost because
+         *   the reader fell behind
+         * @return false if there is no frame after \c position
+         */
+        bool receive(uint64_t& position, Message& msg, int& source, uint64_t& dropped) const;
+
+        /** Waits until a frame is available after \c position, or until
+         * \c deadline
+         */
+        void wait(uint64_t position, base::Time const& deadline);
+
+        /** The position at which a new reader starts */
+        uint64_t getHead() const;
+
+        /** The virtual bus time, or the null time if no bitrate is set */
+        base::Time getBusTime() const;
+
+        /** How many frames have been transmitted */
+        uint64_t getTransmittedCount() const;
+        /** How many frames have been lost, either dropped or given up after
+         * MAX_RETRANSMISSIONS errors
+         */
+        uint64_t getDroppedCount() const;
+        /** How many errors have been injected */
+        uint64_t getErrorCount() const;
+
+    private:
+        struct Slot
+        {
+            std::atomic<uint64_t> sequence;
+            int source;
+            Message msg;
+        };
+
+        Config m_config;
+        std::vector<Slot> m_slots;
+        uint64_t m_mask;
+        std::atomic<uint64_t> m_head;
+
+        std::mutex m_nodes_mutex;
+        std::atomic<bool> m_attached[MAX_NODES];
+        std::unique_ptr<RingBuffer<Message>> m_tx_queues[MAX_NODES];
+
+        /** Whether a node is currently running the arbitration */
+        std::atomic<bool> m_arbitrating;
+        /** The thread that called pause(), if the bus is paused */
+        std::atomic<std::thread::id> m_paused_by;
+        /** Owned by the arbiter: the frame each node is competing with */
+        Message m_candidates[MAX_NODES];
+        bool m_has_candidate[MAX_NODES];
+        uint64_t m_random;
+        base::Time m_epoch;
+        uint64_t m_bus_time_ns;
+
+        std::atomic<uint64_t> m_bus_time_us;
+        std::atomic<uint64_t> m_transmitted;
+        std::atomic<uint64_t> m_dropped;
+        std::atomic<uint64_t> m_errors;
+
+        std::mutex m_wait_mutex;
+        std::condition_variable m_wait_cond;
+        std::atomic<int> m_waiters;
+
+        void arbitrate();
+        void transmitPending();
+        bool hasPending() const;
+        void send(int source, Message msg);
+        void publish(int source, Message const& msg);
+        double random();
+        void lockArbitration();
+        void unlockArbitration();
+    };
+
+    /** Driver connected to an in-process LoopbackBus
+     *
+     * The path given to open() is the bus name, optionally followed by the
+     * bus configuration, e.g. bus0:bitrate=500000,drop=0.001,error=0.01,seed=1.
+     * The configuration is applied when the bus is created by the first
+     * node. A node that specifies a different one fails to open.
+     *
+     * As with SocketCAN, a node does not receive the frames it sent.
+     */
+    class DriverLoopback : public Driver
+    {
+    public:
+        DriverLoopback();
+        ~DriverLoopback();
+
+        bool open(std::string const& path);
+
+        /** Opens a node on the given bus */
+        bool open(std::shared_ptr<LoopbackBus> bus);
+
+        bool resetBoard() { return true; }
+        bool reset();
+
+        void     setWriteTimeout(uint32_t timeout);
+        uint32_t getWriteTimeout() const;
+        void     setReadTimeout(uint32_t timeout);
+        uint32_t getReadTimeout() const;
+
+        Message read();
+
+        /** Reads the next message. It is guaranteed to not block longer
+         * than the timeout provided by setReadTimeout().
+         *
+         * @param msg   The Message will be put here, if any
+         * @return   true if msg was filled in, false on timeout.
+         */
+        bool read(Message& msg);
+
+        /** Queues a message on the bus. It only blocks, up to the write
+         * timeout, if the node's TX queue is full
+         */
+        void write(Message const& msg);
+
+        int getPendingMessagesCount();
+
+        /** Returns false if errors were injected on the bus since the last
+         * call to clear()
+         */
+        bool checkBusOk();
+
+        void clear();
+
+        /** Returns INVALID_FD, as the bus has no file descriptor */
+        int getFileDescriptor() const;
+
+        bool isValid() const;
+        void close();
+
+        /** The number of errors injected on the bus */
+        uint32_t getErrorCount() const;
+
+        /** How many frames this node lost because it did not read them fast
+         * enough
+         */
+        uint64_t getReceiveDropCount() const;
+
+        /** The bus this node is attached to, or NULL */
+        std::shared_ptr<LoopbackBus> getBus() const;
+
+    private:
+        uint32_t m_read_timeout;
+        uint32_t m_write_timeout;
+
+        std::shared_ptr<LoopbackBus> m_bus;
+        int m_node;
+        uint64_t m_position;
+        uint64_t m_receive_dropped;
+        uint64_t m_errors_at_clear;
+
+        bool receive(Message& msg);
+    };
+}
+
+#endif
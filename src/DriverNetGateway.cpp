@@ -6,9 +6,14 @@
  */
 
 #include <string.h>
-#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
 #include <canbus/DriverNetGateway.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <iodrivers_base/IOStream.hpp>
 #include <base/Time.hpp>
+#include <stdexcept>
 
 
 #define CAN_EFF_FLAG 0x80000000U /* EFF/SFF is set in the MSB */
@@ -28,14 +33,27 @@ DriverNetGateway::DriverNetGateway()
     : iodrivers_base::Driver(sizeof(CanFrame))
     , mErrorCounter(0)
     , mError(false)
+    , mRxBuffer(RX_BUFFER_SIZE)
+    , mRxSize(0)
+    , mRxStream(nullptr)
+    , mRxDatagrams(false)
+    , mTxWindow(0)
+    , mTxFrameCount(0)
+    , mTxWriteCount(0)
 {
+    mTxBuffer.reserve(TX_BUFFER_SIZE);
     m_read_timeout = base::Time::fromMilliseconds(DEFAULT_TIMEOUT);
     m_write_timeout = base::Time::fromMilliseconds(DEFAULT_TIMEOUT);
 }
 
 bool DriverNetGateway::open(std::string const& path)
 {
+    mRxStream = nullptr;
     openURI(path);
+
+    // Fails harmlessly on UDP
+    int nodelay = 1;
+    setsockopt(getFileDescriptor(), IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
     return true;
 }
 
@@ -47,67 +65,212 @@ int DriverNetGateway::extractPacket(uint8_t const* buffer, size_t buffer_size) c
         return -buffer_size;
 }
 
-void DriverNetGateway::readOneMessage()
+void DriverNetGateway::handleFrame(CanFrame const& frame, base::Time const& time)
 {
-    CanFrame    frame;
-    if (readPacket(reinterpret_cast<uint8_t*>(&frame), sizeof(CanFrame)) == sizeof(CanFrame)) {
-        if (frame.can_id & CAN_ERR_FLAG) {
-            if (frame.can_id & CAN_ERR_MASK) {
-                mErrorCounter++;
-                mError = true;
-            } else {
-                mError = false;
-            }
+    if (frame.can_id & CAN_ERR_FLAG) {
+        if (frame.can_id & CAN_ERR_MASK) {
+            mErrorCounter++;
+            mError = true;
         } else {
-            Message msg;
-            msg.time = base::Time::now();
-            msg.can_time = msg.time;
-            msg.can_id = frame.can_id;
-            memcpy(msg.data, frame.data, 8);
-            msg.size = frame.can_dlc;
-            rx_queue.push_back(msg);
+            mError = false;
         }
+    } else {
+        Message msg;
+        msg.time = time;
+        msg.can_time = time;
+        msg.can_id = frame.can_id;
+        memcpy(msg.data, frame.data, 8);
+        msg.size = frame.can_dlc;
+        if (acceptsMessage(msg))
+            rx_queue.push(msg);
     }
 }
 
+void DriverNetGateway::decodeFrames()
+{
+    // All the frames received in one read are given the same timestamp
+    base::Time time = base::Time::now();
+    size_t offset = 0;
+    for (; offset + sizeof(CanFrame) <= mRxSize; offset += sizeof(CanFrame)) {
+        CanFrame frame;
+        memcpy(&frame, &mRxBuffer[offset], sizeof(CanFrame));
+        handleFrame(frame, time);
+    }
+
+    // Keep the partial frame at the end for the next read
+    mRxSize -= offset;
+    memmove(&mRxBuffer[0], &mRxBuffer[offset], mRxSize);
+}
+
+bool DriverNetGateway::isDatagramStream(iodrivers_base::IOStream* stream)
+{
+    if (stream != mRxStream) {
+        int type = 0;
+        socklen_t size = sizeof(type);
+        mRxStream = stream;
+        mRxDatagrams =
+            getsockopt(getFileDescriptor(), SOL_SOCKET, SO_TYPE, &type, &size) == 0 &&
+            type == SOCK_DGRAM;
+    }
+    return mRxDatagrams;
+}
+
 int DriverNetGateway::bufferMessages()
 {
-    int bytes;
-    if (ioctl(getFileDescriptor(), FIONREAD, &bytes) == 0) {
-        for (size_t i = 0; i < bytes / sizeof(CanFrame); i++) {
-            readOneMessage();
-        }
+    flushIfDue();
+
+    iodrivers_base::IOStream* stream = getMainStream();
+    if (!stream)
+        return rx_queue.size();
+
+    // Over TCP, a read that fills the buffer may have left data in the
+    // socket, read again in this case. Over UDP, each read returns one
+    // datagram, read until there are none left
+    bool datagrams = isDatagramStream(stream);
+    while (true) {
+        size_t space = mRxBuffer.size() - mRxSize;
+        size_t received = stream->read(&mRxBuffer[mRxSize], space);
+        if (received == 0)
+            break;
+
+        mRxSize += received;
+        decodeFrames();
+        if (datagrams)
+            mRxSize = 0; // the rest of a datagram is not the start of a frame
+        else if (received < space)
+            break;
     }
     return rx_queue.size();
 }
 
-Message DriverNetGateway::read()
+bool DriverNetGateway::waitForMessages(base::Time const& timeout)
 {
-    while (rx_queue.empty()) {
-        readOneMessage();
+    iodrivers_base::IOStream* stream = getMainStream();
+    if (!stream)
+        throw std::runtime_error("DriverNetGateway::read(): driver is not open");
+
+    base::Time deadline = base::Time::now() + timeout;
+    while (bufferMessages() == 0) {
+        base::Time now = base::Time::now();
+        if (now >= deadline)
+            return false;
+
+        // Wake up in time to send the coalesced frames
+        base::Time wakeup = deadline;
+        if (!mTxBuffer.empty() && mTxDeadline < wakeup)
+            wakeup = mTxDeadline;
+
+        try { stream->waitRead(wakeup > now ? wakeup - now : base::Time()); }
+        catch(iodrivers_base::TimeoutError&) {}
     }
-    Message result = rx_queue.front();
-    rx_queue.pop_front();
-    return result;
+    return true;
 }
 
+Message DriverNetGateway::read()
+{
+    Message result;
+    if (!read(result))
+        throw iodrivers_base::TimeoutError(iodrivers_base::TimeoutError::PACKET,
+                "DriverNetGateway::read(): timeout");
+    return result;
+}
 
 bool DriverNetGateway::read(Message& msg)
 {
-    if (bufferMessages() == 0)
+    flushIfDue();
+    if (rx_queue.empty() && !waitForMessages(iodrivers_base::Driver::getReadTimeout()))
         return false;
-    msg = read();
+
+    rx_queue.pop(msg);
     return true;
 }
 
-void DriverNetGateway::write(const Message& msg)
+static CanFrame toCanFrame(Message const& msg)
 {
     CanFrame frame;
-
+    memset(&frame, 0, sizeof(frame));
     frame.can_id = msg.can_id;
     frame.can_dlc = msg.size;
     memcpy(frame.data, msg.data, 8);
-    writePacket(reinterpret_cast<uint8_t*>(&frame), sizeof(frame));
+    return frame;
+}
+
+void DriverNetGateway::write(const Message& msg)
+{
+    mTxBuffer.push_back(toCanFrame(msg));
+    if (mTxWindow == 0 || mTxBuffer.size() == TX_BUFFER_SIZE) {
+        flush();
+        return;
+    }
+
+    base::Time now = base::Time::now();
+    if (mTxBuffer.size() == 1)
+        mTxDeadline = now + base::Time::fromMicroseconds(mTxWindow);
+    else if (now >= mTxDeadline)
+        flush();
+}
+
+size_t DriverNetGateway::writeBatch(Message const* msgs, size_t count)
+{
+    size_t sent = 0;
+    for (size_t i = 0; i < count; ++i) {
+        mTxBuffer.push_back(toCanFrame(msgs[i]));
+        if (mTxBuffer.size() == TX_BUFFER_SIZE || i == count - 1) {
+            try { flush(); }
+            catch(iodrivers_base::TimeoutError&) { return sent; }
+            sent = i + 1;
+        }
+    }
+    return count;
+}
+
+void DriverNetGateway::flushIfDue()
+{
+    if (!mTxBuffer.empty() && base::Time::now() >= mTxDeadline)
+        flush();
+}
+
+void DriverNetGateway::flush()
+{
+    if (mTxBuffer.empty())
+        return;
+
+    // The frames are dropped if the write fails, as they would be without
+    // coalescing
+    size_t count = mTxBuffer.size();
+    try {
+        writePacket(reinterpret_cast<uint8_t const*>(mTxBuffer.data()),
+                count * sizeof(CanFrame));
+    }
+    catch(...) {
+        mTxBuffer.clear();
+        throw;
+    }
+    mTxBuffer.clear();
+    mTxFrameCount += count;
+    mTxWriteCount++;
+}
+
+void DriverNetGateway::setTxCoalescingWindow(uint32_t window_us)
+{
+    mTxWindow = window_us;
+    if (mTxWindow == 0)
+        flush();
+}
+
+uint32_t DriverNetGateway::getTxCoalescingWindow() const
+{
+    return mTxWindow;
+}
+
+uint64_t DriverNetGateway::getTxFrameCount() const
+{
+    return mTxFrameCount;
+}
+
+uint64_t DriverNetGateway::getTxWriteCount() const
+{
+    return mTxWriteCount;
 }
 
 int DriverNetGateway::getPendingMessagesCount()
@@ -140,6 +303,10 @@ bool DriverNetGateway::isValid() const
 
 void DriverNetGateway::close()
 {
+    if (isValid())
+        flush();
+    mTxBuffer.clear();
+    mRxStream = nullptr;
     iodrivers_base::Driver::close();
 }
 
@@ -148,6 +315,17 @@ uint32_t DriverNetGateway::getErrorCount() const
     return mErrorCounter;
 }
 
+void DriverNetGateway::setReceiveQueueSize(size_t capacity,
+        RingBuffer<Message>::OVERFLOW_POLICY policy)
+{
+    rx_queue.reset(capacity, policy);
+}
+
+uint64_t DriverNetGateway::getReceiveQueueDropCount() const
+{
+    return rx_queue.getDroppedCount();
+}
+
 void DriverNetGateway::setWriteTimeout(uint32_t timeout)
 {
     iodrivers_base::Driver::setWriteTimeout(base::Time::fromMilliseconds(timeout));
@@ -174,6 +352,7 @@ bool DriverNetGateway::reset()
     frame.can_id = CAN_ERR_FLAG | CAN_ERR_RESTARTED;
     frame.can_dlc = 8;
     memset(frame.data, 0, 8);
+    flush();
     writePacket(reinterpret_cast<uint8_t*>(&frame), sizeof(frame));
     return true;
 }
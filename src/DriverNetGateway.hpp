@@ -8,10 +8,11 @@
 #ifndef CANBUS_NETGW_HH
 #define CANBUS_NETGW_HH
 
-#include <deque>
 #include <canbus/Message.hpp>
 #include <canbus/Driver.hpp>
+#include <canbus/RingBuffer.hpp>
 #include <iodrivers_base/Driver.hpp>
+#include <vector>
 
 namespace canbus
 {
@@ -23,30 +24,72 @@ namespace canbus
     };
 
 
-    /*
+    /** Driver for the CAN-to-Ethernet gateways, over TCP or UDP
      *
+     * With a TX coalescing window (see setTxCoalescingWindow), written
+     * frames are buffered and the driver has no timer to send them: a
+     * frame written last stays in the buffer until the application calls
+     * flush() or keeps calling the driver's read or write methods.
      */
     class DriverNetGateway : public iodrivers_base::Driver, public Driver
     {
         uint32_t mErrorCounter;
         bool    mError;
 
-        std::deque<Message> rx_queue;
+        RingBuffer<Message> rx_queue;
+
+        /** Bytes received from the gateway. Only the first mRxSize bytes,
+         * the beginning of a partially received CanFrame, are valid between
+         * two calls to bufferMessages()
+         */
+        std::vector<uint8_t> mRxBuffer;
+        size_t mRxSize;
+        /** The stream whose socket type is cached in mRxDatagrams */
+        iodrivers_base::IOStream* mRxStream;
+        /** Whether the gateway is read over UDP, each read then returning
+         * one datagram made of whole frames
+         */
+        bool mRxDatagrams;
+
+        /** Frames written but not sent yet */
+        std::vector<CanFrame> mTxBuffer;
+        uint32_t mTxWindow;
+        /** When the frames in mTxBuffer must be sent at the latest */
+        base::Time mTxDeadline;
+        uint64_t mTxFrameCount;
+        uint64_t mTxWriteCount;
 
 
         int extractPacket(uint8_t const* buffer, size_t buffer_size) const;
 
-        void readOneMessage();
+        void handleFrame(CanFrame const& frame, base::Time const& time);
+        void decodeFrames();
+        bool isDatagramStream(iodrivers_base::IOStream* stream);
         int bufferMessages();
+        void flushIfDue();
+        /** Waits up to \c timeout for messages to be queued
+         *
+         * @return false on timeout
+         */
+        bool waitForMessages(base::Time const& timeout);
 
     public:
         static const int DEFAULT_TIMEOUT = 100;
+        /** How many bytes are read from the gateway at most per system call
+         */
+        static const size_t RX_BUFFER_SIZE = 1024 * sizeof(CanFrame);
+        /** How many frames are sent at most per system call */
+        static const size_t TX_BUFFER_SIZE = 64;
 
 
         DriverNetGateway();
 
         /** Opens the given device and resets the CAN interface. It returns
          * true if the initialization was successful and false otherwise
+         *
+         * TCP connections are opened with TCP_NODELAY, so that Nagle's
+         * algorithm never delays the frames. Use setTxCoalescingWindow to
+         * send several frames per segment instead.
          */
         bool open(std::string const& path);
 
@@ -84,6 +127,8 @@ namespace canbus
          * timeout provided by setReadTimeout().
          *
          * The default timeout value is given by DEFAULT_TIMEOUT
+         *
+         * @throw iodrivers_base::TimeoutError if no message arrived in time
          */
         Message read();
 
@@ -92,6 +137,9 @@ namespace canbus
          *
          * The default timeout value is given by DEFAULT_TIMEOUT
          *
+         * If no message is queued, it sleeps until the gateway's socket is
+         * readable, and then reads everything available.
+         *
          * @param msg   The Message will be put here, if any
          * @return   true if msg was filled in, false on timeout.
          */
@@ -101,9 +149,54 @@ namespace canbus
          * timeout provided in setWriteTimeout().
          *
          * The default timeout value is given by DEFAULT_TIMEOUT
+         *
+         * If a coalescing window is set, the message is only buffered (see
+         * setTxCoalescingWindow)
          */
         void write(Message const& msg);
 
+        /** Sends the messages together with the buffered ones, up to
+         * TX_BUFFER_SIZE frames per system call, regardless of the
+         * coalescing window
+         */
+        size_t writeBatch(Message const* msgs, size_t count);
+
+        /** Sets how long write() may keep a frame to send it together with
+         * the following ones, in microseconds. 0 (the default) sends each
+         * frame right away.
+         *
+         * The driver has no thread of its own: the buffered frames are sent
+         * by the first call to write(), read(), getPendingMessagesCount()
+         * or checkBusOk() made after the window of the oldest one elapsed,
+         * when TX_BUFFER_SIZE frames are buffered, or by flush(). Call
+         * flush() at the end of a burst to not wait for the window.
+         *
+         * The window is therefore not an upper bound: if none of these
+         * methods is called, a lone frame stays buffered indefinitely.
+         * Callers that only write occasionally must call flush(), or keep
+         * reading from the driver.
+         *
+         * Over UDP, this puts several frames in a datagram, which the
+         * gateway must support.
+         */
+        void setTxCoalescingWindow(uint32_t window_us);
+
+        uint32_t getTxCoalescingWindow() const;
+
+        /** Sends the buffered frames
+         *
+         * @see setTxCoalescingWindow
+         */
+        void flush();
+
+        /** How many frames have been sent */
+        uint64_t getTxFrameCount() const;
+
+        /** How many system calls were used to send them. The ratio of the
+         * two is the number of frames per system call
+         */
+        uint64_t getTxWriteCount() const;
+
         /** Returns the number of messages queued in the board's RX queue
          */
         int getPendingMessagesCount();
@@ -127,11 +220,24 @@ namespace canbus
         /** True if a valid file descriptor is assigned to this object */
         bool isValid() const;
 
-        /** Closes the file descriptor */
+        /** Sends the buffered frames and closes the file descriptor */
         void close();
 
         virtual uint32_t getErrorCount() const;
 
+        /** Sets the capacity of the receive queue, and whether the oldest or
+         * the newest message is dropped when it overflows
+         *
+         * This discards the messages currently queued
+         */
+        void setReceiveQueueSize(size_t capacity,
+                RingBuffer<Message>::OVERFLOW_POLICY policy = RingBuffer<Message>::DROP_OLDEST);
+
+        /** How many received messages have been dropped because the receive
+         * queue was full
+         */
+        uint64_t getReceiveQueueDropCount() const;
+
 
 
     };
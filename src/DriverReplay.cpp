@@ -0,0 +1,184 @@
+#include <canbus/DriverReplay.hpp>
+#include <iodrivers_base/Driver.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <limits>
+
+using namespace canbus;
+using iodrivers_base::TimeoutError;
+
+const double DriverReplay::SPEED_MAX = std::numeric_limits<double>::infinity();
+
+DriverReplay::DriverReplay()
+    : m_read_timeout(DEFAULT_TIMEOUT)
+    , m_write_timeout(DEFAULT_TIMEOUT)
+    , m_speed(1)
+    , m_next(NULL) {}
+
+void DriverReplay::setReadTimeout(uint32_t timeout)
+{ m_read_timeout = timeout; }
+uint32_t DriverReplay::getReadTimeout() const
+{ return m_read_timeout; }
+void DriverReplay::setWriteTimeout(uint32_t timeout)
+{ m_write_timeout = timeout; }
+uint32_t DriverReplay::getWriteTimeout() const
+{ return m_write_timeout; }
+
+bool DriverReplay::open(std::string const& path)
+{
+    std::string::size_type colon = path.rfind(':');
+    if (colon == std::string::npos)
+        return open(path, 1);
+
+    std::string file = path.substr(0, colon);
+    std::string speed = path.substr(colon + 1);
+    if (speed == "max")
+        return open(file, SPEED_MAX);
+
+    char* end;
+    double factor = strtod(speed.c_str(), &end);
+    if (speed.empty() || *end != 0)
+        return open(path, 1);
+    else if (factor <= 0)
+        return false;
+    return open(file, factor);
+}
+
+bool DriverReplay::open(std::string const& path, double speed)
+{
+    if (speed <= 0)
+        return false;
+    if (!m_reader.open(path))
+        return false;
+
+    m_speed = speed;
+    return reset();
+}
+
+double DriverReplay::getSpeed() const
+{
+    return m_speed;
+}
+
+bool DriverReplay::reset()
+{
+    m_reader.rewind();
+    m_next = NULL;
+    m_start = base::Time();
+    m_log_start = base::Time();
+    return isValid();
+}
+
+bool DriverReplay::peek()
+{
+    if (m_next)
+        return true;
+
+    while (LogRecord const* record = m_reader.next()) {
+        if (!m_filters.accepts(record->can_id))
+            continue;
+
+        m_next = record;
+        if (m_start.isNull()) {
+            m_start = base::Time::now();
+            m_log_start = base::Time::fromMicroseconds(record->time);
+        }
+        return true;
+    }
+    return false;
+}
+
+base::Time DriverReplay::getDueTime(LogRecord const& record) const
+{
+    int64_t offset = record.time - m_log_start.toMicroseconds();
+    if (offset <= 0)
+        return m_start;
+    return m_start + base::Time::fromMicroseconds(static_cast<int64_t>(offset / m_speed));
+}
+
+static void sleepFor(base::Time const& duration)
+{
+    int64_t us = duration.toMicroseconds();
+    struct timespec ts;
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
+}
+
+Message DriverReplay::read()
+{
+    base::Time deadline = base::Time::now() +
+        base::Time::fromMilliseconds(m_read_timeout);
+    while (true) {
+        if (!peek())
+            throw TimeoutError(TimeoutError::PACKET, "read(): end of log");
+
+        if (m_speed == SPEED_MAX) {
+            Message msg = m_next->toMessage();
+            m_next = NULL;
+            return msg;
+        }
+
+        base::Time due = getDueTime(*m_next);
+        base::Time now = base::Time::now();
+        if (due <= now) {
+            Message msg = m_next->toMessage();
+            msg.can_time = msg.time;
+            msg.time = due;
+            m_next = NULL;
+            return msg;
+        }
+        if (deadline <= now)
+            throw TimeoutError(TimeoutError::PACKET, "read(): timeout");
+
+        sleepFor((due < deadline ? due : deadline) - now);
+    }
+}
+
+void DriverReplay::write(Message const&)
+{
+}
+
+int DriverReplay::getPendingMessagesCount()
+{
+    if (!peek())
+        return 0;
+    if (m_speed == SPEED_MAX)
+        return 1;
+    return getDueTime(*m_next) <= base::Time::now() ? 1 : 0;
+}
+
+bool DriverReplay::checkBusOk()
+{
+    return true;
+}
+
+void DriverReplay::clear()
+{
+    while (getPendingMessagesCount() > 0)
+        m_next = NULL;
+}
+
+bool DriverReplay::isFinished()
+{
+    return !peek();
+}
+
+int DriverReplay::getFileDescriptor() const
+{
+    return iodrivers_base::Driver::INVALID_FD;
+}
+
+bool DriverReplay::isValid() const
+{
+    return m_reader.isValid();
+}
+
+void DriverReplay::close()
+{
+    m_reader.close();
+    m_next = NULL;
+}
@@ -0,0 +1,104 @@
+#ifndef CANBUS_DRIVER_REPLAY_HH
+#define CANBUS_DRIVER_REPLAY_HH
+
+#include <canbus/Driver.hpp>
+#include <canbus/LogFile.hpp>
+#include <string>
+
+namespace canbus
+{
+    /** Plays back a log recorded with canbus-log (see LogWriter)
+     *
+     * The path given to open() is the log file, optionally followed by a
+     * speed factor or by the max keyword:
+     *
+     * - file.log plays the log back with its original timing
+     * - file.log:2.5 plays it 2.5 times faster than it was recorded
+     * - file.log:max returns the messages as fast as possible
+     *
+     * When playing back with timing, Message::time is the time at which the
+     * message is played back, and Message::can_time its original
+     * Message::time. In the max mode, both are the recorded timestamps.
+     *
+     * Written messages are discarded. The driver has no file descriptor.
+     */
+    class DriverReplay : public Driver
+    {
+    public:
+        /** Speed factor used for the max mode */
+        static const double SPEED_MAX;
+
+        DriverReplay();
+
+        bool open(std::string const& path);
+
+        /** Opens the given log
+         *
+         * @param speed the playback speed factor, or SPEED_MAX to play the
+         *   log back as fast as possible
+         */
+        bool open(std::string const& path, double speed);
+
+        /** The playback speed factor, SPEED_MAX in the max mode */
+        double getSpeed() const;
+
+        bool resetBoard() { return true; }
+
+        /** Restarts the playback from the beginning of the log */
+        bool reset();
+
+        void     setWriteTimeout(uint32_t timeout);
+        uint32_t getWriteTimeout() const;
+        void     setReadTimeout(uint32_t timeout);
+        uint32_t getReadTimeout() const;
+
+        /** Returns the next message of the log once it is due. It is
+         * guaranteed to not block longer than the timeout provided by
+         * setReadTimeout().
+         *
+         * It throws TimeoutError at the end of the log as well.
+         */
+        Message read();
+
+        /** Discards the message */
+        void write(Message const& msg);
+
+        /** Returns 1 if the next message of the log is due, and 0 otherwise
+         */
+        int getPendingMessagesCount();
+
+        bool checkBusOk();
+
+        /** Skips all messages that are due */
+        void clear();
+
+        /** Returns INVALID_FD, as there is nothing to wait on */
+        int getFileDescriptor() const;
+
+        bool isValid() const;
+        void close();
+
+        /** Whether all messages of the log have been returned */
+        bool isFinished();
+
+    private:
+        uint32_t m_read_timeout;
+        uint32_t m_write_timeout;
+        double m_speed;
+
+        LogReader m_reader;
+        /** The next accepted record, or NULL if it has not been read yet */
+        LogRecord const* m_next;
+
+        /** Wall time at which the playback started, and the recorded time it
+         * corresponds to
+         */
+        base::Time m_start;
+        base::Time m_log_start;
+
+        bool peek();
+        base::Time getDueTime(LogRecord const& record) const;
+    };
+}
+
+#endif
@@ -8,11 +8,16 @@
 #include <linux/can.h>
 #include <linux/can/raw.h>
 #include <linux/can/error.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
 #include <stdio.h>
 #include <poll.h>
 #include <errno.h>
+#include <algorithm>
+#include <vector>
 
 //#include <iodrivers_base.hh>
 
@@ -21,27 +26,105 @@ using iodrivers_base::UnixError;
 using iodrivers_base::TimeoutError;
 using iodrivers_base::Timeout;
 
+/** Receive buffers for recvmmsg()
+ *
+ * The iovecs and control buffers are bound to the message headers once, at
+ * construction time. Only the fields the kernel modifies need to be reset
+ * between two calls.
+ */
+struct DriverSocket::RxBatch
+{
+    /** Room for the control messages (timestamps) of a single frame */
+    union Control {
+        struct cmsghdr align;
+        char buffer[128];
+    };
+
+    /** The frames, each taking \c mtu bytes. Sockets that do not receive CAN
+     * FD frames only need room for classic ones
+     */
+    std::vector<uint64_t> storage;
+    size_t mtu;
+    std::vector<struct iovec> iovecs;
+    std::vector<Control> controls;
+    std::vector<struct mmsghdr> headers;
+    /** How many headers have been filled by the last recvmmsg() call */
+    size_t used;
+
+    RxBatch(size_t size, size_t mtu)
+        : storage(size * mtu / sizeof(uint64_t))
+        , mtu(mtu)
+        , iovecs(size)
+        , controls(size)
+        , headers(size)
+        , used(size)
+    {
+        memset(headers.data(), 0, sizeof(struct mmsghdr) * size);
+        for (size_t i = 0; i < size; ++i) {
+            iovecs[i].iov_base = &frame(i);
+            iovecs[i].iov_len = mtu;
+            headers[i].msg_hdr.msg_iov = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+            headers[i].msg_hdr.msg_control = controls[i].buffer;
+        }
+    }
+
+    size_t size() const
+    {
+        return headers.size();
+    }
+
+    /** The i-th frame. Only its first CAN_MTU bytes are valid if the
+     * batch has been allocated for classic frames
+     */
+    struct canfd_frame& frame(size_t i)
+    {
+        return *reinterpret_cast<struct canfd_frame*>(
+                reinterpret_cast<char*>(storage.data()) + i * mtu);
+    }
+
+    /** Reset the fields modified by the kernel on the last recvmmsg() call */
+    void rearm()
+    {
+        for (size_t i = 0; i < used; ++i) {
+            headers[i].msg_hdr.msg_controllen = sizeof(controls[i].buffer);
+            headers[i].msg_hdr.msg_flags = 0;
+        }
+        used = 0;
+    }
+};
+
 DriverSocket::DriverSocket()
     : m_read_timeout(DEFAULT_TIMEOUT)
     , m_write_timeout(DEFAULT_TIMEOUT)
     , m_fd(-1)
+    , m_rx_batch(new RxBatch(DEFAULT_RX_BATCH_SIZE, CAN_MTU))
+    , m_rx_calls(0)
+    , m_rx_frames(0)
+    , m_fd_frames(false)
+    , m_fd_requested(false)
     , m_error(false)
-    , err_counter(0){}
+    , err_counter(0)
+    , m_timestamp_mode(TIMESTAMP_SOFTWARE){}
+
+DriverSocket::~DriverSocket()
+{
+}
 
 bool DriverSocket::reset()
 {
     err_counter=0;
-    return DriverSocket::reset(m_fd); 
+    return DriverSocket::reset(m_fd, getFilters(), m_timestamp_mode);
 }
-bool DriverSocket::reset(int fd)
+bool DriverSocket::reset(int fd, std::vector<Filter> const& filters, TIMESTAMP_MODE mode)
 {
-    int on = 1;
-    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, &on,
-                   sizeof(on)) != 0) {
-        perror("setsockopt");
+    if (!setTimestampMode(fd, mode))
         return false;
-    }
+    return setErrorMaskAndFilters(fd, filters);
+}
 
+bool DriverSocket::setErrorMaskAndFilters(int fd, std::vector<Filter> const& filters)
+{
     //CAN_ERR_CTRL is not requested because those are mostly long-term
     //bus quality flags
     can_err_mask_t err_mask = ( CAN_ERR_TX_TIMEOUT |
@@ -62,6 +145,83 @@ bool DriverSocket::reset(int fd)
         perror("setsockopt");
         return false;
     }
+    return setFilters(fd, filters);
+}
+
+bool DriverSocket::setTimestampMode(int fd, TIMESTAMP_MODE& mode)
+{
+    if (mode == TIMESTAMP_HARDWARE) {
+        int flags = SOF_TIMESTAMPING_RX_HARDWARE |
+                    SOF_TIMESTAMPING_RAW_HARDWARE |
+                    SOF_TIMESTAMPING_RX_SOFTWARE |
+                    SOF_TIMESTAMPING_SOFTWARE;
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags,
+                       sizeof(flags)) == 0)
+            return true;
+        mode = TIMESTAMP_SOFTWARE_NS;
+    }
+
+    int on = 1;
+    if (mode == TIMESTAMP_SOFTWARE_NS) {
+        if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on,
+                       sizeof(on)) == 0)
+            return true;
+        mode = TIMESTAMP_SOFTWARE;
+    }
+
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, &on,
+                   sizeof(on)) != 0) {
+        perror("setsockopt");
+        return false;
+    }
+    return true;
+}
+
+/** Asks the adapter to timestamp all received frames
+ *
+ * Not all CAN drivers implement SIOCSHWTSTAMP, some timestamp
+ * unconditionally. Errors are therefore ignored, the frames simply come
+ * without hardware timestamps if the adapter does not provide them.
+ */
+static void enableHardwareTimestamps(int fd, struct ifreq ifr)
+{
+    struct hwtstamp_config config;
+    memset(&config, 0, sizeof(config));
+    config.tx_type = HWTSTAMP_TX_OFF;
+    config.rx_filter = HWTSTAMP_FILTER_ALL;
+    ifr.ifr_data = reinterpret_cast<char*>(&config);
+    ioctl(fd, SIOCSHWTSTAMP, &ifr);
+}
+
+bool DriverSocket::setFilters(std::vector<Filter> const& filters)
+{
+    m_filters = FilterSet(filters);
+    if (!isValid())
+        return true;
+    return setFilters(m_fd, filters);
+}
+
+bool DriverSocket::setFilters(int fd, std::vector<Filter> const& filters)
+{
+    std::vector<struct can_filter> raw;
+    for (size_t i = 0; i < filters.size(); ++i) {
+        struct can_filter f;
+        f.can_id = filters[i].id;
+        if (filters[i].inverted)
+            f.can_id |= CAN_INV_FILTER;
+        f.can_mask = filters[i].mask;
+        raw.push_back(f);
+    }
+    if (raw.empty()) {
+        struct can_filter accept_all = { 0, 0 };
+        raw.push_back(accept_all);
+    }
+
+    if (setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FILTER, raw.data(),
+                   raw.size() * sizeof(struct can_filter)) != 0) {
+        perror("setsockopt");
+        return false;
+    }
     return true;
 }
 
@@ -73,8 +233,46 @@ void DriverSocket::setWriteTimeout(uint32_t timeout)
 { m_write_timeout = timeout; }
 uint32_t DriverSocket::getWriteTimeout() const
 { return m_write_timeout; }
+void DriverSocket::setReceiveBatchSize(size_t size)
+{ m_rx_batch.reset(new RxBatch(std::max<size_t>(size, 1), m_fd_frames ? CANFD_MTU : CAN_MTU)); }
+size_t DriverSocket::getReceiveBatchSize() const
+{ return m_rx_batch->size(); }
+uint64_t DriverSocket::getRxCallCount() const
+{ return m_rx_calls; }
+uint64_t DriverSocket::getRxFrameCount() const
+{ return m_rx_frames; }
+void DriverSocket::setReceiveQueueSize(size_t capacity,
+        RingBuffer<Message>::OVERFLOW_POLICY policy)
+{ rx_queue.reset(capacity, policy); }
+uint64_t DriverSocket::getReceiveQueueDropCount() const
+{ return rx_queue.getDroppedCount(); }
 
 bool DriverSocket::open(std::string const& path)
+{
+    std::string::size_type colon = path.rfind(':');
+    if (colon == std::string::npos)
+        return open(path, TIMESTAMP_SOFTWARE);
+
+    // Interface names may contain a colon (e.g. aliases), only strip the
+    // suffixes that are timestamping modes
+    std::string mode = path.substr(colon + 1);
+    std::string interface = path.substr(0, colon);
+    if (mode == "sw")
+        return open(interface, TIMESTAMP_SOFTWARE);
+    else if (mode == "ns")
+        return open(interface, TIMESTAMP_SOFTWARE_NS);
+    else if (mode == "hw")
+        return open(interface, TIMESTAMP_HARDWARE);
+    else
+        return open(path, TIMESTAMP_SOFTWARE);
+}
+
+DriverSocket::TIMESTAMP_MODE DriverSocket::getTimestampMode() const
+{
+    return m_timestamp_mode;
+}
+
+bool DriverSocket::open(std::string const& path, TIMESTAMP_MODE mode)
 {
     this->path = path;
     if (isValid())
@@ -105,9 +303,19 @@ bool DriverSocket::open(std::string const& path)
     if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
             return false;
 
-    if (!reset(fd))
+    // Older kernels do not support CAN FD, stay with classic frames there
+    enableFDFrames(fd, m_fd_requested);
+
+    if (mode == TIMESTAMP_HARDWARE)
+        enableHardwareTimestamps(fd, ifr);
+    if (!setTimestampMode(fd, mode))
+      return false;
+    if (!setErrorMaskAndFilters(fd, getFilters()))
       return false;
 
+    m_timestamp_mode = mode;
+    m_rx_calls = 0;
+    m_rx_frames = 0;
     m_fd = guard.release();
     return true;
 }
@@ -244,48 +452,30 @@ static void printErrorFrame(struct can_frame const & frame, std::string const& p
         printf("\tcontroller restarted\n");
 }
 
-bool DriverSocket::checkInput(Timeout timeout)
+int DriverSocket::receiveBatch()
 {
-    struct can_frame frame;
-    struct timeval tv = {0};
-    bool haveTimestamp = false;
+    m_rx_batch->rearm();
+    int res = recvmmsg(m_fd, m_rx_batch->headers.data(),
+                       m_rx_batch->headers.size(), MSG_DONTWAIT, NULL);
+    ++m_rx_calls;
+    if (res == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+        throw iodrivers_base::UnixError("read(): error in recvmmsg()");
+    }
+    m_rx_batch->used = res;
+    m_rx_frames += res;
+    return res;
+}
 
+bool DriverSocket::checkInput(Timeout timeout)
+{
     while(true) {
-  
-        int res;
-        char control[1024];
-        struct iovec    iov;
-        struct msghdr msgh = {0};
-        struct cmsghdr *cmsg;
-        iov.iov_base = &frame;
-        iov.iov_len = sizeof(frame);
-        msgh.msg_control = control;
-        msgh.msg_controllen = sizeof(control);
-        msgh.msg_iovlen = 1;
-        msgh.msg_iov = &iov;
-
-        res = recvmsg(m_fd, &msgh, 0);
-        if (res == -1 && errno != EAGAIN) 
-            throw iodrivers_base::UnixError("read(): error in recvmsg()");
-        if (res >= 0) {
-            /* Receive auxiliary data in msgh */
-            for (cmsg = CMSG_FIRSTHDR(&msgh); cmsg != NULL;
-                 cmsg = CMSG_NXTHDR(&msgh,cmsg)) {
-                if (cmsg->cmsg_level == SOL_SOCKET
-                    && cmsg->cmsg_type == SO_TIMESTAMP) {
-                    tv = *(struct timeval*)(void*)CMSG_DATA(cmsg);
-                    haveTimestamp = true;
-                    break;
-                }
-            }
-            if (cmsg == NULL) {
-                /*
-                 * Error: no timestamp in control buffer
-                 */
-            }
-
-            if (iov.iov_len != 0)
-                break;
+        int count = receiveBatch();
+        if (count > 0) {
+            for (int i = 0; i < count; ++i)
+                processFrame(i);
+            return true;
         }
 
         if (timeout.elapsed())
@@ -294,43 +484,131 @@ bool DriverSocket::checkInput(Timeout timeout)
         struct pollfd pfd;
         pfd.fd = m_fd;
         pfd.events = POLLIN;
-        res = poll(&pfd,1,timeout.timeLeft());
+        int res = poll(&pfd,1,timeout.timeLeft());
         if (res == -1)
             throw UnixError("read(): error in poll()");
         else if (res == 0)
             return false;
     }
+}
+
+static base::Time fromTimespec(struct timespec const& ts)
+{
+    return base::Time::fromSeconds(ts.tv_sec, ts.tv_nsec / 1000);
+}
+
+/** Fills Message::time and Message::can_time from the timestamps in the
+ * control messages
+ *
+ * Message::time is the system clock timestamp, and Message::can_time the
+ * hardware one. Missing timestamps fall back to the reception time and to
+ * the system clock timestamp respectively.
+ */
+template<typename T>
+static void readTimestamps(struct msghdr& msgh, T& result)
+{
+    base::Time system_time;
+    base::Time hardware_time;
+    /* Receive auxiliary data in msgh */
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msgh); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&msgh,cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET)
+            continue;
+
+        if (cmsg->cmsg_type == SCM_TIMESTAMP) {
+            struct timeval tv;
+            memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+            system_time = base::Time::fromSeconds(tv.tv_sec,tv.tv_usec);
+        }
+        else if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            system_time = fromTimespec(ts);
+        }
+        else if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            struct scm_timestamping stamps;
+            memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            if (stamps.ts[0].tv_sec || stamps.ts[0].tv_nsec)
+                system_time = fromTimespec(stamps.ts[0]);
+            if (stamps.ts[2].tv_sec || stamps.ts[2].tv_nsec)
+                hardware_time = fromTimespec(stamps.ts[2]);
+        }
+    }
+
+    result.time = system_time.isNull() ? base::Time::now() : system_time;
+    result.can_time = hardware_time.isNull() ? result.time : hardware_time;
+}
+
+void DriverSocket::processFrame(int index)
+{
+    struct mmsghdr& header = m_rx_batch->headers[index];
+    if (header.msg_len == CANFD_MTU) {
+        processFDFrame(index);
+        return;
+    }
+    else if (header.msg_len != CAN_MTU)
+        return;
+
+    // canfd_frame is layout-compatible with can_frame for the first CAN_MTU
+    // bytes
+    struct can_frame const& frame =
+        reinterpret_cast<struct can_frame const&>(m_rx_batch->frame(index));
 
     if (frame.can_id & CAN_ERR_FLAG) {
-        //Do not handle LOSTARB, this should not be critical
-        //Lostarb ist more or less an collision on the bus
-        //An resend should be done by the kernel -- hopefully
-        if(frame.can_id & ~(CAN_ERR_LOSTARB | CAN_ERR_FLAG))
-            m_error = true;
-
-        err_counter++;
-        printErrorFrame(frame, path);
-        return true;
+        processErrorFrame(index);
+        return;
     }
     if (frame.can_id & CAN_RTR_FLAG) {
         printf("read: CAN RTR frame\n");
-        return true;
+        return;
     }
 
     /* do something with the received CAN frame */
     Message result;
-    if (haveTimestamp)
-        result.time     = base::Time::fromSeconds(tv.tv_sec,tv.tv_usec);
-    else
-        throw "timestamp missing";
-//      result.time     = base::Time::now();
-    result.can_time = result.time;
+    readTimestamps(header.msg_hdr, result);
     result.can_id        = frame.can_id & CAN_ERR_MASK;
     memcpy(result.data, frame.data, 8);
     result.size          = frame.can_dlc;
-    
-    rx_queue.push_back(result);
-    return true;
+
+    rx_queue.push(result);
+}
+
+void DriverSocket::processErrorFrame(int index)
+{
+    struct can_frame const& frame =
+        reinterpret_cast<struct can_frame const&>(m_rx_batch->frame(index));
+
+    //Do not handle LOSTARB, this should not be critical
+    //Lostarb ist more or less an collision on the bus
+    //An resend should be done by the kernel -- hopefully
+    if(frame.can_id & ~(CAN_ERR_LOSTARB | CAN_ERR_FLAG))
+        m_error = true;
+
+    err_counter++;
+    printErrorFrame(frame, path);
+}
+
+void DriverSocket::processFDFrame(int index)
+{
+    struct mmsghdr& header = m_rx_batch->headers[index];
+    struct canfd_frame const& frame = m_rx_batch->frame(index);
+    if (frame.can_id & CAN_ERR_FLAG) {
+        processErrorFrame(index);
+        return;
+    }
+
+    MessageFD result;
+    readTimestamps(header.msg_hdr, result);
+    result.can_id = frame.can_id & CAN_ERR_MASK;
+    result.size = std::min<uint8_t>(frame.len, CANFD_MAX_DLEN);
+    memcpy(result.data, frame.data, CANFD_MAX_DLEN);
+    result.flags = 0;
+    if (frame.flags & CANFD_BRS)
+        result.flags |= FLAG_BIT_RATE_SWITCH;
+    if (frame.flags & CANFD_ESI)
+        result.flags |= FLAG_ERROR_STATE_INDICATOR;
+
+    fd_rx_queue->push(result);
 }
 
 Message DriverSocket::read()
@@ -341,8 +619,8 @@ Message DriverSocket::read()
             throw iodrivers_base::TimeoutError(iodrivers_base::TimeoutError::PACKET, "read(): timeout");
     }
     
-    Message result = rx_queue.front();
-    rx_queue.pop_front();
+    Message result;
+    rx_queue.pop(result);
     return result;
 }
 
@@ -353,19 +631,57 @@ bool DriverSocket::read(Message &result) {
             return false;
     }
     
-    result = rx_queue.front();
-    rx_queue.pop_front();
+    rx_queue.pop(result);
     return true;
 }
 
-void DriverSocket::write(Message const& msg)
+bool DriverSocket::readFD(MessageFD& result)
+{
+    if (!fd_rx_queue)
+        return false;
+
+    Timeout timeout(m_read_timeout);
+    while (fd_rx_queue->empty()) {
+        if (!checkInput(timeout))
+            return false;
+    }
+
+    fd_rx_queue->pop(result);
+    return true;
+}
+
+size_t DriverSocket::readBatch(Message* out, size_t max)
+{
+    if (max == 0)
+        return 0;
+
+    Timeout timeout(m_read_timeout);
+    while (rx_queue.empty()) {
+        if (!checkInput(timeout))
+            return 0;
+    }
+
+    Timeout t(0);
+    while (rx_queue.size() < max && checkInput(t)) {}
+
+    size_t count = 0;
+    while (count < max && rx_queue.pop(out[count]))
+        ++count;
+    return count;
+}
+
+static void toCANFrame(struct can_frame& frame, Message const& msg)
 {
-    struct can_frame frame;
-    
     memset(&frame, 0, sizeof(can_frame));
     frame.can_id = msg.can_id;
     frame.can_dlc = msg.size;
     memcpy(frame.data,msg.data,8);
+}
+
+void DriverSocket::write(Message const& msg)
+{
+    struct can_frame frame;
+    toCANFrame(frame, msg);
 
     Timeout timeout(m_write_timeout);
     while(true) {
@@ -389,17 +705,145 @@ void DriverSocket::write(Message const& msg)
     }
 }
 
-int DriverSocket::getPendingMessagesCount()
+void DriverSocket::writeFD(MessageFD const& msg)
 {
+    struct canfd_frame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id = msg.can_id;
+    frame.len = std::min<uint8_t>(msg.size, CANFD_MAX_DLEN);
+    if (msg.flags & FLAG_BIT_RATE_SWITCH)
+        frame.flags |= CANFD_BRS;
+    if (msg.flags & FLAG_ERROR_STATE_INDICATOR)
+        frame.flags |= CANFD_ESI;
+    memcpy(frame.data, msg.data, frame.len);
+
+    Timeout timeout(m_write_timeout);
+    while(true) {
+        int c = send(m_fd, &frame, CANFD_MTU, 0);
+        if (c == -1 && errno != EAGAIN && errno != ENOBUFS)
+            throw UnixError("writeFD(): error during write");
+        if (c > 0)
+            return;
+
+        if (timeout.elapsed())
+            throw TimeoutError(TimeoutError::PACKET, "writeFD(): timeout");
+
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLOUT;
+        int res = poll(&pfd,1,timeout.timeLeft());
+        if (res == -1)
+            throw UnixError("writeFD(): error in poll()");
+        else if (res == 0)
+            throw TimeoutError(TimeoutError::PACKET, "writeFD(): timeout");
+    }
+}
+
+bool DriverSocket::isFDEnabled() const
+{
+    return m_fd_frames;
+}
+
+bool DriverSocket::setFDFramesEnabled(bool enable)
+{
+    m_fd_requested = enable;
+    if (!isValid())
+        return true;
+    return enableFDFrames(m_fd, enable);
+}
+
+bool DriverSocket::enableFDFrames(int fd, bool enable)
+{
+    int fd_frames = enable ? 1 : 0;
+    bool success = (setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES,
+                               &fd_frames, sizeof(fd_frames)) == 0);
+    bool enabled = enable && success;
+    if (enabled != m_fd_frames) {
+        m_fd_frames = enabled;
+        // The receive buffers need room for CAN FD frames only if they
+        // are enabled
+        setReceiveBatchSize(getReceiveBatchSize());
+    }
+
+    if (!enabled)
+        fd_rx_queue.reset();
+    else if (!fd_rx_queue)
+        fd_rx_queue.reset(new RingBuffer<MessageFD>());
+    return success || !enable;
+}
+
+size_t DriverSocket::writeBatch(Message const* msgs, size_t count)
+{
+    static const size_t CHUNK_SIZE = 64;
+    struct can_frame frames[CHUNK_SIZE];
+    struct iovec iovecs[CHUNK_SIZE];
+    struct mmsghdr headers[CHUNK_SIZE];
+
+    Timeout timeout(m_write_timeout);
+    size_t done = 0;
+    while (done < count) {
+        size_t chunk = std::min(CHUNK_SIZE, count - done);
+        memset(headers, 0, sizeof(struct mmsghdr) * chunk);
+        for (size_t i = 0; i < chunk; ++i) {
+            toCANFrame(frames[i], msgs[done + i]);
+            iovecs[i].iov_base = &frames[i];
+            iovecs[i].iov_len = sizeof(struct can_frame);
+            headers[i].msg_hdr.msg_iov = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        size_t sent = 0;
+        while (sent < chunk) {
+            int c = sendmmsg(m_fd, headers + sent, chunk - sent, MSG_DONTWAIT);
+            if (c > 0) {
+                sent += c;
+                continue;
+            }
+            if (c == -1 && errno != EAGAIN && errno != ENOBUFS)
+                throw UnixError("writeBatch(): error in sendmmsg()");
+
+            if (timeout.elapsed())
+                return done + sent;
+
+            struct pollfd pfd;
+            pfd.fd = m_fd;
+            pfd.events = POLLOUT;
+            int res = poll(&pfd,1,timeout.timeLeft());
+            if (res == -1)
+                throw UnixError("writeBatch(): error in poll()");
+            else if (res == 0)
+                return done + sent;
+        }
+        done += chunk;
+    }
+    return count;
+}
+
+void DriverSocket::receivePending()
+{
+    // Stop before one more recvmmsg() call could overflow the queue, the
+    // remaining frames wait in the socket buffer
     Timeout t(0);
-    while(checkInput(t)) {}
+    while ((rx_queue.empty() ||
+            rx_queue.size() + m_rx_batch->size() <= rx_queue.capacity()) &&
+           checkInput(t)) {}
+}
+
+int DriverSocket::getPendingMessagesCount()
+{
+    receivePending();
     return rx_queue.size();
 }
 
+int DriverSocket::getPendingFDMessagesCount()
+{
+    receivePending();
+    return fd_rx_queue ? fd_rx_queue->size() : 0;
+}
+
 bool DriverSocket::checkBusOk()
 {
-    Timeout t(0);
-    while(checkInput(t)) {}
+    receivePending();
     return !m_error;
 }
 
@@ -408,6 +852,8 @@ void DriverSocket::clear()
     Timeout t(0);
     while(checkInput(t)) {}
     rx_queue.clear();
+    if (fd_rx_queue)
+        fd_rx_queue->clear();
     m_error = false;
     return;
 }
@@ -2,8 +2,9 @@
 #define CANBUS_SOCKET_HH
 #include <canbus/Message.hpp>
 #include <canbus/Driver.hpp>
+#include <canbus/RingBuffer.hpp>
 #include <string>
-#include <deque>
+#include <memory>
 #include <iodrivers_base/Driver.hpp>
 #include <iodrivers_base/Timeout.hpp>
 
@@ -12,21 +13,63 @@ namespace canbus
 {
     /** This class allows to (i) setup a CAN interface and (ii) having read and
      * write access to it.
+     *
+     * Received frames are queued in a bounded RingBuffer of
+     * RingBuffer::DEFAULT_CAPACITY (4095) messages. When the application
+     * falls behind the bus and the queue is full, the oldest queued frames
+     * are dropped. Use setReceiveQueueSize to change the capacity or the
+     * overflow policy, and getReceiveQueueDropCount to detect the drops.
      */
     class DriverSocket : public Driver
     {
+    public:
+        /** How received frames are timestamped by the kernel
+         *
+         * @see open
+         */
+        enum TIMESTAMP_MODE
+        {
+            /** Microsecond system clock timestamps (SO_TIMESTAMP) */
+            TIMESTAMP_SOFTWARE,
+            /** Nanosecond system clock timestamps (SO_TIMESTAMPNS) */
+            TIMESTAMP_SOFTWARE_NS,
+            /** Timestamps from the adapter's clock in Message::can_time, and
+             * from the system clock in Message::time (SO_TIMESTAMPING)
+             */
+            TIMESTAMP_HARDWARE
+        };
+
     private:
         uint32_t m_read_timeout;
         uint32_t m_write_timeout;
 
         int m_fd;
 
+        /** Buffers used to receive frames with recvmmsg(), see checkInput */
+        struct RxBatch;
+        std::unique_ptr<RxBatch> m_rx_batch;
+
         bool checkInput(iodrivers_base::Timeout timeout);
+        void receivePending();
+        int receiveBatch();
+        void processFrame(int index);
+        void processFDFrame(int index);
+        void processErrorFrame(int index);
+        bool enableFDFrames(int fd, bool enable);
 
-        std::deque<Message> rx_queue;
+        /** recvmmsg() calls, and frames they returned */
+        uint64_t m_rx_calls;
+        uint64_t m_rx_frames;
+
+        RingBuffer<Message> rx_queue;
+        /** Allocated only while CAN FD frames are enabled */
+        std::unique_ptr<RingBuffer<MessageFD>> fd_rx_queue;
+        bool m_fd_frames;
+        bool m_fd_requested;
         bool m_error;
         std::string path;
         uint32_t err_counter;
+        TIMESTAMP_MODE m_timestamp_mode;
     public:
         /** The default timeout value in milliseconds
          *
@@ -34,13 +77,41 @@ namespace canbus
          */
         static const int DEFAULT_TIMEOUT = 100;
 
+        /** The default number of frames that are received per system call
+         *
+         * @see setReceiveBatchSize
+         */
+        static const int DEFAULT_RX_BATCH_SIZE = 32;
+
         DriverSocket();
+        ~DriverSocket();
 
         /** Opens the given device and resets the CAN interface. It returns
          * true if the initialization was successful and false otherwise
+         *
+         * The timestamping mode can be selected by appending :sw, :ns or :hw
+         * to the interface name (e.g. can0:hw), for respectively
+         * TIMESTAMP_SOFTWARE, TIMESTAMP_SOFTWARE_NS and TIMESTAMP_HARDWARE.
+         * It defaults to TIMESTAMP_SOFTWARE. Any other suffix is considered
+         * part of the interface name.
          */
         bool open(std::string const& path);
 
+        /** Opens the given device with the given timestamping mode
+         *
+         * If the mode is not supported by the kernel, the driver falls back
+         * to the next less precise one. getTimestampMode() returns the mode
+         * actually in use. Frames that come without hardware timestamp get
+         * the system timestamp in Message::can_time as well.
+         */
+        bool open(std::string const& path, TIMESTAMP_MODE mode);
+
+        /** The timestamping mode in use
+         *
+         * @see open
+         */
+        TIMESTAMP_MODE getTimestampMode() const;
+
         /** Resets the CAN board. This must be called before
          *  any calls to reset() on any of the interfaces of the same
          *  board
@@ -57,7 +128,40 @@ namespace canbus
          *
          * @return true on success, false on error.
          */
-        static bool reset(int fd);
+        static bool reset(int fd,
+                std::vector<Filter> const& filters = std::vector<Filter>(),
+                TIMESTAMP_MODE mode = TIMESTAMP_SOFTWARE);
+
+        /** Enables the timestamping of received frames on a CAN socket
+         *
+         * If \c mode is not supported, it falls back to the next less
+         * precise mode, down to TIMESTAMP_SOFTWARE.
+         *
+         * @param mode the requested mode. It is set to the mode actually
+         *   enabled.
+         * @return false if no timestamping could be enabled at all
+         */
+        static bool setTimestampMode(int fd, TIMESTAMP_MODE& mode);
+
+        /** Installs the filters in the kernel with CAN_RAW_FILTER
+         *
+         * Unlike the user-space filtering, unwanted frames are never copied
+         * to the process.
+         */
+        bool setFilters(std::vector<Filter> const& filters);
+
+        /** Installs the given filters on a CAN socket
+         *
+         * An empty list installs the default filter, which accepts all
+         * frames
+         */
+        static bool setFilters(int fd, std::vector<Filter> const& filters);
+
+        /** Installs the error frame mask and the given filters on a CAN
+         * socket, i.e. what reset(fd, filters, mode) does besides enabling
+         * the timestamps
+         */
+        static bool setErrorMaskAndFilters(int fd, std::vector<Filter> const& filters);
 
         /** Sets the timeout, in milliseconds, for which we are allowed to wait
          * for write access is write()
@@ -93,6 +197,63 @@ namespace canbus
          */
         bool read(Message &msg);
 
+        /** Reads the next CAN FD message. It is guaranteed to not block
+         * longer than the timeout provided by setReadTimeout().
+         *
+         * CAN FD frames are queued separately from the classic ones, they
+         * are never returned by read(). It returns false right away if CAN
+         * FD frames are not enabled (see setFDFramesEnabled).
+         *
+         * @param msg   The Message will be put here, if any
+         * @return   true if msg was filled in, false on timeout.
+         */
+        bool readFD(MessageFD& msg);
+
+        /** Reads up to \c max messages. It waits at most the timeout provided
+         * by setReadTimeout() for the first message, and then returns all
+         * messages that are already available without waiting further.
+         *
+         * @param out   array of at least \c max messages
+         * @return   the number of messages written in \c out, 0 on timeout.
+         */
+        size_t readBatch(Message* out, size_t max);
+
+        /** Sets the maximum number of frames that are received from the
+         * kernel in one system call
+         *
+         * Frames are received with recvmmsg(), which drains up to this many
+         * frames (and their timestamps) at once. Set to 1 to get one system
+         * call per frame.
+         */
+        void setReceiveBatchSize(size_t size);
+
+        /** Returns the maximum number of frames received per system call
+         *
+         * @see setReceiveBatchSize
+         */
+        size_t getReceiveBatchSize() const;
+
+        /** How many recvmmsg() calls have been made since open(), including
+         * the ones that found the socket empty
+         */
+        uint64_t getRxCallCount() const;
+
+        /** How many frames the recvmmsg() calls returned since open() */
+        uint64_t getRxFrameCount() const;
+
+        /** Sets the capacity of the receive queue, and whether the oldest or
+         * the newest message is dropped when it overflows
+         *
+         * This discards the messages currently queued
+         */
+        void setReceiveQueueSize(size_t capacity,
+                RingBuffer<Message>::OVERFLOW_POLICY policy = RingBuffer<Message>::DROP_OLDEST);
+
+        /** How many received messages have been dropped because the receive
+         * queue was full
+         */
+        uint64_t getReceiveQueueDropCount() const;
+
         /** Writes a message. It is guaranteed to not block longer than the
          * timeout provided in setWriteTimeout().
          *
@@ -100,10 +261,58 @@ namespace canbus
          */
         void write(Message const& msg);
 
+        /** Writes a CAN FD message. It is guaranteed to not block longer than
+         * the timeout provided in setWriteTimeout().
+         *
+         * The BRS and ESI bits are taken from MessageFD::flags. CAN FD
+         * frames must have been enabled with setFDFramesEnabled
+         */
+        void writeFD(MessageFD const& msg);
+
+        /** Whether the socket accepts CAN FD frames
+         *
+         * @see setFDFramesEnabled
+         */
+        bool isFDEnabled() const;
+
+        /** Enables or disables the reception and transmission of CAN FD
+         * frames. They are disabled by default
+         *
+         * It may be called before or after open(). The CAN FD receive
+         * queue, and receive buffers large enough for CAN FD frames, are
+         * only allocated while they are enabled. Classic-only users do not
+         * pay for them.
+         *
+         * @return false if the socket is open and the kernel does not
+         *   support CAN FD. open() itself does not fail in this case, use
+         *   isFDEnabled() to check.
+         */
+        bool setFDFramesEnabled(bool enable);
+
+        /** Writes a batch of messages with sendmmsg(). The whole batch is
+         * guaranteed to not block longer than the timeout provided in
+         * setWriteTimeout().
+         *
+         * @return the number of messages that have been handed over to the
+         *   kernel before the timeout expired
+         */
+        size_t writeBatch(Message const* msgs, size_t count);
+
         /** Returns the number of messages queued in the board's RX queue
+         *
+         * It first receives the frames waiting in the socket, but stops
+         * before they could overflow the receive queue: with a backlog
+         * larger than the queue, it returns about the queue capacity and
+         * the rest stays in the kernel until the queued messages are read.
+         * Callers such as Reactor, which read a budget of messages at a
+         * time, therefore do not make the queue drop the oldest frames.
          */
         int getPendingMessagesCount();
 
+        /** Returns the number of CAN FD messages queued in the RX queue
+         */
+        int getPendingFDMessagesCount();
+
       /** Checks if bus reports error, this may indicate a disconnected cable
        *  this method will only report an error after an message was written
        *  to the bus
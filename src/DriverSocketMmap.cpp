@@ -0,0 +1,438 @@
+#include <canbus/DriverSocketMmap.hpp>
+
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <linux/can/raw.h>
+#include <linux/can/error.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <algorithm>
+
+using namespace canbus;
+using iodrivers_base::UnixError;
+using iodrivers_base::TimeoutError;
+using iodrivers_base::Timeout;
+
+Message FrameView::toMessage() const
+{
+    Message result;
+    result.time = time;
+    result.can_time = time;
+    result.can_id = getID();
+    memcpy(result.data, frame->data, 8);
+    result.size = std::min<uint8_t>(frame->len, 8);
+    return result;
+}
+
+MessageFD FrameView::toMessageFD() const
+{
+    MessageFD result;
+    result.time = time;
+    result.can_time = time;
+    result.can_id = getID();
+    result.size = std::min<uint8_t>(frame->len, fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN);
+    memcpy(result.data, frame->data, result.size);
+    result.flags = 0;
+    if (fd && (frame->flags & CANFD_BRS))
+        result.flags |= FLAG_BIT_RATE_SWITCH;
+    if (fd && (frame->flags & CANFD_ESI))
+        result.flags |= FLAG_ERROR_STATE_INDICATOR;
+    return result;
+}
+
+DriverSocketMmap::DriverSocketMmap()
+    : m_read_timeout(DEFAULT_TIMEOUT)
+    , m_block_size(DEFAULT_BLOCK_SIZE)
+    , m_block_count(DEFAULT_BLOCK_COUNT)
+    , m_block_timeout(DEFAULT_BLOCK_TIMEOUT)
+    , m_fd(-1)
+    , m_ring(NULL)
+    , m_ring_size(0)
+    , m_block(0)
+    , m_holding(false)
+    , m_packet(NULL)
+    , m_remaining(0)
+    , m_error(false)
+    , err_counter(0) {}
+
+DriverSocketMmap::~DriverSocketMmap()
+{
+    close();
+}
+
+void DriverSocketMmap::setRingSize(uint32_t block_size, uint32_t block_count,
+                                   uint32_t block_timeout)
+{
+    m_block_size = block_size;
+    m_block_count = block_count;
+    m_block_timeout = block_timeout;
+}
+
+void DriverSocketMmap::setReadTimeout(uint32_t timeout)
+{ m_read_timeout = timeout; }
+uint32_t DriverSocketMmap::getReadTimeout() const
+{ return m_read_timeout; }
+void DriverSocketMmap::setWriteTimeout(uint32_t timeout)
+{ m_tx.setWriteTimeout(timeout); }
+uint32_t DriverSocketMmap::getWriteTimeout() const
+{ return m_tx.getWriteTimeout(); }
+
+bool DriverSocketMmap::open(std::string const& path)
+{
+    if (isValid())
+        close();
+
+    unsigned int ifindex = if_nametoindex(path.c_str());
+    if (ifindex == 0)
+        return false;
+
+    // The TX socket must not accumulate frames, as nobody reads from it
+    if (!m_tx.open(path))
+        return false;
+    can_err_mask_t err_mask = 0;
+    if (setsockopt(m_tx.getFileDescriptor(), SOL_CAN_RAW, CAN_RAW_FILTER, NULL, 0) != 0 ||
+        setsockopt(m_tx.getFileDescriptor(), SOL_CAN_RAW, CAN_RAW_ERR_FILTER,
+                   &err_mask, sizeof(err_mask)) != 0) {
+        m_tx.close();
+        return false;
+    }
+
+    // ETH_P_ALL gets both the CAN and CAN FD frames
+    int fd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (fd == -1) {
+        m_tx.close();
+        return false;
+    }
+    iodrivers_base::FileGuard guard(fd);
+
+    // Set up the ring before binding, so that no frame gets queued on the
+    // socket itself
+    if (!mapRing(fd)) {
+        m_tx.close();
+        return false;
+    }
+
+#ifdef PACKET_IGNORE_OUTGOING
+    int ignore_outgoing = 1;
+    setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING,
+               &ignore_outgoing, sizeof(ignore_outgoing));
+#endif
+
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifindex;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        unmapRing();
+        m_tx.close();
+        return false;
+    }
+
+    m_fd = guard.release();
+    m_error = false;
+    err_counter = 0;
+    return true;
+}
+
+bool DriverSocketMmap::mapRing(int fd)
+{
+    int version = TPACKET_V3;
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0)
+        return false;
+
+    // With TPACKET_V3, frames are packed in the blocks regardless of the
+    // frame size. The kernel only uses it to validate the request.
+    uint32_t frame_size = TPACKET_ALIGN(TPACKET3_HDRLEN + CANFD_MTU);
+    if (m_block_size < frame_size || m_block_count == 0)
+        return false;
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = m_block_size;
+    req.tp_block_nr = m_block_count;
+    req.tp_frame_size = frame_size;
+    req.tp_frame_nr = (m_block_size / frame_size) * m_block_count;
+    req.tp_retire_blk_tov = m_block_timeout;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0)
+        return false;
+
+    size_t size = static_cast<size_t>(m_block_size) * m_block_count;
+    void* ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED)
+        return false;
+
+    m_ring = static_cast<uint8_t*>(ring);
+    m_ring_size = size;
+    m_block = 0;
+    m_holding = false;
+    m_packet = NULL;
+    m_remaining = 0;
+    return true;
+}
+
+void DriverSocketMmap::unmapRing()
+{
+    if (m_ring)
+        munmap(m_ring, m_ring_size);
+    m_ring = NULL;
+    m_ring_size = 0;
+    m_holding = false;
+    m_remaining = 0;
+}
+
+static struct tpacket_block_desc* blockAt(uint8_t* ring, uint32_t block_size, uint32_t index)
+{
+    return reinterpret_cast<struct tpacket_block_desc*>(
+            ring + static_cast<size_t>(index) * block_size);
+}
+
+bool DriverSocketMmap::acquireBlock()
+{
+    struct tpacket_block_desc* desc = blockAt(m_ring, m_block_size, m_block);
+    uint32_t status = __atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE);
+    if (!(status & TP_STATUS_USER))
+        return false;
+
+    m_holding = true;
+    m_packet = reinterpret_cast<uint8_t*>(desc) + desc->hdr.bh1.offset_to_first_pkt;
+    m_remaining = desc->hdr.bh1.num_pkts;
+    return true;
+}
+
+void DriverSocketMmap::releaseBlock()
+{
+    struct tpacket_block_desc* desc = blockAt(m_ring, m_block_size, m_block);
+    __atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    m_block = (m_block + 1) % m_block_count;
+    m_holding = false;
+    m_packet = NULL;
+    m_remaining = 0;
+}
+
+bool DriverSocketMmap::waitForBlock(Timeout const& timeout)
+{
+    if (timeout.elapsed())
+        return false;
+
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN | POLLERR;
+    int res = poll(&pfd, 1, timeout.timeLeft());
+    if (res == -1 && errno != EINTR)
+        throw UnixError("read(): error in poll()");
+    return res != 0;
+}
+
+/** Returns the CAN frame of a ring packet, or NULL if it should be ignored */
+static struct canfd_frame const* getFrame(struct tpacket3_hdr const* hdr, bool& fd)
+{
+    struct sockaddr_ll const* addr = reinterpret_cast<struct sockaddr_ll const*>(
+            reinterpret_cast<uint8_t const*>(hdr) + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+    if (addr->sll_pkttype == PACKET_OUTGOING)
+        return NULL;
+
+    if (hdr->tp_snaplen == CANFD_MTU)
+        fd = true;
+    else if (hdr->tp_snaplen == CAN_MTU)
+        fd = false;
+    else
+        return NULL;
+
+    return reinterpret_cast<struct canfd_frame const*>(
+            reinterpret_cast<uint8_t const*>(hdr) + hdr->tp_mac);
+}
+
+bool DriverSocketMmap::nextView(FrameView& view)
+{
+    while (m_remaining > 0) {
+        struct tpacket3_hdr const* hdr =
+            reinterpret_cast<struct tpacket3_hdr const*>(m_packet);
+        m_packet += hdr->tp_next_offset;
+        --m_remaining;
+
+        struct canfd_frame const* frame = getFrame(hdr, view.fd);
+        if (!frame)
+            continue;
+
+        if (frame->can_id & CAN_ERR_FLAG) {
+            //Do not handle LOSTARB, see DriverSocket
+            if(frame->can_id & ~(CAN_ERR_LOSTARB | CAN_ERR_FLAG))
+                m_error = true;
+            err_counter++;
+            continue;
+        }
+        if (frame->can_id & CAN_RTR_FLAG)
+            continue;
+        if (!m_filters.accepts(frame->can_id & CAN_ERR_MASK))
+            continue;
+
+        view.frame = frame;
+        view.time = base::Time::fromSeconds(hdr->tp_sec, hdr->tp_nsec / 1000);
+        return true;
+    }
+    return false;
+}
+
+size_t DriverSocketMmap::readViews(FrameView* views, size_t max)
+{
+    if (max == 0)
+        return 0;
+
+    Timeout timeout(m_read_timeout);
+    while (true) {
+        if (m_holding && m_remaining == 0)
+            releaseBlock();
+        if (!m_holding && !acquireBlock()) {
+            if (!waitForBlock(timeout))
+                return 0;
+            continue;
+        }
+
+        size_t count = 0;
+        while (count < max && nextView(views[count]))
+            ++count;
+        if (count > 0)
+            return count;
+    }
+}
+
+Message DriverSocketMmap::read()
+{
+    Message result;
+    if (!read(result))
+        throw TimeoutError(TimeoutError::PACKET, "read(): timeout");
+    return result;
+}
+
+bool DriverSocketMmap::read(Message& msg)
+{
+    Timeout timeout(m_read_timeout);
+    FrameView view;
+    while (true) {
+        if (m_holding && m_remaining == 0)
+            releaseBlock();
+        if (!m_holding && !acquireBlock()) {
+            if (!waitForBlock(timeout))
+                return false;
+            continue;
+        }
+
+        while (nextView(view)) {
+            if (!view.fd) {
+                msg = view.toMessage();
+                return true;
+            }
+        }
+    }
+}
+
+void DriverSocketMmap::write(Message const& msg)
+{
+    m_tx.write(msg);
+}
+
+size_t DriverSocketMmap::writeBatch(Message const* msgs, size_t count)
+{
+    return m_tx.writeBatch(msgs, count);
+}
+
+/** Counts the classic frames of a block that read() would return */
+static int countAccepted(uint8_t const* packet, uint32_t count, FilterSet const& filters)
+{
+    int result = 0;
+    for (; count > 0; --count) {
+        struct tpacket3_hdr const* hdr =
+            reinterpret_cast<struct tpacket3_hdr const*>(packet);
+        packet += hdr->tp_next_offset;
+
+        bool fd;
+        struct canfd_frame const* frame = getFrame(hdr, fd);
+        if (frame && !fd &&
+            !(frame->can_id & (CAN_ERR_FLAG | CAN_RTR_FLAG)) &&
+            filters.accepts(frame->can_id & CAN_ERR_MASK))
+            ++result;
+    }
+    return result;
+}
+
+int DriverSocketMmap::getPendingMessagesCount()
+{
+    if (!m_ring)
+        return 0;
+
+    int count = 0;
+    uint32_t block = m_block;
+    uint32_t scanned = 0;
+    if (m_holding) {
+        count += countAccepted(m_packet, m_remaining, m_filters);
+        block = (block + 1) % m_block_count;
+        scanned = 1;
+    }
+
+    for (; scanned < m_block_count; ++scanned) {
+        struct tpacket_block_desc* desc = blockAt(m_ring, m_block_size, block);
+        uint32_t status = __atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE);
+        if (!(status & TP_STATUS_USER))
+            break;
+        count += countAccepted(
+                reinterpret_cast<uint8_t*>(desc) + desc->hdr.bh1.offset_to_first_pkt,
+                desc->hdr.bh1.num_pkts, m_filters);
+        block = (block + 1) % m_block_count;
+    }
+    return count;
+}
+
+bool DriverSocketMmap::checkBusOk()
+{
+    return !m_error;
+}
+
+void DriverSocketMmap::clear()
+{
+    if (!m_ring)
+        return;
+
+    if (m_holding)
+        releaseBlock();
+    for (uint32_t i = 0; i < m_block_count && acquireBlock(); ++i)
+        releaseBlock();
+    m_error = false;
+}
+
+bool DriverSocketMmap::reset()
+{
+    clear();
+    err_counter = 0;
+    return true;
+}
+
+int DriverSocketMmap::getFileDescriptor() const
+{
+    return m_fd;
+}
+
+bool DriverSocketMmap::isValid() const
+{
+    return m_fd != -1;
+}
+
+void DriverSocketMmap::close()
+{
+    unmapRing();
+    if (m_fd != -1)
+        ::close(m_fd);
+    m_fd = -1;
+    m_tx.close();
+}
+
+uint32_t DriverSocketMmap::getErrorCount() const
+{
+    return err_counter;
+}
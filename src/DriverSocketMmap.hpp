@@ -0,0 +1,177 @@
+#ifndef CANBUS_SOCKET_MMAP_HH
+#define CANBUS_SOCKET_MMAP_HH
+#include <canbus/Message.hpp>
+#include <canbus/Driver.hpp>
+#include <canbus/DriverSocket.hpp>
+#include <string>
+#include <linux/can.h>
+
+namespace canbus
+{
+    /** A frame received by DriverSocketMmap, read in place in the RX ring
+     *
+     * The view is only valid until the ring block it points to is handed
+     * back to the kernel, see DriverSocketMmap::readViews
+     */
+    struct FrameView
+    {
+        /** The frame in the ring. Only the first CAN_MTU bytes are valid
+         * if \c fd is false
+         */
+        struct canfd_frame const* frame;
+
+        /** Whether this is a CAN FD frame */
+        bool fd;
+
+        /** Reception time, from the system clock */
+        base::Time time;
+
+        uint32_t getID() const { return frame->can_id & CAN_ERR_MASK; }
+        uint8_t getSize() const { return frame->len; }
+        uint8_t const* getData() const { return frame->data; }
+
+        /** Copies a classic frame into a Message */
+        Message toMessage() const;
+
+        /** Copies a classic or CAN FD frame into a MessageFD */
+        MessageFD toMessageFD() const;
+    };
+
+    /** SocketCAN driver that receives frames from a memory-mapped ring
+     *
+     * It opens a PF_PACKET socket on the CAN interface and maps a
+     * TPACKET_V3 RX ring shared with the kernel. Frames are read in place
+     * with readViews(), and are only copied when converted to a Message.
+     * read() does the conversion for the code that uses the Driver
+     * interface.
+     *
+     * The ring is made of blocks that the kernel hands over to user space
+     * when they are full, or after the block timeout expired. The block
+     * timeout is therefore the worst-case reception latency on a quiet bus.
+     *
+     * Frames are sent through a CAN_RAW socket, see DriverSocket. Unlike
+     * with DriverSocket, they are received back once the kernel looped them
+     * back, as all other frames on the bus. Filters are applied in user
+     * space, on the views, before any copy.
+     */
+    class DriverSocketMmap : public Driver
+    {
+    public:
+        static const uint32_t DEFAULT_BLOCK_SIZE = 1 << 16;
+        static const uint32_t DEFAULT_BLOCK_COUNT = 64;
+        /** The default block timeout in milliseconds */
+        static const uint32_t DEFAULT_BLOCK_TIMEOUT = 1;
+
+        DriverSocketMmap();
+        ~DriverSocketMmap();
+
+        /** Sets the geometry of the RX ring. It is applied on the next
+         * call to open()
+         *
+         * @param block_size the size of a block in bytes, a multiple of the
+         *   page size
+         * @param block_count the number of blocks in the ring
+         * @param block_timeout how long, in milliseconds, the kernel waits
+         *   before handing over a block that is not full
+         */
+        void setRingSize(uint32_t block_size, uint32_t block_count,
+                         uint32_t block_timeout = DEFAULT_BLOCK_TIMEOUT);
+
+        /** Opens the given CAN interface (e.g. can0) and maps its RX ring */
+        bool open(std::string const& path);
+
+        bool resetBoard() { return true; }
+
+        /** Hands all available ring blocks back to the kernel and resets
+         * the error state
+         */
+        bool reset();
+
+        void     setWriteTimeout(uint32_t timeout);
+        uint32_t getWriteTimeout() const;
+        void     setReadTimeout(uint32_t timeout);
+        uint32_t getReadTimeout() const;
+
+        /** Returns up to \c max frames, without copying them out of the
+         * ring. It waits at most the timeout provided by setReadTimeout()
+         * for the first frame.
+         *
+         * The returned views are never spread over several ring blocks. They
+         * stay valid until the next call to readViews(), read() or clear().
+         *
+         * @return the number of views written in \c views, 0 on timeout
+         */
+        size_t readViews(FrameView* views, size_t max);
+
+        /** Reads the next classic frame. It is guaranteed to not block
+         * longer than the timeout provided by setReadTimeout().
+         */
+        Message read();
+
+        /** Reads the next classic frame. It is guaranteed to not block
+         * longer than the timeout provided by setReadTimeout().
+         *
+         * @param msg   The Message will be put here, if any
+         * @return   true if msg was filled in, false on timeout.
+         */
+        bool read(Message& msg);
+
+        void write(Message const& msg);
+        size_t writeBatch(Message const* msgs, size_t count);
+
+        /** Returns the number of accepted frames available in the ring */
+        int getPendingMessagesCount();
+
+        /** Checks whether an error frame has been received since the last
+         * call to clear()
+         */
+        bool checkBusOk();
+
+        /** Hands all available ring blocks back to the kernel */
+        void clear();
+
+        /** Returns the PF_PACKET socket, which becomes readable when a ring
+         * block is available
+         */
+        int getFileDescriptor() const;
+
+        bool isValid() const;
+        void close();
+
+        uint32_t getErrorCount() const;
+
+    private:
+        uint32_t m_read_timeout;
+        uint32_t m_block_size;
+        uint32_t m_block_count;
+        uint32_t m_block_timeout;
+
+        int m_fd;
+        uint8_t* m_ring;
+        size_t m_ring_size;
+
+        /** The block being read, or the next block to read if m_holding is
+         * false
+         */
+        uint32_t m_block;
+        /** Whether m_block is owned by user space */
+        bool m_holding;
+        /** The next packet header in the current block */
+        uint8_t* m_packet;
+        /** How many packets are left in the current block */
+        uint32_t m_remaining;
+
+        DriverSocket m_tx;
+        bool m_error;
+        uint32_t err_counter;
+
+        bool mapRing(int fd);
+        void unmapRing();
+        bool acquireBlock();
+        void releaseBlock();
+        bool waitForBlock(iodrivers_base::Timeout const& timeout);
+        bool nextView(FrameView& view);
+    };
+}
+
+#endif
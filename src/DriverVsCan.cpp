@@ -98,10 +98,13 @@ bool DriverVsCan::checkForMessages(iodrivers_base::Timeout& timeout)
             result.can_id        = msg->Id;
             memcpy(result.data, msg->Data, 8);
             result.size          = msg->Size;
-            rx_queue.push_back(result);
+            if (acceptsMessage(result))
+            {
+                rx_queue.push(result);
+                rx_cnt++;
+            }
         }
-        
-        rx_cnt += read_cnt;        
+
     }
     
     return true;
@@ -116,8 +119,8 @@ Message DriverVsCan::read()
         throw iodrivers_base::TimeoutError(
                 iodrivers_base::TimeoutError::PACKET, "read(): timeout");
     
-    Message msg = rx_queue.front();
-    rx_queue.pop_front();
+    Message msg;
+    rx_queue.pop(msg);
     
     return msg;
 }
@@ -3,8 +3,8 @@
 
 #include <canbus/Message.hpp>
 #include <canbus/Driver.hpp>
+#include <canbus/RingBuffer.hpp>
 #include <string>
-#include <deque>
 #include <iodrivers_base/Driver.hpp>
 #include <iodrivers_base/Timeout.hpp>
 
@@ -19,7 +19,7 @@ namespace canbus
         uint32_t m_read_timeout;
         uint32_t m_write_timeout;
 
-        std::deque<Message> rx_queue;
+        RingBuffer<Message> rx_queue;
         bool m_error;
 
         base::Time timestampBase;
@@ -0,0 +1,35 @@
+#include <canbus/Filter.hpp>
+
+using namespace canbus;
+
+FilterSet::FilterSet()
+{
+}
+
+FilterSet::FilterSet(std::vector<Filter> const& filters)
+    : mFilters(filters)
+{
+    for (uint32_t id = 0; id < STANDARD_ID_COUNT; ++id)
+        mStandard[id] = matchesAny(id);
+}
+
+std::vector<Filter> const& FilterSet::getFilters() const
+{
+    return mFilters;
+}
+
+bool FilterSet::empty() const
+{
+    return mFilters.empty();
+}
+
+bool FilterSet::matchesAny(uint32_t can_id) const
+{
+    for (std::vector<Filter>::const_iterator it = mFilters.begin();
+            it != mFilters.end(); ++it)
+    {
+        if (it->matches(can_id))
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,66 @@
+#ifndef CANBUS_FILTER_HH
+#define CANBUS_FILTER_HH
+
+#include <stdint.h>
+#include <bitset>
+#include <vector>
+
+namespace canbus
+{
+    /** An acceptance filter on the CAN ID
+     *
+     * It follows the semantic of SocketCAN's CAN_RAW_FILTER: a message
+     * matches if (can_id & mask) == (id & mask). An inverted filter matches
+     * all the messages that the non-inverted filter would reject.
+     */
+    struct Filter
+    {
+        uint32_t id;
+        uint32_t mask;
+        bool inverted;
+
+        Filter(uint32_t id = 0, uint32_t mask = 0, bool inverted = false)
+            : id(id), mask(mask), inverted(inverted) {}
+
+        bool matches(uint32_t can_id) const
+        {
+            return ((can_id & mask) == (id & mask)) != inverted;
+        }
+    };
+
+    /** A set of filters. A message is accepted if it matches any of them
+     *
+     * An empty set accepts all messages. The result for the 11-bit IDs is
+     * precomputed, so that the check costs a single lookup for standard
+     * frames.
+     */
+    class FilterSet
+    {
+    public:
+        FilterSet();
+        explicit FilterSet(std::vector<Filter> const& filters);
+
+        std::vector<Filter> const& getFilters() const;
+        bool empty() const;
+
+        bool accepts(uint32_t can_id) const
+        {
+            if (mFilters.empty())
+                return true;
+            else if (can_id < STANDARD_ID_COUNT)
+                return mStandard[can_id];
+            else
+                return matchesAny(can_id);
+        }
+
+    private:
+        static const uint32_t STANDARD_ID_COUNT = 2048;
+
+        bool matchesAny(uint32_t can_id) const;
+
+        std::vector<Filter> mFilters;
+        std::bitset<STANDARD_ID_COUNT> mStandard;
+    };
+}
+
+#endif
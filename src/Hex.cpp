@@ -0,0 +1,213 @@
+#include <canbus/Hex.hpp>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CANBUS_HEX_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CANBUS_HEX_NEON
+#endif
+
+using namespace canbus;
+
+/** The encoding of every byte value, two characters per byte */
+static const char HEX_PAIRS[] =
+    "000102030405060708090A0B0C0D0E0F"
+    "101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F"
+    "303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F"
+    "505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F"
+    "707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F"
+    "909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+    "B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+    "D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+    "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+int hex::scalar::toNibbles(uint8_t* nibbles, uint8_t const* input, int size)
+{
+    for (int i = 0; i < size; ++i)
+    {
+        uint8_t digit = input[i] - '0';
+        uint8_t upper = input[i] - 'A';
+        if (digit < 10)
+            nibbles[i] = digit;
+        else if (upper < 6)
+            nibbles[i] = upper + 10;
+        else
+            return i;
+    }
+    return size;
+}
+
+void hex::scalar::packNibbles(uint8_t* output, uint8_t const* nibbles, int byte_size)
+{
+    for (int i = 0; i < byte_size; ++i)
+        output[i] = nibbles[i * 2] << 4 | nibbles[i * 2 + 1];
+}
+
+#if defined(CANBUS_HEX_SSE2)
+
+/** Converts 16 characters, returning the index of the first invalid one or
+ * 16 if they are all valid
+ */
+static inline int toNibbles16(uint8_t* nibbles, uint8_t const* input)
+{
+    __m128i c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(input));
+    __m128i digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i upper = _mm_sub_epi8(c, _mm_set1_epi8('A'));
+
+    // SSE2 has no unsigned byte comparison. Flipping the sign bit of both
+    // sides turns it into a signed one
+    __m128i sign = _mm_set1_epi8(-128);
+    __m128i is_digit = _mm_cmplt_epi8(_mm_xor_si128(digit, sign), _mm_set1_epi8(-128 + 10));
+    __m128i is_upper = _mm_cmplt_epi8(_mm_xor_si128(upper, sign), _mm_set1_epi8(-128 + 6));
+
+    __m128i value = _mm_or_si128(
+        _mm_and_si128(is_digit, digit),
+        _mm_and_si128(is_upper, _mm_add_epi8(upper, _mm_set1_epi8(10))));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(nibbles), value);
+
+    int valid = _mm_movemask_epi8(_mm_or_si128(is_digit, is_upper));
+    if (valid == 0xFFFF)
+        return 16;
+    return __builtin_ctz(~valid);
+}
+
+/** Packs 16 nibbles into 8 bytes */
+static inline void packNibbles8(uint8_t* output, uint8_t const* nibbles)
+{
+    // In each 16-bit lane, the low byte is the most significant nibble
+    __m128i n = _mm_loadu_si128(reinterpret_cast<__m128i const*>(nibbles));
+    __m128i msn = _mm_and_si128(_mm_slli_epi16(n, 4), _mm_set1_epi16(0xF0));
+    __m128i lsn = _mm_srli_epi16(n, 8);
+    __m128i bytes = _mm_or_si128(msn, lsn);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output), _mm_packus_epi16(bytes, bytes));
+}
+
+#elif defined(CANBUS_HEX_NEON)
+
+static inline int toNibbles16(uint8_t* nibbles, uint8_t const* input)
+{
+    uint8x16_t c = vld1q_u8(input);
+    uint8x16_t digit = vsubq_u8(c, vdupq_n_u8('0'));
+    uint8x16_t upper = vsubq_u8(c, vdupq_n_u8('A'));
+    uint8x16_t is_digit = vcltq_u8(digit, vdupq_n_u8(10));
+    uint8x16_t is_upper = vcltq_u8(upper, vdupq_n_u8(6));
+
+    uint8x16_t value = vorrq_u8(
+        vandq_u8(is_digit, digit),
+        vandq_u8(is_upper, vaddq_u8(upper, vdupq_n_u8(10))));
+    vst1q_u8(nibbles, value);
+
+    // Horizontal AND of the validity mask, which also works on ARMv7
+    uint8x16_t valid = vorrq_u8(is_digit, is_upper);
+    uint8x8_t all = vand_u8(vget_low_u8(valid), vget_high_u8(valid));
+    all = vpmin_u8(all, all);
+    all = vpmin_u8(all, all);
+    all = vpmin_u8(all, all);
+    if (vget_lane_u8(all, 0) == 0xFF)
+        return 16;
+    return hex::scalar::toNibbles(nibbles, input, 16);
+}
+
+static inline void packNibbles8(uint8_t* output, uint8_t const* nibbles)
+{
+    uint8x8x2_t n = vld2_u8(nibbles);
+    vst1_u8(output, vorr_u8(vshl_n_u8(n.val[0], 4), n.val[1]));
+}
+
+#endif
+
+int hex::toNibbles(uint8_t* nibbles, uint8_t const* input, int size)
+{
+#if defined(CANBUS_HEX_SSE2) || defined(CANBUS_HEX_NEON)
+    if (size >= 16)
+    {
+        int i = 0;
+        for (; i + 16 <= size; i += 16)
+        {
+            int valid = toNibbles16(nibbles + i, input + i);
+            if (valid != 16)
+                return i + valid;
+        }
+        if (i == size)
+            return size;
+
+        // Convert the tail with a last vector that overlaps the previous one
+        int start = size - 16;
+        int valid = toNibbles16(nibbles + start, input + start);
+        return (valid == 16) ? size : start + valid;
+    }
+#endif
+    return scalar::toNibbles(nibbles, input, size);
+}
+
+void hex::packNibbles(uint8_t* output, uint8_t const* nibbles, int byte_size)
+{
+#if defined(CANBUS_HEX_SSE2) || defined(CANBUS_HEX_NEON)
+    if (byte_size >= 8)
+    {
+        int i = 0;
+        for (; i + 8 <= byte_size; i += 8)
+            packNibbles8(output + i, nibbles + i * 2);
+        if (i != byte_size)
+            packNibbles8(output + byte_size - 8, nibbles + (byte_size - 8) * 2);
+        return;
+    }
+#endif
+    scalar::packNibbles(output, nibbles, byte_size);
+}
+
+/** How many bytes decode() and findInvalid() convert at a time */
+static const int CHUNK_SIZE = 64;
+
+bool hex::decode(uint8_t* output, uint8_t const* input, int byte_size)
+{
+    uint8_t nibbles[CHUNK_SIZE * 2];
+    for (int i = 0; i < byte_size; i += CHUNK_SIZE)
+    {
+        int size = byte_size - i < CHUNK_SIZE ? byte_size - i : CHUNK_SIZE;
+        if (toNibbles(nibbles, input + i * 2, size * 2) != size * 2)
+            return false;
+        packNibbles(output + i, nibbles, size);
+    }
+    return true;
+}
+
+int hex::findInvalid(uint8_t const* input, int size)
+{
+    uint8_t nibbles[CHUNK_SIZE * 2];
+    for (int i = 0; i < size; i += CHUNK_SIZE * 2)
+    {
+        int chunk = size - i < CHUNK_SIZE * 2 ? size - i : CHUNK_SIZE * 2;
+        int valid = toNibbles(nibbles, input + i, chunk);
+        if (valid != chunk)
+            return i + valid;
+    }
+    return size;
+}
+
+uint8_t* hex::encode(uint8_t* output, uint8_t const* input, int byte_size)
+{
+    for (int i = 0; i < byte_size; ++i)
+        memcpy(output + i * 2, HEX_PAIRS + input[i] * 2, 2);
+    return output + byte_size * 2;
+}
+
+char const* hex::getImplementationName()
+{
+#if defined(CANBUS_HEX_SSE2)
+    return "sse2";
+#elif defined(CANBUS_HEX_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
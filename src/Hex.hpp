@@ -0,0 +1,62 @@
+#ifndef CANBUS_HEX_HH
+#define CANBUS_HEX_HH
+
+#include <stdint.h>
+
+namespace canbus
+{
+    /** Conversion between bytes and the uppercase hexadecimal text used by
+     * the ASCII (SLCAN) protocols
+     *
+     * The decoding functions validate their input in the same pass: only
+     * '0'-'9' and 'A'-'F' are accepted. They use SSE2 or NEON when the
+     * compiler targets them, and otherwise fall back to the scalar
+     * implementation, which is also available in hex::scalar.
+     */
+    namespace hex
+    {
+        /** Converts \c size hex characters into their values (0 to 15)
+         *
+         * @return the number of leading characters that are valid hex
+         *   digits, i.e. \c size if they all are. The nibbles after the first
+         *   invalid character are undefined.
+         */
+        int toNibbles(uint8_t* nibbles, uint8_t const* input, int size);
+
+        /** Combines the 2 * \c byte_size nibbles returned by toNibbles into
+         * bytes, most significant nibble first
+         */
+        void packNibbles(uint8_t* output, uint8_t const* nibbles, int byte_size);
+
+        /** Decodes 2 * \c byte_size hex characters into \c byte_size bytes
+         *
+         * @return false if one of the characters is not a hex digit
+         */
+        bool decode(uint8_t* output, uint8_t const* input, int byte_size);
+
+        /** Returns the index of the first of \c size characters that is not
+         * a hex digit, or \c size if they all are
+         */
+        int findInvalid(uint8_t const* input, int size);
+
+        /** Encodes \c byte_size bytes into 2 * \c byte_size hex characters
+         *
+         * @return the end of the written characters
+         */
+        uint8_t* encode(uint8_t* output, uint8_t const* input, int byte_size);
+
+        /** The name of the decoding implementation: sse2, neon or scalar */
+        char const* getImplementationName();
+
+        /** The scalar implementation, used for the parts of the buffers that
+         * are too short for the vector code
+         */
+        namespace scalar
+        {
+            int toNibbles(uint8_t* nibbles, uint8_t const* input, int size);
+            void packNibbles(uint8_t* output, uint8_t const* nibbles, int byte_size);
+        }
+    }
+}
+
+#endif
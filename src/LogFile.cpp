@@ -0,0 +1,361 @@
+#include <canbus/LogFile.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <new>
+
+using namespace canbus;
+using iodrivers_base::UnixError;
+
+static_assert(sizeof(LogRecord) == 32, "LogRecord must stay 32 bytes long");
+static_assert(sizeof(LogBlockHeader) == 32, "LogBlockHeader must stay 32 bytes long");
+static_assert(sizeof(LogFileHeader) <= LOG_BLOCK_SIZE, "LogFileHeader must fit in a block");
+
+LogRecord LogRecord::fromMessage(Message const& msg)
+{
+    LogRecord record;
+    record.time = msg.time.toMicroseconds();
+    record.can_time = msg.can_time.toMicroseconds();
+    record.can_id = msg.can_id;
+    record.size = msg.size;
+    memset(record.reserved, 0, sizeof(record.reserved));
+    memcpy(record.data, msg.data, 8);
+    return record;
+}
+
+Message LogRecord::toMessage() const
+{
+    Message msg;
+    msg.time = base::Time::fromMicroseconds(time);
+    msg.can_time = base::Time::fromMicroseconds(can_time);
+    msg.can_id = can_id;
+    msg.size = size;
+    memcpy(msg.data, data, 8);
+    return msg;
+}
+
+LogWriter::LogWriter(size_t buffer_blocks)
+    : m_fd(-1)
+    , m_buffer(NULL)
+    , m_buffer_blocks(buffer_blocks == 0 ? 1 : buffer_blocks)
+    , m_current(0)
+    , m_block_index(0)
+    , m_record_count(0)
+{
+    // O_DIRECT requires the buffer to be aligned on the block size
+    void* buffer;
+    if (posix_memalign(&buffer, LOG_BLOCK_SIZE, m_buffer_blocks * LOG_BLOCK_SIZE) != 0)
+        throw std::bad_alloc();
+    m_buffer = static_cast<uint8_t*>(buffer);
+}
+
+LogWriter::~LogWriter()
+{
+    try { close(); }
+    catch(UnixError&) {}
+    free(m_buffer);
+}
+
+bool LogWriter::open(std::string const& path, bool direct)
+{
+    close();
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    if (direct)
+        flags |= O_DIRECT;
+    int fd = ::open(path.c_str(), flags, 0644);
+    if (fd == -1)
+        return false;
+    m_fd = fd;
+
+    memset(m_buffer, 0, LOG_BLOCK_SIZE);
+    LogFileHeader& header = *reinterpret_cast<LogFileHeader*>(m_buffer);
+    memcpy(header.magic, LOG_FILE_MAGIC, sizeof(header.magic));
+    header.version = LOG_FILE_VERSION;
+    header.byte_order = LOG_BYTE_ORDER_MARK;
+    header.block_size = LOG_BLOCK_SIZE;
+    header.record_size = sizeof(LogRecord);
+    try { writeBuffer(1); }
+    catch(UnixError&) {
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_current = 0;
+    m_block_index = 0;
+    m_record_count = 0;
+    startBlock();
+    return true;
+}
+
+bool LogWriter::isValid() const
+{
+    return m_fd != -1;
+}
+
+LogBlockHeader& LogWriter::currentBlock()
+{
+    return *reinterpret_cast<LogBlockHeader*>(m_buffer + m_current * LOG_BLOCK_SIZE);
+}
+
+void LogWriter::startBlock()
+{
+    uint8_t* block = m_buffer + m_current * LOG_BLOCK_SIZE;
+    memset(block, 0, LOG_BLOCK_SIZE);
+    LogBlockHeader& header = currentBlock();
+    header.magic = LOG_BLOCK_MAGIC;
+    header.index = m_block_index++;
+}
+
+void LogWriter::write(Message const& msg)
+{
+    LogBlockHeader& header = currentBlock();
+    LogRecord* records = reinterpret_cast<LogRecord*>(&header + 1);
+    LogRecord& record = records[header.count];
+    record = LogRecord::fromMessage(msg);
+    if (header.count == 0)
+        header.first_time = record.time;
+    header.last_time = record.time;
+    ++header.count;
+    ++m_record_count;
+
+    if (header.count < LOG_RECORDS_PER_BLOCK)
+        return;
+
+    if (++m_current < m_buffer_blocks) {
+        startBlock();
+        return;
+    }
+
+    // Start over with an empty buffer even if it could not be written, or
+    // the next call would write past its end. The buffered records are
+    // lost in that case
+    m_current = 0;
+    try { writeBuffer(m_buffer_blocks); }
+    catch(UnixError&) {
+        startBlock();
+        throw;
+    }
+    startBlock();
+}
+
+void LogWriter::flush()
+{
+    if (!isValid())
+        return;
+
+    bool partial = currentBlock().count > 0;
+    size_t blocks = m_current + (partial ? 1 : 0);
+    if (blocks == 0)
+        return;
+
+    LogBlockHeader empty = currentBlock();
+    writeBuffer(blocks);
+    m_current = 0;
+    if (partial)
+        startBlock();
+    else {
+        // Keep the block that has been started but not filled yet
+        memset(m_buffer, 0, LOG_BLOCK_SIZE);
+        currentBlock() = empty;
+    }
+}
+
+void LogWriter::writeBuffer(size_t blocks)
+{
+    uint8_t const* data = m_buffer;
+    size_t size = blocks * LOG_BLOCK_SIZE;
+    while (size > 0) {
+        ssize_t c = ::write(m_fd, data, size);
+        if (c == -1) {
+            if (errno == EINTR)
+                continue;
+            throw UnixError("LogWriter: cannot write to the log file");
+        }
+        data += c;
+        size -= c;
+    }
+}
+
+void LogWriter::close()
+{
+    if (!isValid())
+        return;
+
+    try { flush(); }
+    catch(UnixError&) {
+        ::close(m_fd);
+        m_fd = -1;
+        throw;
+    }
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+uint64_t LogWriter::getRecordCount() const
+{
+    return m_record_count;
+}
+
+uint64_t LogWriter::getBlockCount() const
+{
+    return m_block_index;
+}
+
+LogReader::LogReader()
+    : m_fd(-1)
+    , m_data(NULL)
+    , m_size(0)
+    , m_block_count(0)
+    , m_block(0)
+    , m_record(0) {}
+
+LogReader::~LogReader()
+{
+    close();
+}
+
+bool LogReader::open(std::string const& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < static_cast<off_t>(LOG_BLOCK_SIZE)) {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    LogFileHeader const& header = *static_cast<LogFileHeader const*>(data);
+    if (memcmp(header.magic, LOG_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != LOG_FILE_VERSION ||
+        header.byte_order != LOG_BYTE_ORDER_MARK ||
+        header.block_size != LOG_BLOCK_SIZE ||
+        header.record_size != sizeof(LogRecord)) {
+        munmap(data, st.st_size);
+        ::close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    m_data = static_cast<uint8_t const*>(data);
+    m_size = st.st_size;
+    // An interrupted write may leave a truncated block at the end
+    m_block_count = m_size / LOG_BLOCK_SIZE - 1;
+    rewind();
+    return true;
+}
+
+void LogReader::close()
+{
+    if (!isValid())
+        return;
+
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+    ::close(m_fd);
+    m_fd = -1;
+    m_data = NULL;
+    m_size = 0;
+    m_block_count = 0;
+}
+
+bool LogReader::isValid() const
+{
+    return m_fd != -1;
+}
+
+size_t LogReader::getBlockCount() const
+{
+    return m_block_count;
+}
+
+LogBlockHeader const& LogReader::getBlockHeader(size_t block) const
+{
+    return *reinterpret_cast<LogBlockHeader const*>(
+            m_data + (block + 1) * LOG_BLOCK_SIZE);
+}
+
+LogRecord const* LogReader::getRecords(size_t block) const
+{
+    return reinterpret_cast<LogRecord const*>(&getBlockHeader(block) + 1);
+}
+
+bool LogReader::isBlockValid(size_t block) const
+{
+    LogBlockHeader const& header = getBlockHeader(block);
+    return header.magic == LOG_BLOCK_MAGIC &&
+        header.count <= LOG_RECORDS_PER_BLOCK;
+}
+
+LogRecord const* LogReader::next()
+{
+    while (m_block < m_block_count) {
+        if (isBlockValid(m_block) && m_record < getBlockHeader(m_block).count)
+            return &getRecords(m_block)[m_record++];
+
+        ++m_block;
+        m_record = 0;
+    }
+    return NULL;
+}
+
+bool LogReader::read(Message& msg)
+{
+    LogRecord const* record = next();
+    if (!record)
+        return false;
+    msg = record->toMessage();
+    return true;
+}
+
+void LogReader::rewind()
+{
+    m_block = 0;
+    m_record = 0;
+}
+
+void LogReader::seek(base::Time const& time)
+{
+    int64_t target = time.toMicroseconds();
+
+    // Find the first block whose last record is at or after the target.
+    // Invalid blocks are considered to be before it
+    size_t low = 0;
+    size_t high = m_block_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        LogBlockHeader const& header = getBlockHeader(mid);
+        if (!isBlockValid(mid) || header.count == 0 || header.last_time < target)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    m_block = low;
+    m_record = 0;
+    if (m_block == m_block_count)
+        return;
+
+    LogRecord const* records = getRecords(m_block);
+    uint32_t count = getBlockHeader(m_block).count;
+    while (m_record < count && records[m_record].time < target)
+        ++m_record;
+}
@@ -0,0 +1,196 @@
+#ifndef CANBUS_LOG_FILE_HH
+#define CANBUS_LOG_FILE_HH
+
+#include <canbus/Message.hpp>
+#include <string>
+
+namespace canbus
+{
+    /** Binary CAN log format
+     *
+     * A log file is a LogFileHeader padded to LOG_BLOCK_SIZE bytes, followed
+     * by blocks of LOG_BLOCK_SIZE bytes. Each block starts with a
+     * LogBlockHeader and holds up to LOG_RECORDS_PER_BLOCK fixed-size
+     * LogRecord. Blocks are only appended, never rewritten, and the last
+     * blocks of a file may not be full.
+     *
+     * All fields are stored in the host byte order, which is recorded in the
+     * file header.
+     */
+    static const uint32_t LOG_BLOCK_SIZE = 4096;
+    static const char LOG_FILE_MAGIC[8] = { 'C', 'A', 'N', 'B', 'U', 'S', 'L', 'G' };
+    static const uint32_t LOG_FILE_VERSION = 1;
+    static const uint32_t LOG_BLOCK_MAGIC = 0x4b4c4243; // "CBLK"
+    static const uint32_t LOG_BYTE_ORDER_MARK = 0x01020304;
+
+    struct LogFileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t block_size;
+        uint32_t record_size;
+    };
+
+    struct LogBlockHeader
+    {
+        uint32_t magic;
+        /** Number of valid records in the block */
+        uint32_t count;
+        /** Sequence number of the block in the file, starting at 0 */
+        uint64_t index;
+        /** Message::time of the first and last record, in microseconds */
+        int64_t first_time;
+        int64_t last_time;
+    };
+
+    struct LogRecord
+    {
+        /** Message::time in microseconds */
+        int64_t time;
+        /** Message::can_time in microseconds */
+        int64_t can_time;
+        uint32_t can_id;
+        uint8_t size;
+        uint8_t reserved[3];
+        uint8_t data[8];
+
+        static LogRecord fromMessage(Message const& msg);
+        Message toMessage() const;
+    };
+
+    static const uint32_t LOG_RECORDS_PER_BLOCK =
+        (LOG_BLOCK_SIZE - sizeof(LogBlockHeader)) / sizeof(LogRecord);
+
+    /** Appends messages to a log file
+     *
+     * Records are accumulated in a memory buffer of several blocks, which is
+     * written with a single system call when it is full or on flush(). The
+     * file can be opened with O_DIRECT to bypass the page cache.
+     */
+    class LogWriter
+    {
+    public:
+        /** The default size of the write buffer, in blocks */
+        static const size_t DEFAULT_BUFFER_BLOCKS = 256;
+
+        explicit LogWriter(size_t buffer_blocks = DEFAULT_BUFFER_BLOCKS);
+        ~LogWriter();
+
+        /** Creates or truncates the given file and writes the file header
+         *
+         * @param direct whether the file should be opened with O_DIRECT. It
+         *   fails on file systems that do not support it.
+         * @return false if the file could not be opened
+         */
+        bool open(std::string const& path, bool direct = false);
+
+        bool isValid() const;
+
+        /** Appends a message
+         *
+         * It may write the buffer to disk, and throws UnixError if that
+         * fails
+         */
+        void write(Message const& msg);
+
+        /** Writes all buffered records to disk
+         *
+         * If the current block is not full, it is written as is and the next
+         * record starts a new block
+         */
+        void flush();
+
+        /** Flushes and closes the file */
+        void close();
+
+        /** How many records have been written since open() */
+        uint64_t getRecordCount() const;
+
+        /** How many blocks have been started since open() */
+        uint64_t getBlockCount() const;
+
+    private:
+        int m_fd;
+        uint8_t* m_buffer;
+        size_t m_buffer_blocks;
+        /** Index of the block being filled in m_buffer */
+        size_t m_current;
+        uint64_t m_block_index;
+        uint64_t m_record_count;
+
+        LogBlockHeader& currentBlock();
+        void startBlock();
+        void writeBuffer(size_t blocks);
+
+        LogWriter(LogWriter const&);
+        LogWriter& operator = (LogWriter const&);
+    };
+
+    /** Reads a log file written by LogWriter
+     *
+     * The file is memory-mapped, records are accessed in place
+     */
+    class LogReader
+    {
+    public:
+        LogReader();
+        ~LogReader();
+
+        /** Maps the given file and validates its header
+         *
+         * @return false if the file cannot be opened or is not a log file
+         */
+        bool open(std::string const& path);
+        void close();
+        bool isValid() const;
+
+        /** The number of complete blocks in the file */
+        size_t getBlockCount() const;
+
+        /** The header of the given block. The block's magic must be checked
+         * before using it, as a block may be corrupted
+         */
+        LogBlockHeader const& getBlockHeader(size_t block) const;
+
+        /** The records of the given block */
+        LogRecord const* getRecords(size_t block) const;
+
+        /** Reads the next message and advances the cursor
+         *
+         * @return false at the end of the file
+         */
+        bool read(Message& msg);
+
+        /** Returns the next record without copying it, and advances the
+         * cursor
+         *
+         * @return NULL at the end of the file
+         */
+        LogRecord const* next();
+
+        /** Moves the cursor back to the first record */
+        void rewind();
+
+        /** Moves the cursor to the first block that may contain records
+         * received at or after \c time, using the block timestamps
+         */
+        void seek(base::Time const& time);
+
+    private:
+        int m_fd;
+        uint8_t const* m_data;
+        size_t m_size;
+        size_t m_block_count;
+
+        size_t m_block;
+        uint32_t m_record;
+
+        bool isBlockValid(size_t block) const;
+
+        LogReader(LogReader const&);
+        LogReader& operator = (LogReader const&);
+    };
+}
+
+#endif
@@ -22,7 +22,10 @@ namespace canbus
         VS_CAN,
         CAN2WEB,
         NET_GATEWAY,
-        EASY_SYNC
+        EASY_SYNC,
+        SOCKET_MMAP,
+        REPLAY,
+        LOOPBACK
     };
 
     /** Values used to encode specific flags in the can_id field of Message
@@ -73,6 +76,55 @@ namespace canbus
         }
     };
 
+    /** Values used to encode CAN FD specific flags in the flags field of
+     * MessageFD
+     */
+    enum MessageFDFlags {
+        /** The data phase was sent at the higher bit rate */
+        FLAG_BIT_RATE_SWITCH = 0x01,
+        /** The transmitting node is error passive */
+        FLAG_ERROR_STATE_INDICATOR = 0x02
+    };
+
+    /** A decoded CAN FD frame
+     *
+     * It is separate from Message so that classic frames keep their 8-byte
+     * payload
+     */
+    struct MessageFD
+    {
+        static const int MAX_SIZE = 64;
+
+        base::Time time;
+        base::Time can_time;
+
+        /** CAN ID and special flags, see Message::can_id */
+        uint32_t can_id;
+
+        /** Actual data in the frame */
+        uint8_t  data[MAX_SIZE];
+
+        /** How many valid bytes there is in data
+         *
+         * CAN FD allows 0 to 8, 12, 16, 20, 24, 32, 48 and 64 bytes
+         */
+        uint8_t  size;
+
+        /** A combination of MessageFDFlags */
+        uint8_t  flags;
+
+        static MessageFD Zeroed() {
+            MessageFD result;
+            result.can_id = 0;
+            for (int i = 0; i < MAX_SIZE; ++i) {
+                result.data[i] = 0;
+            }
+            result.size = 0;
+            result.flags = 0;
+            return result;
+        }
+    };
+
     struct Status
     {
       base::Time time;
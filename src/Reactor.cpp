@@ -0,0 +1,221 @@
+#include <canbus/Reactor.hpp>
+#include <base-logging/Logging.hpp>
+#include <iodrivers_base/Driver.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace canbus;
+using iodrivers_base::UnixError;
+
+/** epoll data of the stop eventfd. The buses use their index */
+static const uint32_t STOP_EVENT = 0xFFFFFFFF;
+
+Reactor::Reactor()
+    : m_stop(false)
+    , m_budget(DEFAULT_BUDGET)
+    , m_dispatched(0)
+    , m_current_bus(ANY_BUS)
+{
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd == -1)
+        throw UnixError("Reactor: cannot create epoll set");
+    m_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_stop_fd == -1) {
+        ::close(m_epoll_fd);
+        throw UnixError("Reactor: cannot create eventfd");
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = STOP_EVENT;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_stop_fd, &event) == -1) {
+        ::close(m_stop_fd);
+        ::close(m_epoll_fd);
+        throw UnixError("Reactor: cannot register eventfd");
+    }
+}
+
+Reactor::~Reactor()
+{
+    ::close(m_stop_fd);
+    ::close(m_epoll_fd);
+}
+
+int Reactor::addBus(Driver& driver, Callback const& callback)
+{
+    int fd = driver.getFileDescriptor();
+    if (fd == iodrivers_base::Driver::INVALID_FD)
+        throw std::invalid_argument("Reactor: the driver has no file descriptor");
+
+    int index = m_buses.size();
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = index;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1)
+        throw UnixError("Reactor: cannot register the driver's file descriptor");
+
+    Bus bus = { &driver, callback, false, Dispatcher() };
+    m_buses.push_back(bus);
+
+    // The driver may already hold messages that will not make its file
+    // descriptor readable
+    m_buses[index].pending = true;
+    m_ready.push_back(index);
+    return index;
+}
+
+void Reactor::removeBus(int bus)
+{
+    Driver* driver = m_buses.at(bus).driver;
+    if (!driver)
+        return;
+
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, driver->getFileDescriptor(), NULL);
+    m_buses[bus].driver = NULL;
+    m_buses[bus].pending = false;
+}
+
+Driver& Reactor::getDriver(int bus) const
+{
+    Driver* driver = m_buses.at(bus).driver;
+    if (!driver)
+        throw std::invalid_argument("Reactor: bus has been removed");
+    return *driver;
+}
+
+void Reactor::subscribe(uint32_t can_id, Callback const& callback, int bus)
+{
+    Dispatcher& dispatcher = (bus == ANY_BUS) ? m_subscriptions : m_buses.at(bus).subscriptions;
+    dispatcher.subscribe(can_id, [this, callback](Message const& msg) {
+        callback(m_current_bus, msg);
+    });
+}
+
+void Reactor::unsubscribe(uint32_t can_id, int bus)
+{
+    Dispatcher& dispatcher = (bus == ANY_BUS) ? m_subscriptions : m_buses.at(bus).subscriptions;
+    dispatcher.unsubscribeID(can_id);
+}
+
+void Reactor::setBudget(size_t budget)
+{
+    m_budget = std::max<size_t>(1, budget);
+}
+
+size_t Reactor::getBudget() const
+{
+    return m_budget;
+}
+
+uint64_t Reactor::getDispatchedCount() const
+{
+    return m_dispatched;
+}
+
+size_t Reactor::runOnce(int timeout_ms)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(m_epoll_fd, events, MAX_EVENTS,
+            m_ready.empty() ? timeout_ms : 0);
+    if (count == -1)
+    {
+        if (errno != EINTR)
+            throw UnixError("Reactor: error in epoll_wait()");
+        count = 0;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        uint32_t index = events[i].data.u32;
+        if (index == STOP_EVENT)
+        {
+            clearStop();
+            continue;
+        }
+
+        Bus& bus = m_buses[index];
+        if (!bus.driver || bus.pending)
+            continue;
+        if (!(events[i].events & EPOLLIN))
+        {
+            LOG_WARN("Reactor: error on the file descriptor of bus %u, removing it", index);
+            removeBus(index);
+            continue;
+        }
+        bus.pending = true;
+        m_ready.push_back(index);
+    }
+
+    // Give every ready bus one turn. The ones that run out of budget are
+    // serviced again on the next call, after the other buses
+    std::vector<int> ready;
+    ready.swap(m_ready);
+    size_t dispatched = 0;
+    for (int index : ready)
+        dispatched += service(index);
+    return dispatched;
+}
+
+size_t Reactor::service(int index)
+{
+    if (!m_buses[index].driver)
+        return 0;
+
+    size_t dispatched = 0;
+    m_buses[index].pending = false;
+    try {
+        size_t pending = m_buses[index].driver->getPendingMessagesCount();
+        size_t count = std::min(pending, m_budget);
+        for (; dispatched < count && m_buses[index].driver; ++dispatched)
+            dispatch(index, m_buses[index].driver->read());
+
+        if (pending > count && m_buses[index].driver)
+        {
+            m_buses[index].pending = true;
+            m_ready.push_back(index);
+        }
+    }
+    catch(std::exception const& e) {
+        LOG_WARN("Reactor: bus %i: %s", index, e.what());
+    }
+    return dispatched;
+}
+
+void Reactor::dispatch(int bus, Message const& msg)
+{
+    ++m_dispatched;
+    m_current_bus = bus;
+    if (m_buses[bus].callback)
+        m_buses[bus].callback(bus, msg);
+    if (m_buses[bus].driver)
+        m_buses[bus].subscriptions.dispatch(msg);
+    m_subscriptions.dispatch(msg);
+}
+
+void Reactor::run()
+{
+    while (!m_stop.load())
+        runOnce(-1);
+    m_stop.store(false);
+}
+
+void Reactor::stop()
+{
+    m_stop.store(true);
+    uint64_t value = 1;
+    // Only fails if the counter is saturated, i.e. already signalled
+    if (::write(m_stop_fd, &value, sizeof(value)) == -1) {}
+}
+
+void Reactor::clearStop()
+{
+    uint64_t value;
+    if (::read(m_stop_fd, &value, sizeof(value)) == -1 && errno != EAGAIN)
+        throw UnixError("Reactor: cannot reset eventfd");
+}
@@ -0,0 +1,140 @@
+#ifndef CANBUS_REACTOR_HH
+#define CANBUS_REACTOR_HH
+
+#include <canbus/Dispatcher.hpp>
+#include <canbus/Driver.hpp>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace canbus
+{
+    /** Services many buses from a single thread
+     *
+     * The drivers' file descriptors are registered in one epoll set. When
+     * one becomes readable, the reactor reads the driver's pending messages
+     * and hands them over to the callbacks registered for the bus, and to
+     * the ones subscribed to the message's ID.
+     *
+     * A bus is serviced at most for a budget of messages at a time (see
+     * setBudget), after which the other ready buses get their turn. This
+     * bounds the latency that a busy bus can impose on the others.
+     *
+     * Only drivers that have a file descriptor can be registered. Wrap the
+     * others (e.g. DriverLoopback or DriverReplay) in an AsyncReceiver.
+     *
+     * Except for stop(), the methods must be called from the thread that
+     * runs the reactor. The callbacks may call removeBus() and stop(), but
+     * must not add buses or change the subscriptions.
+     */
+    class Reactor
+    {
+    public:
+        /** Called with the index of the bus, as returned by addBus, and the
+         * received message
+         */
+        typedef std::function<void (int bus, Message const& msg)> Callback;
+
+        /** Bus index used to subscribe to an ID on all buses */
+        static const int ANY_BUS = -1;
+        /** The default maximum number of messages read from one bus before
+         * servicing the others
+         */
+        static const size_t DEFAULT_BUDGET = 64;
+        /** Maximum number of epoll events handled per iteration */
+        static const int MAX_EVENTS = 64;
+
+        Reactor();
+        ~Reactor();
+
+        /** Registers a driver
+         *
+         * The reactor does not take ownership of the driver, which must
+         * stay valid until it is removed or the reactor is destroyed.
+         *
+         * @param callback called for every message received on this bus
+         * @return the index of the bus
+         * @throw std::invalid_argument if the driver has no file descriptor
+         */
+        int addBus(Driver& driver, Callback const& callback = Callback());
+
+        /** Unregisters a bus. Its index is not reused */
+        void removeBus(int bus);
+
+        /** The driver of the given bus */
+        Driver& getDriver(int bus) const;
+
+        /** Calls \c callback for the messages with the given ID
+         *
+         * The ID is matched against Message::can_id, flags included
+         *
+         * @param bus the bus on which the ID is expected, or ANY_BUS
+         */
+        void subscribe(uint32_t can_id, Callback const& callback, int bus = ANY_BUS);
+
+        /** Removes all the callbacks subscribed to the given ID on the given
+         * bus
+         */
+        void unsubscribe(uint32_t can_id, int bus = ANY_BUS);
+
+        /** Sets how many messages are read from a bus before servicing the
+         * others
+         */
+        void setBudget(size_t budget);
+
+        size_t getBudget() const;
+
+        /** Waits up to \c timeout_ms for messages and dispatches them
+         *
+         * @return the number of messages dispatched
+         */
+        size_t runOnce(int timeout_ms);
+
+        /** Dispatches messages until stop() is called */
+        void run();
+
+        /** Makes run() return
+         *
+         * It may be called from any thread, or from a signal handler
+         */
+        void stop();
+
+        /** The number of messages dispatched so far */
+        uint64_t getDispatchedCount() const;
+
+    private:
+        struct Bus
+        {
+            Driver* driver;
+            Callback callback;
+            /** Whether the bus still had messages when it ran out of budget */
+            bool pending;
+            /** The callbacks subscribed to IDs on this bus only */
+            Dispatcher subscriptions;
+        };
+
+        int m_epoll_fd;
+        /** eventfd used to wake up run() on stop() */
+        int m_stop_fd;
+        std::atomic<bool> m_stop;
+        size_t m_budget;
+        uint64_t m_dispatched;
+
+        /** The registered buses, indexed by bus index. Removed buses have
+         * a NULL driver
+         */
+        std::vector<Bus> m_buses;
+        /** The buses that are readable, or that ran out of budget */
+        std::vector<int> m_ready;
+        /** The callbacks subscribed to IDs on all buses */
+        Dispatcher m_subscriptions;
+        /** The bus whose message is being dispatched */
+        int m_current_bus;
+
+        size_t service(int bus);
+        void dispatch(int bus, Message const& msg);
+        void clearStop();
+    };
+}
+
+#endif
@@ -0,0 +1,292 @@
+#ifndef CANBUS_RING_BUFFER_HH
+#define CANBUS_RING_BUFFER_HH
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+
+namespace canbus
+{
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    /** Allocator returning cache-line aligned memory
+     *
+     * C++11's operator new ignores over-aligned types, so the storage of
+     * the alignas(CACHE_LINE_SIZE) types is allocated with posix_memalign
+     */
+    template<typename T>
+    struct CacheAlignedAllocator
+    {
+        typedef T value_type;
+
+        CacheAlignedAllocator() {}
+        template<typename U>
+        CacheAlignedAllocator(CacheAlignedAllocator<U> const&) {}
+
+        T* allocate(size_t n)
+        {
+            void* ptr;
+            if (posix_memalign(&ptr, CACHE_LINE_SIZE, n * sizeof(T)) != 0)
+                throw std::bad_alloc();
+            return static_cast<T*>(ptr);
+        }
+
+        void deallocate(T* ptr, size_t)
+        {
+            free(ptr);
+        }
+    };
+
+    template<typename T, typename U>
+    bool operator==(CacheAlignedAllocator<T> const&, CacheAlignedAllocator<U> const&)
+    {
+        return true;
+    }
+
+    template<typename T, typename U>
+    bool operator!=(CacheAlignedAllocator<T> const&, CacheAlignedAllocator<U> const&)
+    {
+        return false;
+    }
+
+    /** Fixed-capacity single-producer/single-consumer queue
+     *
+     * One thread may push() while another one pop()s without any lock. The
+     * write index, the read index and the slot array each start on their
+     * own cache line, so that producer and consumer do not invalidate each
+     * other's cache on every operation.
+     *
+     * The slot count is capacity + 1 rounded up to a power of two, the
+     * spare slot being used in DROP_OLDEST mode (see below). Capacities of
+     * the form 2^n - 1, such as DEFAULT_CAPACITY, use all the slots.
+     *
+     * When the queue is full, push() either drops the incoming element
+     * (DROP_NEWEST) or the oldest queued element (DROP_OLDEST). In both
+     * cases, the drop is accounted for in getDroppedCount().
+     *
+     * In DROP_OLDEST mode, the producer advances the read index itself. The
+     * consumer therefore claims an element by advancing the read index with
+     * a compare-and-swap before copying it out, and announces the slot it
+     * is copying. The producer never writes into the announced slot: if it
+     * laps a consumer stalled in the middle of a copy, it drops the
+     * incoming element instead.
+     */
+    template<typename T>
+    class RingBuffer
+    {
+    public:
+        enum OVERFLOW_POLICY
+        {
+            DROP_OLDEST,
+            DROP_NEWEST
+        };
+
+        static const size_t DEFAULT_CAPACITY = 4095;
+
+        explicit RingBuffer(size_t capacity = DEFAULT_CAPACITY,
+                OVERFLOW_POLICY policy = DROP_OLDEST)
+            : mIndices(1)
+        {
+            reset(capacity, policy);
+        }
+
+        /** Reallocates the queue, discarding its content and counters
+         *
+         * Unlike the other methods, it must not be called while the queue
+         * is used by other threads.
+         */
+        void reset(size_t capacity, OVERFLOW_POLICY policy)
+        {
+            if (capacity == 0)
+                capacity = 1;
+
+            size_t slots = 1;
+            while (slots < capacity + 1)
+                slots <<= 1;
+
+            mSlots.clear();
+            mSlots.resize(slots);
+            mMask = slots - 1;
+            mCapacity = capacity;
+            mPolicy = policy;
+            head().store(0);
+            dropped().store(0);
+            tail().store(0);
+            reading().store(NOT_READING);
+        }
+
+        /** Producer side: queues a copy of \c value
+         *
+         * @return false if \c value has been dropped. In DROP_NEWEST mode,
+         *   it happens when the queue is full. In DROP_OLDEST mode, only
+         *   when the consumer is copying the slot \c value would be
+         *   written into.
+         */
+        bool push(T const& value)
+        {
+            uint64_t head = this->head().load(std::memory_order_relaxed);
+            if (mPolicy == DROP_NEWEST)
+            {
+                uint64_t tail = this->tail().load(std::memory_order_acquire);
+                if (head - tail >= mCapacity)
+                {
+                    dropped().fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+            else
+            {
+                // The sequentially consistent operations on the read index
+                // and on the announced slot guarantee that, if the producer
+                // does not see the announce, the consumer claims a slot
+                // the producer does not write
+                uint64_t tail = this->tail().load(std::memory_order_seq_cst);
+                if (head - tail >= mCapacity)
+                {
+                    // If the exchange fails, the consumer popped an element
+                    // in the meantime and there is room again
+                    if (this->tail().compare_exchange_strong(tail, tail + 1,
+                                std::memory_order_seq_cst))
+                        dropped().fetch_add(1, std::memory_order_relaxed);
+                }
+
+                uint64_t reading = this->reading().load(std::memory_order_seq_cst);
+                if (reading != NOT_READING && ((head - reading) & mMask) == 0)
+                {
+                    dropped().fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+
+            mSlots[head & mMask] = value;
+            this->head().store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** Consumer side: removes the oldest element and copies it into
+         * \c value
+         *
+         * @return false if the queue was empty
+         */
+        bool pop(T& value)
+        {
+            uint64_t tail = this->tail().load(std::memory_order_acquire);
+            if (mPolicy == DROP_NEWEST)
+            {
+                if (tail == head().load(std::memory_order_acquire))
+                    return false;
+                value = mSlots[tail & mMask];
+                this->tail().store(tail + 1, std::memory_order_release);
+                return true;
+            }
+
+            while (true)
+            {
+                if (tail == head().load(std::memory_order_acquire))
+                {
+                    reading().store(NOT_READING, std::memory_order_release);
+                    return false;
+                }
+
+                reading().store(tail, std::memory_order_seq_cst);
+                if (this->tail().compare_exchange_weak(tail, tail + 1,
+                            std::memory_order_seq_cst, std::memory_order_seq_cst))
+                {
+                    value = mSlots[tail & mMask];
+                    reading().store(NOT_READING, std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+
+        /** Consumer side: removes all queued elements */
+        void clear()
+        {
+            uint64_t tail = this->tail().load(std::memory_order_acquire);
+            while (!this->tail().compare_exchange_weak(tail,
+                        head().load(std::memory_order_acquire),
+                        std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+            }
+        }
+
+        /** The number of queued elements
+         *
+         * It is exact only when called from the producer or the consumer
+         * thread while the other side is idle
+         */
+        size_t size() const
+        {
+            uint64_t tail = this->tail().load(std::memory_order_acquire);
+            uint64_t head = this->head().load(std::memory_order_acquire);
+            size_t result = head - tail;
+            return result < mCapacity ? result : mCapacity;
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        size_t capacity() const
+        {
+            return mCapacity;
+        }
+
+        OVERFLOW_POLICY getOverflowPolicy() const
+        {
+            return mPolicy;
+        }
+
+        /** How many elements have been dropped because the queue was full */
+        uint64_t getDroppedCount() const
+        {
+            return dropped().load(std::memory_order_relaxed);
+        }
+
+    private:
+        /** Value of the announced slot when the consumer is not copying */
+        static const uint64_t NOT_READING = ~static_cast<uint64_t>(0);
+
+        /** Cache line written by the producer */
+        struct alignas(CACHE_LINE_SIZE) ProducerIndices
+        {
+            std::atomic<uint64_t> head;
+            std::atomic<uint64_t> dropped;
+        };
+
+        /** Cache line written by the consumer, and by the producer when it
+         * drops the oldest element
+         */
+        struct alignas(CACHE_LINE_SIZE) ConsumerIndices
+        {
+            std::atomic<uint64_t> tail;
+            std::atomic<uint64_t> reading;
+        };
+
+        struct Indices
+        {
+            ProducerIndices producer;
+            ConsumerIndices consumer;
+        };
+
+        std::vector<Indices, CacheAlignedAllocator<Indices>> mIndices;
+        std::vector<T, CacheAlignedAllocator<T>> mSlots;
+        uint64_t mMask;
+        size_t mCapacity;
+        OVERFLOW_POLICY mPolicy;
+
+        std::atomic<uint64_t>& head() { return mIndices[0].producer.head; }
+        std::atomic<uint64_t> const& head() const { return mIndices[0].producer.head; }
+        std::atomic<uint64_t>& dropped() { return mIndices[0].producer.dropped; }
+        std::atomic<uint64_t> const& dropped() const { return mIndices[0].producer.dropped; }
+        std::atomic<uint64_t>& tail() { return mIndices[0].consumer.tail; }
+        std::atomic<uint64_t> const& tail() const { return mIndices[0].consumer.tail; }
+        std::atomic<uint64_t>& reading() { return mIndices[0].consumer.reading; }
+    };
+}
+
+#endif
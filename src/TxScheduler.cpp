@@ -0,0 +1,341 @@
+#include <canbus/TxScheduler.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace canbus;
+using iodrivers_base::UnixError;
+
+static int64_t getMonotonicTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static base::Time fromNanoseconds(int64_t ns)
+{
+    return base::Time::fromMicroseconds(ns / 1000);
+}
+
+/** Ordering of the deadline heap: earliest due time first, then lowest
+ * handle
+ */
+template<typename Deadline>
+static bool isLater(Deadline const& a, Deadline const& b)
+{
+    if (a.due != b.due)
+        return a.due > b.due;
+    return a.handle > b.handle;
+}
+
+TxScheduler::Statistics::Statistics()
+    : sent(0)
+    , failed(0)
+    , missed(0) {}
+
+TxScheduler::Jitter::Jitter()
+    : count(0)
+    , min(std::numeric_limits<int64_t>::max())
+    , max(std::numeric_limits<int64_t>::min())
+    , sum(0)
+    , sum_squares(0) {}
+
+void TxScheduler::Jitter::add(int64_t jitter)
+{
+    ++count;
+    min = std::min(min, jitter);
+    max = std::max(max, jitter);
+    sum += jitter;
+    sum_squares += static_cast<double>(jitter) * jitter;
+}
+
+void TxScheduler::Jitter::merge(Jitter const& other)
+{
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sum += other.sum;
+    sum_squares += other.sum_squares;
+}
+
+TxScheduler::TxScheduler(Driver* driver)
+    : m_driver(driver)
+    , m_stop(false)
+    , m_tick(DEFAULT_TICK * 1000)
+    , m_epoch(getMonotonicTime())
+    , m_active(0)
+{
+    m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timer_fd == -1)
+        throw UnixError("TxScheduler: cannot create timerfd");
+    m_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_stop_fd == -1) {
+        ::close(m_timer_fd);
+        throw UnixError("TxScheduler: cannot create eventfd");
+    }
+}
+
+TxScheduler::~TxScheduler()
+{
+    ::close(m_stop_fd);
+    ::close(m_timer_fd);
+}
+
+Driver& TxScheduler::getDriver()
+{
+    return *m_driver;
+}
+
+void TxScheduler::setTick(int tick_us)
+{
+    m_tick = static_cast<int64_t>(std::max(0, tick_us)) * 1000;
+}
+
+int TxScheduler::getTick() const
+{
+    return m_tick / 1000;
+}
+
+int TxScheduler::add(Message const& msg, base::Time const& period,
+        base::Time const& phase, UpdateCallback const& update, uint64_t count)
+{
+    if (period.toMicroseconds() <= 0)
+        throw std::invalid_argument("TxScheduler: the period must be positive");
+
+    Frame frame;
+    frame.msg = msg;
+    frame.period = period.toMicroseconds() * 1000;
+    frame.due = m_epoch + phase.toMicroseconds() * 1000;
+    frame.remaining = count;
+    frame.active = true;
+    frame.update = update;
+    frame.sent = 0;
+    frame.failed = 0;
+    frame.missed = 0;
+
+    // Occurrences less than a tick in the past are sent right away
+    int64_t start = getMonotonicTime() - m_tick;
+    if (frame.due < start)
+        frame.due += (start - frame.due + frame.period - 1) / frame.period * frame.period;
+
+    int handle = m_frames.size();
+    m_frames.push_back(frame);
+    ++m_active;
+    schedule(handle, frame.due);
+    return handle;
+}
+
+void TxScheduler::remove(int handle)
+{
+    Frame& frame = m_frames.at(handle);
+    if (!frame.active)
+        return;
+
+    // The frame's deadline stays in the heap, and is discarded when it
+    // comes up
+    frame.active = false;
+    --m_active;
+}
+
+bool TxScheduler::empty() const
+{
+    return m_active == 0;
+}
+
+void TxScheduler::schedule(int handle, int64_t due)
+{
+    Deadline deadline = { due, handle };
+    m_deadlines.push_back(deadline);
+    std::push_heap(m_deadlines.begin(), m_deadlines.end(), isLater<Deadline>);
+}
+
+size_t TxScheduler::runOnce()
+{
+    if (m_deadlines.empty())
+        return 0;
+    if (!waitUntil(m_deadlines.front().due))
+        return 0;
+
+    int64_t now = getMonotonicTime();
+    base::Time time = base::Time::now();
+    m_batch.clear();
+    m_batch_deadlines.clear();
+    while (!m_deadlines.empty() && m_deadlines.front().due <= now + m_tick)
+    {
+        Deadline deadline = m_deadlines.front();
+        std::pop_heap(m_deadlines.begin(), m_deadlines.end(), isLater<Deadline>);
+        m_deadlines.pop_back();
+
+        Frame& frame = m_frames[deadline.handle];
+        if (!frame.active)
+            continue;
+
+        frame.msg.time = time;
+        if (frame.update)
+            frame.update(frame.msg);
+        m_batch.push_back(frame.msg);
+        m_batch_deadlines.push_back(deadline);
+
+        if (frame.remaining && --frame.remaining == 0)
+        {
+            frame.active = false;
+            --m_active;
+            continue;
+        }
+
+        // Skip the occurrences that are already past instead of sending
+        // them in a burst. The ones due within the tick are skipped as
+        // well, or the frame would be popped again and sent twice in this
+        // batch
+        int64_t late = std::max<int64_t>(0, now + m_tick - deadline.due) / frame.period;
+        frame.missed += late;
+        frame.due = deadline.due + (late + 1) * frame.period;
+        schedule(deadline.handle, frame.due);
+    }
+
+    if (m_batch.empty())
+        return 0;
+
+    size_t written = m_driver->writeBatch(m_batch.data(), m_batch.size());
+    int64_t sent_time = getMonotonicTime();
+    for (size_t i = 0; i < m_batch_deadlines.size(); ++i)
+    {
+        Frame& frame = m_frames[m_batch_deadlines[i].handle];
+        if (i < written)
+        {
+            ++frame.sent;
+            frame.jitter.add(sent_time - m_batch_deadlines[i].due);
+        }
+        else
+            ++frame.failed;
+    }
+    return written;
+}
+
+bool TxScheduler::waitUntil(int64_t due)
+{
+    // When the due time is already past, only check whether stop() has
+    // been called
+    bool past = (due <= getMonotonicTime());
+    if (!past)
+    {
+        struct itimerspec spec = {};
+        spec.it_value.tv_sec = due / 1000000000;
+        spec.it_value.tv_nsec = due % 1000000000;
+        if (timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1)
+            throw UnixError("TxScheduler: cannot arm timerfd");
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = m_timer_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_stop_fd;
+    fds[1].events = POLLIN;
+    while (true)
+    {
+        int ret = poll(fds, 2, past ? 0 : -1);
+        if (ret == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            throw UnixError("TxScheduler: error in poll()");
+        }
+
+        if (fds[1].revents)
+        {
+            clearStop();
+            return false;
+        }
+        if (ret == 0)
+            return true;
+        if (fds[0].revents)
+        {
+            uint64_t expirations;
+            if (::read(m_timer_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN)
+                throw UnixError("TxScheduler: cannot read timerfd");
+            return true;
+        }
+    }
+}
+
+void TxScheduler::run()
+{
+    while (!m_stop.load() && !empty())
+        runOnce();
+    m_stop.store(false);
+}
+
+void TxScheduler::stop()
+{
+    m_stop.store(true);
+    uint64_t value = 1;
+    // Only fails if the counter is saturated, i.e. already signalled
+    if (::write(m_stop_fd, &value, sizeof(value)) == -1) {}
+}
+
+void TxScheduler::clearStop()
+{
+    uint64_t value;
+    if (::read(m_stop_fd, &value, sizeof(value)) == -1 && errno != EAGAIN)
+        throw UnixError("TxScheduler: cannot reset eventfd");
+}
+
+TxScheduler::Statistics TxScheduler::makeStatistics(uint64_t sent, uint64_t failed,
+        uint64_t missed, Jitter const& jitter)
+{
+    Statistics stats;
+    stats.sent = sent;
+    stats.failed = failed;
+    stats.missed = missed;
+    if (jitter.count == 0)
+        return stats;
+
+    double mean = jitter.sum / jitter.count;
+    double variance = jitter.sum_squares / jitter.count - mean * mean;
+    stats.jitter_min = fromNanoseconds(jitter.min);
+    stats.jitter_max = fromNanoseconds(jitter.max);
+    stats.jitter_mean = fromNanoseconds(mean);
+    stats.jitter_stddev = fromNanoseconds(std::sqrt(std::max(0.0, variance)));
+    return stats;
+}
+
+TxScheduler::Statistics TxScheduler::getStatistics(int handle) const
+{
+    Frame const& frame = m_frames.at(handle);
+    return makeStatistics(frame.sent, frame.failed, frame.missed, frame.jitter);
+}
+
+TxScheduler::Statistics TxScheduler::getStatistics() const
+{
+    uint64_t sent = 0, failed = 0, missed = 0;
+    Jitter jitter;
+    for (Frame const& frame : m_frames)
+    {
+        sent += frame.sent;
+        failed += frame.failed;
+        missed += frame.missed;
+        jitter.merge(frame.jitter);
+    }
+    return makeStatistics(sent, failed, missed, jitter);
+}
+
+void TxScheduler::resetStatistics()
+{
+    for (Frame& frame : m_frames)
+    {
+        frame.sent = 0;
+        frame.failed = 0;
+        frame.missed = 0;
+        frame.jitter = Jitter();
+    }
+}
@@ -0,0 +1,190 @@
+#ifndef CANBUS_TX_SCHEDULER_HH
+#define CANBUS_TX_SCHEDULER_HH
+
+#include <canbus/Driver.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace canbus
+{
+    /** Sends periodic frames on a driver
+     *
+     * Each frame is sent at phase + k * period, counted from the creation
+     * of the scheduler on the monotonic clock. The due times are absolute,
+     * so that the timing does not drift however long the writes take.
+     * The scheduler sleeps on a timerfd until the earliest due time, and
+     * hands all the frames due within one tick (see setTick) over to the
+     * driver in a single writeBatch() call, earliest deadline first.
+     *
+     * When the scheduler runs late by more than a period, the occurrences
+     * that are already past are skipped and counted as missed instead of
+     * being sent in a burst.
+     *
+     * Except for stop(), the methods must be called from the thread that
+     * runs the scheduler, or while it is not running. The update callbacks
+     * must not add or remove frames.
+     */
+    class TxScheduler
+    {
+    public:
+        /** Called before each transmission of a frame, with Message::time
+         * set to the current time, to update its payload
+         */
+        typedef std::function<void (Message& msg)> UpdateCallback;
+
+        /** The default tick, in microseconds */
+        static const int DEFAULT_TICK = 500;
+
+        /** Transmission statistics
+         *
+         * The jitter is the difference between the time the driver's
+         * writeBatch() returned with a frame and the frame's due time. It
+         * includes the time the update callbacks and the driver took. It
+         * can still be negative, by at most the tick, for frames sent ahead
+         * of their due time because they were due within the tick.
+         */
+        struct Statistics
+        {
+            /** Frames written to the driver */
+            uint64_t sent;
+            /** Frames the driver did not write before its write timeout */
+            uint64_t failed;
+            /** Occurrences skipped because the scheduler ran late, or
+             * because they fell within the tick of a previous occurrence
+             * (periods shorter than the tick)
+             */
+            uint64_t missed;
+            base::Time jitter_min;
+            base::Time jitter_max;
+            base::Time jitter_mean;
+            base::Time jitter_stddev;
+
+            Statistics();
+        };
+
+        /** Sends frames on \c driver. TxScheduler takes ownership of it */
+        explicit TxScheduler(Driver* driver);
+        ~TxScheduler();
+
+        /** The driver the frames are sent on */
+        Driver& getDriver();
+
+        /** Sets the window within which the frames that are due are sent
+         * together, in microseconds
+         */
+        void setTick(int tick_us);
+
+        int getTick() const;
+
+        /** Adds a periodic frame
+         *
+         * Its first transmission is the first occurrence of phase + k *
+         * period that is not more than a tick in the past.
+         *
+         * @param count how many times the frame is sent before being
+         *   removed, 0 to send it until it is removed
+         * @return the handle of the frame, to pass to remove() and
+         *   getStatistics(). Handles are not reused.
+         * @throw std::invalid_argument if the period is not positive
+         */
+        int add(Message const& msg, base::Time const& period,
+                base::Time const& phase = base::Time(),
+                UpdateCallback const& update = UpdateCallback(),
+                uint64_t count = 0);
+
+        /** Stops sending a frame */
+        void remove(int handle);
+
+        /** Whether there are no frames left to send */
+        bool empty() const;
+
+        /** Waits for the next due time and sends the frames that are due
+         *
+         * @return the number of frames written. It is 0 if there are no
+         *   frames or if stop() was called
+         */
+        size_t runOnce();
+
+        /** Sends frames until stop() is called, or until all the frames
+         * have been sent their count
+         */
+        void run();
+
+        /** Makes run() return
+         *
+         * It may be called from any thread, or from a signal handler
+         */
+        void stop();
+
+        /** The statistics of a frame */
+        Statistics getStatistics(int handle) const;
+
+        /** The statistics of all frames together */
+        Statistics getStatistics() const;
+
+        void resetStatistics();
+
+    private:
+        struct Jitter
+        {
+            uint64_t count;
+            int64_t min;
+            int64_t max;
+            double sum;
+            double sum_squares;
+
+            Jitter();
+            void add(int64_t jitter);
+            void merge(Jitter const& other);
+        };
+
+        struct Frame
+        {
+            Message msg;
+            int64_t period;
+            int64_t due;
+            uint64_t remaining;
+            bool active;
+            UpdateCallback update;
+
+            uint64_t sent;
+            uint64_t failed;
+            uint64_t missed;
+            Jitter jitter;
+        };
+
+        struct Deadline
+        {
+            int64_t due;
+            int handle;
+        };
+
+        std::unique_ptr<Driver> m_driver;
+        int m_timer_fd;
+        /** eventfd used to wake up run() on stop() */
+        int m_stop_fd;
+        std::atomic<bool> m_stop;
+        int64_t m_tick;
+        /** Monotonic time the phases are counted from, in nanoseconds */
+        int64_t m_epoch;
+
+        /** The frames, indexed by handle */
+        std::vector<Frame> m_frames;
+        /** Heap of the due times of the active frames */
+        std::vector<Deadline> m_deadlines;
+        size_t m_active;
+
+        std::vector<Message> m_batch;
+        std::vector<Deadline> m_batch_deadlines;
+
+        bool waitUntil(int64_t due);
+        void schedule(int handle, int64_t due);
+        void clearStop();
+        static Statistics makeStatistics(uint64_t sent, uint64_t failed,
+                uint64_t missed, Jitter const& jitter);
+    };
+}
+
+#endif
@@ -0,0 +1,143 @@
+#include <canbus/Driver.hpp>
+#include <canbus/LogFile.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <iostream>
+#include <string>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onSignal(int)
+{
+    interrupted = 1;
+}
+
+static int usage()
+{
+    cerr
+        << "usage: canbus-log record <device> <type> <file> [--direct] [--flush-period MS]\n"
+        << "       canbus-log dump <file>\n"
+        << "  record logs all received messages until interrupted with Ctrl+C\n"
+        << "  --direct opens the log file with O_DIRECT\n"
+        << "  --flush-period sets how often the buffered records are written to disk (default: 1000)\n"
+        << "  dump prints the content of a log file\n"
+        << endl;
+    return 1;
+}
+
+static double getCPUTime()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+        usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static int record(int argc, char** argv)
+{
+    if (argc < 5)
+        return usage();
+
+    bool direct = false;
+    int flush_period = 1000;
+    for (int i = 5; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--direct")
+            direct = true;
+        else if (arg == "--flush-period" && i + 1 < argc)
+            flush_period = strtol(argv[++i], NULL, 0);
+        else
+            return usage();
+    }
+
+    canbus::Driver* driver = canbus::openCanDevice(argv[2], argv[3]);
+    if (!driver)
+        return 1;
+    if (!driver->reset())
+        return 1;
+    driver->setReadTimeout(flush_period);
+
+    canbus::LogWriter writer;
+    if (!writer.open(argv[4], direct)) {
+        cerr << "cannot open " << argv[4] << endl;
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    base::Time start = base::Time::now();
+    base::Time last_flush = start;
+    base::Time period = base::Time::fromMilliseconds(flush_period);
+    while (!interrupted)
+    {
+        try {
+            writer.write(driver->read());
+        }
+        catch(iodrivers_base::TimeoutError&) {}
+        catch(iodrivers_base::UnixError&) {
+            // poll() fails with EINTR when the signal arrives
+            if (!interrupted)
+                throw;
+        }
+
+        base::Time now = base::Time::now();
+        if (now - last_flush >= period) {
+            writer.flush();
+            last_flush = now;
+        }
+    }
+    writer.close();
+    delete driver;
+
+    double duration = (base::Time::now() - start).toSeconds();
+    cerr << writer.getRecordCount() << " messages in "
+        << writer.getBlockCount() << " blocks, "
+        << writer.getRecordCount() / duration << " messages/s, "
+        << 100 * getCPUTime() / duration << "% CPU" << endl;
+    return 0;
+}
+
+static int dump(int argc, char** argv)
+{
+    if (argc != 3)
+        return usage();
+
+    canbus::LogReader reader;
+    if (!reader.open(argv[2])) {
+        cerr << argv[2] << " is not a CAN log file" << endl;
+        return 1;
+    }
+
+    printf("%20s %20s %8s %4s data\n", "time", "can_time", "can_id", "size");
+    while (canbus::LogRecord const* record = reader.next())
+    {
+        printf("%20lld %20lld %8x %4d",
+                static_cast<long long>(record->time),
+                static_cast<long long>(record->can_time),
+                record->can_id, record->size);
+        for (int i = 0; i < record->size && i < 8; ++i)
+            printf(" %02x", record->data[i]);
+        printf("\n");
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+        return usage();
+
+    string mode = argv[1];
+    if (mode == "record")
+        return record(argc, argv);
+    else if (mode == "dump")
+        return dump(argc, argv);
+    else
+        return usage();
+}
@@ -2,6 +2,7 @@
 #include <canbus/Driver.hpp>
 #include <iomanip>
 #include <map>
+#include <vector>
 #include <boost/lexical_cast.hpp>
 
 using namespace std;
@@ -46,6 +47,14 @@ int main(int argc, char**argv)
         mask = strtol(argv[5], NULL, 0);
 
     cerr << "id: " << hex << id << " mask: " << hex << mask << endl;
+    if (argc >= 5)
+    {
+        std::vector<canbus::Filter> filters;
+        filters.push_back(canbus::Filter(id, mask));
+        if (!driver->setFilters(filters))
+            return 1;
+    }
+
     cout << setw(10) << "t" << " " << setw(10) << "can_t" << " " << setw(10) << "index" << " " << setw(6) << "can_id" << " " << setw(4) << "size";
     for (int byte_i = 0; byte_i < 8; ++byte_i)
         cout << " " << setw(3) << byte_i;
@@ -63,9 +72,6 @@ int main(int argc, char**argv)
             continue;
         }
 
-        if ((msg.can_id & mask) != id)
-            continue;
-
         if (firstTime.isNull())
         {
             firstTime = msg.time;
@@ -0,0 +1,713 @@
+#include <canbus/AsyncReceiver.hpp>
+#include <canbus/Driver.hpp>
+#include <canbus/DriverNetGateway.hpp>
+#include <iodrivers_base/Driver.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+using namespace std;
+using canbus::CanFrame;
+
+static const uint32_t CAN_EFF_FLAG = canbus::FLAG_EXTENDED_FRAME;
+static const uint32_t CAN_ERR_FLAG = canbus::FLAG_ERROR;
+/** Error class sent in the generated error frames, Linux' CAN_ERR_BUSOFF */
+static const uint32_t ERROR_CLASS_BUSOFF = 0x00000040U;
+
+/** How many frames are generated at most per iteration of the main loop */
+static const size_t MAX_BURST = 64;
+/** How many bytes may be queued for a TCP client before the generated
+ * frames are dropped
+ */
+static const size_t MAX_CLIENT_BACKLOG = 1 << 20;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onSignal(int)
+{
+    interrupted = 1;
+}
+
+static int usage()
+{
+    cerr
+        << "usage: canbus-netgw-sim serve [options]\n"
+        << "       canbus-netgw-sim echo <uri>\n"
+        << "  serve simulates a CAN gateway, exchanging 16-byte CanFrames with its clients\n"
+        << "    --tcp PORT            accepts TCP clients on PORT\n"
+        << "    --udp PORT            exchanges UDP datagrams on PORT. UDP clients are known once\n"
+        << "                          they sent a datagram, which DriverNetGateway::reset() does\n"
+        << "    --bridge DEVICE TYPE  forwards the frames to and from a CAN device, e.g. vcan0 socket.\n"
+        << "                          Without it, the frames of a client are forwarded to the others\n"
+        << "    --echo                also sends the frames received from a client back to it\n"
+        << "    --rate N|max          generates N frames per second, or as many as possible (default: 0)\n"
+        << "    --ids FIRST-LAST      range of the generated IDs (default: 0x100-0x1FF). IDs above\n"
+        << "                          0x7FF are sent as extended frames\n"
+        << "    --random-ids          picks the generated IDs at random instead of in sequence\n"
+        << "    --size N              payload size of the generated frames (default: 8)\n"
+        << "    --payload P           counter, random or a fixed hex string (default: counter)\n"
+        << "    --error-rate R        fraction of the generated frames sent as error frames\n"
+        << "    --probe-period MS     sends a latency probe every MS milliseconds (default: 0)\n"
+        << "    --probe-id ID         CAN ID of the latency probes (default: 0x7FF)\n"
+        << "    --seed N              seed of the random generator (default: 1)\n"
+        << "  The probes carry their send time. The round-trip latency is measured when a\n"
+        << "  client sends them back, e.g. canbus-netgw-sim echo.\n"
+        << "  echo connects to a gateway with DriverNetGateway and sends back every frame\n"
+        << endl;
+    return 1;
+}
+
+static int64_t getMonotonicTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+struct Options
+{
+    int tcp_port;
+    int udp_port;
+    string bridge_device;
+    string bridge_type;
+    bool echo;
+    /** Generated frames per second, -1 for as many as possible */
+    double rate;
+    uint32_t first_id;
+    uint32_t last_id;
+    bool random_ids;
+    int size;
+    string payload;
+    vector<uint8_t> fixed_payload;
+    double error_rate;
+    int probe_period;
+    uint32_t probe_id;
+    uint64_t seed;
+
+    Options()
+        : tcp_port(-1)
+        , udp_port(-1)
+        , echo(false)
+        , rate(0)
+        , first_id(0x100)
+        , last_id(0x1FF)
+        , random_ids(false)
+        , size(8)
+        , payload("counter")
+        , error_rate(0)
+        , probe_period(0)
+        , probe_id(0x7FF)
+        , seed(1) {}
+};
+
+static bool parseHex(string const& str, vector<uint8_t>& bytes)
+{
+    if (str.size() % 2 || str.size() > 16)
+        return false;
+    for (size_t i = 0; i < str.size(); i += 2) {
+        char* end;
+        string byte = str.substr(i, 2);
+        bytes.push_back(strtol(byte.c_str(), &end, 16));
+        if (*end != 0)
+            return false;
+    }
+    return true;
+}
+
+static bool parseOptions(Options& options, int argc, char** argv)
+{
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--tcp" && has_value)
+            options.tcp_port = strtol(argv[++i], NULL, 0);
+        else if (arg == "--udp" && has_value)
+            options.udp_port = strtol(argv[++i], NULL, 0);
+        else if (arg == "--bridge" && i + 2 < argc) {
+            options.bridge_device = argv[++i];
+            options.bridge_type = argv[++i];
+        }
+        else if (arg == "--echo")
+            options.echo = true;
+        else if (arg == "--rate" && has_value) {
+            string rate = argv[++i];
+            options.rate = (rate == "max") ? -1 : strtod(rate.c_str(), NULL);
+        }
+        else if (arg == "--ids" && has_value) {
+            char* end;
+            options.first_id = strtoul(argv[++i], &end, 0);
+            if (*end != '-')
+                return false;
+            options.last_id = strtoul(end + 1, NULL, 0);
+            if (options.last_id < options.first_id || options.last_id > 0x1FFFFFFF)
+                return false;
+        }
+        else if (arg == "--random-ids")
+            options.random_ids = true;
+        else if (arg == "--size" && has_value) {
+            options.size = strtol(argv[++i], NULL, 0);
+            if (options.size < 0 || options.size > 8)
+                return false;
+        }
+        else if (arg == "--payload" && has_value) {
+            options.payload = argv[++i];
+            if (options.payload != "counter" && options.payload != "random" &&
+                !parseHex(options.payload, options.fixed_payload))
+                return false;
+        }
+        else if (arg == "--error-rate" && has_value)
+            options.error_rate = strtod(argv[++i], NULL);
+        else if (arg == "--probe-period" && has_value)
+            options.probe_period = strtol(argv[++i], NULL, 0);
+        else if (arg == "--probe-id" && has_value)
+            options.probe_id = strtoul(argv[++i], NULL, 0);
+        else if (arg == "--seed" && has_value)
+            options.seed = strtoull(argv[++i], NULL, 0);
+        else
+            return false;
+    }
+
+    // The probes are recognized by their ID, which must not be generated
+    if (options.probe_period && options.rate &&
+        options.probe_id >= options.first_id && options.probe_id <= options.last_id) {
+        cerr << "the probe ID must be outside of the generated ID range" << endl;
+        return false;
+    }
+    return options.tcp_port >= 0 || options.udp_port >= 0;
+}
+
+/** Generates the frames of the load profile */
+class Generator
+{
+    Options const& m_options;
+    uint64_t m_random;
+    uint64_t m_counter;
+    uint32_t m_next_id;
+
+    uint64_t random()
+    {
+        // xorshift64*
+        m_random ^= m_random >> 12;
+        m_random ^= m_random << 25;
+        m_random ^= m_random >> 27;
+        return m_random * 0x2545F4914F6CDD1DULL;
+    }
+
+public:
+    Generator(Options const& options)
+        : m_options(options)
+        , m_random(options.seed ? options.seed : 1)
+        , m_counter(0)
+        , m_next_id(options.first_id) {}
+
+    CanFrame next()
+    {
+        CanFrame frame;
+        memset(&frame, 0, sizeof(frame));
+        if (m_options.error_rate > 0 &&
+            (random() >> 11) * (1.0 / (1ULL << 53)) < m_options.error_rate) {
+            frame.can_id = CAN_ERR_FLAG | ERROR_CLASS_BUSOFF;
+            frame.can_dlc = 8;
+            return frame;
+        }
+
+        uint32_t id;
+        if (m_options.random_ids)
+            id = m_options.first_id + random() % (m_options.last_id - m_options.first_id + 1);
+        else {
+            id = m_next_id;
+            m_next_id = (id == m_options.last_id) ? m_options.first_id : id + 1;
+        }
+        frame.can_id = (id > 0x7FF) ? (id | CAN_EFF_FLAG) : id;
+        frame.can_dlc = m_options.size;
+
+        if (m_options.payload == "counter")
+            memcpy(frame.data, &m_counter, sizeof(m_counter));
+        else if (m_options.payload == "random") {
+            uint64_t value = random();
+            memcpy(frame.data, &value, sizeof(value));
+        }
+        else {
+            frame.can_dlc = m_options.fixed_payload.size();
+            copy(m_options.fixed_payload.begin(), m_options.fixed_payload.end(), frame.data);
+        }
+        ++m_counter;
+        return frame;
+    }
+
+    CanFrame probe()
+    {
+        CanFrame frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.can_id = m_options.probe_id > 0x7FF ? (m_options.probe_id | CAN_EFF_FLAG) : m_options.probe_id;
+        frame.can_dlc = 8;
+        int64_t now = getMonotonicTime();
+        memcpy(frame.data, &now, sizeof(now));
+        return frame;
+    }
+};
+
+struct Statistics
+{
+    uint64_t sent;
+    uint64_t received;
+    uint64_t received_errors;
+    uint64_t dropped;
+    uint64_t probes;
+    int64_t rtt_min;
+    int64_t rtt_max;
+    int64_t rtt_sum;
+
+    Statistics() { memset(this, 0, sizeof(*this)); }
+
+    void addRoundTrip(int64_t rtt)
+    {
+        if (probes == 0 || rtt < rtt_min)
+            rtt_min = rtt;
+        rtt_max = max(rtt_max, rtt);
+        rtt_sum += rtt;
+        ++probes;
+    }
+
+    void print(double duration) const
+    {
+        printf("tx %10.0f frames/s  rx %10.0f frames/s  rx errors %6llu  dropped %6llu",
+                sent / duration, received / duration,
+                static_cast<unsigned long long>(received_errors),
+                static_cast<unsigned long long>(dropped));
+        if (probes)
+            printf("  rtt min/mean/max %7.1f/%7.1f/%7.1f us",
+                    rtt_min / 1e3, rtt_sum / 1e3 / probes, rtt_max / 1e3);
+        printf("\n");
+        fflush(stdout);
+    }
+};
+
+/** A client of the simulated gateway. TCP clients have their own socket,
+ * UDP clients share the UDP socket and are identified by their address
+ */
+struct Client
+{
+    int fd;
+    bool udp;
+    sockaddr_in address;
+    /** Received bytes that do not form a complete frame yet */
+    vector<uint8_t> input;
+    /** Bytes waiting for the socket to be writable */
+    vector<uint8_t> output;
+};
+
+class Simulator
+{
+    Options const& m_options;
+    Generator m_generator;
+    Statistics m_stats;
+
+    int m_tcp_fd;
+    int m_udp_fd;
+    vector<Client> m_clients;
+    canbus::Driver* m_bridge;
+
+    int createSocket(int type, int port)
+    {
+        int fd = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1)
+            throw iodrivers_base::UnixError("cannot create socket");
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1)
+            throw iodrivers_base::UnixError("cannot bind to port " + to_string(port));
+        if (type == SOCK_STREAM && listen(fd, 16) == -1)
+            throw iodrivers_base::UnixError("cannot listen on port " + to_string(port));
+        return fd;
+    }
+
+    void accept()
+    {
+        int fd = ::accept4(m_tcp_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1)
+            return;
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        Client client;
+        client.fd = fd;
+        client.udp = false;
+        memset(&client.address, 0, sizeof(client.address));
+        m_clients.push_back(client);
+        cerr << "TCP client connected" << endl;
+    }
+
+    Client& findUDPClient(sockaddr_in const& address)
+    {
+        for (Client& client : m_clients) {
+            if (client.udp && client.address.sin_addr.s_addr == address.sin_addr.s_addr &&
+                client.address.sin_port == address.sin_port)
+                return client;
+        }
+
+        Client client;
+        client.fd = m_udp_fd;
+        client.udp = true;
+        client.address = address;
+        m_clients.push_back(client);
+        cerr << "UDP client " << inet_ntoa(address.sin_addr) << ":"
+            << ntohs(address.sin_port) << " registered" << endl;
+        return m_clients.back();
+    }
+
+    void send(Client& client, CanFrame const* frames, size_t count)
+    {
+        uint8_t const* bytes = reinterpret_cast<uint8_t const*>(frames);
+        size_t size = count * sizeof(CanFrame);
+        if (client.udp) {
+            ssize_t ret = sendto(client.fd, bytes, size, MSG_DONTWAIT,
+                    reinterpret_cast<sockaddr const*>(&client.address), sizeof(client.address));
+            if (ret == static_cast<ssize_t>(size))
+                m_stats.sent += count;
+            else
+                m_stats.dropped += count;
+            return;
+        }
+
+        if (client.output.size() + size > MAX_CLIENT_BACKLOG) {
+            m_stats.dropped += count;
+            return;
+        }
+        client.output.insert(client.output.end(), bytes, bytes + size);
+        m_stats.sent += count;
+        flushOutput(client);
+    }
+
+    /** Sends the pending output of a TCP client
+     *
+     * @return false if the client disconnected
+     */
+    bool flushOutput(Client& client)
+    {
+        if (client.output.empty())
+            return true;
+        ssize_t ret = ::send(client.fd, client.output.data(), client.output.size(),
+                MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (ret == -1)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        client.output.erase(client.output.begin(), client.output.begin() + ret);
+        return true;
+    }
+
+    void broadcast(CanFrame const* frames, size_t count, Client const* source = NULL)
+    {
+        for (Client& client : m_clients) {
+            if (&client != source || m_options.echo)
+                send(client, frames, count);
+        }
+    }
+
+    void handleFrames(Client& source, uint8_t const* bytes, size_t size)
+    {
+        vector<CanFrame> forward;
+        for (size_t offset = 0; offset + sizeof(CanFrame) <= size; offset += sizeof(CanFrame)) {
+            CanFrame frame;
+            memcpy(&frame, bytes + offset, sizeof(frame));
+            ++m_stats.received;
+
+            if (frame.can_id & CAN_ERR_FLAG) {
+                ++m_stats.received_errors;
+                continue;
+            }
+            if ((frame.can_id & ~CAN_EFF_FLAG) == m_options.probe_id && m_options.probe_period) {
+                int64_t sent;
+                memcpy(&sent, frame.data, sizeof(sent));
+                m_stats.addRoundTrip(getMonotonicTime() - sent);
+                continue;
+            }
+
+            if (m_bridge) {
+                canbus::Message msg = canbus::Message::Zeroed();
+                msg.can_id = frame.can_id;
+                msg.size = frame.can_dlc;
+                memcpy(msg.data, frame.data, 8);
+
+                // A bus that does not keep up must not stop the simulator
+                try { m_bridge->write(msg); }
+                catch(std::runtime_error&) {
+                    ++m_stats.dropped;
+                    continue;
+                }
+            }
+            forward.push_back(frame);
+        }
+
+        // With a bridge, the frames of the clients go to the bus only
+        if (!m_bridge && !forward.empty())
+            broadcast(forward.data(), forward.size(), &source);
+        else if (m_bridge && m_options.echo && !forward.empty())
+            send(source, forward.data(), forward.size());
+    }
+
+    /** @return false if the client disconnected */
+    bool readTCP(Client& client)
+    {
+        uint8_t buffer[16384];
+        ssize_t ret = ::recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (ret == 0)
+            return false;
+        else if (ret == -1)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+
+        client.input.insert(client.input.end(), buffer, buffer + ret);
+        size_t complete = client.input.size() / sizeof(CanFrame) * sizeof(CanFrame);
+        handleFrames(client, client.input.data(), complete);
+        client.input.erase(client.input.begin(), client.input.begin() + complete);
+        return true;
+    }
+
+    void readUDP()
+    {
+        uint8_t buffer[65536];
+        while (true) {
+            sockaddr_in address;
+            socklen_t address_size = sizeof(address);
+            ssize_t ret = recvfrom(m_udp_fd, buffer, sizeof(buffer), MSG_DONTWAIT,
+                    reinterpret_cast<sockaddr*>(&address), &address_size);
+            if (ret <= 0)
+                return;
+            handleFrames(findUDPClient(address), buffer, ret);
+        }
+    }
+
+    void readBridge()
+    {
+        vector<CanFrame> frames;
+        while (m_bridge->getPendingMessagesCount() > 0) {
+            canbus::Message msg = m_bridge->read();
+            CanFrame frame;
+            memset(&frame, 0, sizeof(frame));
+            frame.can_id = msg.can_id;
+            frame.can_dlc = msg.size;
+            memcpy(frame.data, msg.data, 8);
+            frames.push_back(frame);
+            if (frames.size() == MAX_BURST) {
+                broadcast(frames.data(), frames.size());
+                frames.clear();
+            }
+        }
+        if (!frames.empty())
+            broadcast(frames.data(), frames.size());
+    }
+
+    void generate(size_t count)
+    {
+        CanFrame frames[MAX_BURST];
+        while (count > 0) {
+            size_t burst = min(count, MAX_BURST);
+            for (size_t i = 0; i < burst; ++i)
+                frames[i] = m_generator.next();
+            broadcast(frames, burst);
+            count -= burst;
+        }
+    }
+
+public:
+    Simulator(Options const& options)
+        : m_options(options)
+        , m_generator(options)
+        , m_tcp_fd(-1)
+        , m_udp_fd(-1)
+        , m_bridge(NULL)
+    {
+        if (options.tcp_port >= 0)
+            m_tcp_fd = createSocket(SOCK_STREAM, options.tcp_port);
+        if (options.udp_port >= 0)
+            m_udp_fd = createSocket(SOCK_DGRAM, options.udp_port);
+
+        if (!options.bridge_device.empty()) {
+            m_bridge = canbus::openCanDevice(options.bridge_device, options.bridge_type);
+            if (!m_bridge || !m_bridge->reset())
+                throw runtime_error("cannot open " + options.bridge_device);
+            // Drivers without file descriptor, e.g. loopback or replay,
+            // are read from a background thread
+            if (m_bridge->getFileDescriptor() == iodrivers_base::Driver::INVALID_FD) {
+                canbus::AsyncReceiver* receiver = new canbus::AsyncReceiver(m_bridge);
+                m_bridge = receiver;
+                if (!receiver->start())
+                    throw runtime_error("cannot start the receiver of " + options.bridge_device);
+            }
+        }
+    }
+
+    ~Simulator()
+    {
+        for (Client const& client : m_clients) {
+            if (!client.udp)
+                ::close(client.fd);
+        }
+        if (m_tcp_fd != -1)
+            ::close(m_tcp_fd);
+        if (m_udp_fd != -1)
+            ::close(m_udp_fd);
+        delete m_bridge;
+    }
+
+    void run()
+    {
+        int64_t start = getMonotonicTime();
+        int64_t last_report = start;
+        int64_t next_probe = start;
+        uint64_t generated = 0;
+
+        while (!interrupted) {
+            vector<pollfd> fds;
+            pollfd listen_fds[3] = {
+                { m_tcp_fd, POLLIN, 0 },
+                { m_udp_fd, POLLIN, 0 },
+                { m_bridge ? m_bridge->getFileDescriptor() : -1, POLLIN, 0 }
+            };
+            fds.insert(fds.end(), listen_fds, listen_fds + 3);
+            for (Client const& client : m_clients) {
+                pollfd fd = { client.udp ? -1 : client.fd,
+                    static_cast<short>(POLLIN | (client.output.empty() ? 0 : POLLOUT)), 0 };
+                fds.push_back(fd);
+            }
+
+            int timeout = 1000;
+            if (m_options.rate < 0 && !m_clients.empty())
+                timeout = 0;
+            else if (m_options.rate > 0 || m_options.probe_period)
+                timeout = 1;
+
+            if (poll(fds.data(), fds.size(), timeout) == -1 && errno != EINTR)
+                throw iodrivers_base::UnixError("error in poll()");
+
+            // The clients are read first, as accepting or registering new
+            // ones invalidates the indexes in fds
+            for (size_t i = m_clients.size(); i-- > 0; ) {
+                Client& client = m_clients[i];
+                short revents = fds[3 + i].revents;
+                bool connected = true;
+                if (revents & (POLLIN | POLLHUP | POLLERR))
+                    connected = readTCP(client);
+                if (connected && (revents & POLLOUT))
+                    connected = flushOutput(client);
+                if (!connected) {
+                    cerr << "TCP client disconnected" << endl;
+                    ::close(client.fd);
+                    m_clients.erase(m_clients.begin() + i);
+                }
+            }
+            if (fds[0].revents & POLLIN)
+                accept();
+            if (fds[1].revents & POLLIN)
+                readUDP();
+            if (fds[2].revents & POLLIN)
+                readBridge();
+
+            int64_t now = getMonotonicTime();
+            if (m_options.rate < 0)
+                generate(m_clients.empty() ? 0 : MAX_BURST);
+            else if (m_options.rate > 0) {
+                uint64_t due = (now - start) / 1e9 * m_options.rate;
+                if (m_clients.empty())
+                    generated = due;
+                generate(due - generated);
+                generated = due;
+            }
+
+            if (m_options.probe_period && now >= next_probe) {
+                CanFrame probe = m_generator.probe();
+                broadcast(&probe, 1);
+                next_probe = now + static_cast<int64_t>(m_options.probe_period) * 1000000;
+            }
+
+            if (now - last_report >= 1000000000) {
+                m_stats.print((now - last_report) / 1e9);
+                m_stats = Statistics();
+                last_report = now;
+            }
+        }
+    }
+};
+
+static int serve(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(options, argc, argv))
+        return usage();
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    Simulator simulator(options);
+    simulator.run();
+    return 0;
+}
+
+static int echo(int argc, char** argv)
+{
+    if (argc != 3)
+        return usage();
+
+    canbus::DriverNetGateway driver;
+    if (!driver.open(argv[2]) || !driver.reset())
+        return 1;
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    // Send back what has been received together, so that the echo keeps
+    // up with the simulator's maximum rate
+    uint64_t count = 0;
+    vector<canbus::Message> batch(MAX_BURST);
+    while (!interrupted) {
+        try {
+            if (!driver.read(batch[0]))
+                continue;
+            size_t size = 1;
+            while (size < MAX_BURST && driver.getPendingMessagesCount() > 0)
+                batch[size++] = driver.read();
+            count += driver.writeBatch(batch.data(), size);
+        }
+        catch(iodrivers_base::UnixError&) {
+            // poll() fails with EINTR when the signal arrives
+            if (!interrupted)
+                throw;
+        }
+    }
+    cerr << count << " frames sent back, " << driver.getReceiveQueueDropCount()
+        << " dropped by the receive queue" << endl;
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+        return usage();
+
+    string mode = argv[1];
+    if (mode == "serve")
+        return serve(argc, argv);
+    else if (mode == "echo")
+        return echo(argc, argv);
+    else
+        return usage();
+}
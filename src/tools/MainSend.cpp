@@ -3,7 +3,16 @@
 #include <iomanip>
 #include <map>
 #include <boost/lexical_cast.hpp>
+#include <canbus/TxScheduler.hpp>
+#include <signal.h>
 
+static canbus::TxScheduler* scheduler = NULL;
+
+static void onSignal(int)
+{
+    if (scheduler)
+        scheduler->stop();
+}
 
 int main(int argc, char** argv)
 {
@@ -11,6 +20,7 @@ int main(int argc, char** argv)
     {
         std::cerr
             << "usage: canbus-send device device_type id length [value1] ... [value8] [COUNT] [PERIOD_IN_MS]\n"
+            << "  with a period, a COUNT of 0 sends until interrupted with Ctrl+C\n"
             << std::endl;
         return 1;
     }
@@ -85,13 +95,29 @@ int main(int argc, char** argv)
     std::cout << std::endl;
     std::cout << "sending " << std::dec << count << " packets at a period of " << period << "ms" << std::endl;
 
-    for (int i = 0; i < count; ++i)
+    if (!period)
     {
-        driver->write(msg);
-        if (period)
-            usleep(period * 1000);
+        for (int i = 0; i < count; ++i)
+            driver->write(msg);
+        delete driver;
+        return 0;
     }
 
+    canbus::TxScheduler sched(driver);
+    scheduler = &sched;
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    sched.add(msg, base::Time::fromMilliseconds(period), base::Time(),
+            canbus::TxScheduler::UpdateCallback(), count);
+    sched.run();
+
+    canbus::TxScheduler::Statistics stats = sched.getStatistics();
+    std::cout << stats.sent << " sent, " << stats.failed << " failed, "
+        << stats.missed << " missed, jitter min/mean/max/stddev: "
+        << stats.jitter_min.toMicroseconds() << "/"
+        << stats.jitter_mean.toMicroseconds() << "/"
+        << stats.jitter_max.toMicroseconds() << "/"
+        << stats.jitter_stddev.toMicroseconds() << " us" << std::endl;
     return 0;
     
 }
@@ -0,0 +1,111 @@
+#include "bench_Helpers.hpp"
+#include <canbus/Dispatcher.hpp>
+#include <map>
+
+using namespace canbus;
+using namespace canbus::bench;
+
+/** Builds the IDs of a benchmark run. They are spread over the 11-bit
+ * range, or over the 29-bit range for extended IDs
+ */
+static std::vector<uint32_t> makeIDs(int count, bool extended)
+{
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < count; ++i)
+    {
+        if (extended)
+            ids.push_back(0x18000000 + i * 0x10101);
+        else
+            ids.push_back(i * 2047 / count);
+    }
+    return ids;
+}
+
+/** The messages dispatched by the benchmarks, cycling through the
+ * subscribed IDs
+ */
+static std::vector<Message> makeMessages(std::vector<uint32_t> const& ids)
+{
+    std::vector<Message> messages;
+    for (int i = 0; i < BATCH_SIZE; ++i)
+        messages.push_back(makeMessage(ids[(i * 7) % ids.size()], 8));
+    return messages;
+}
+
+/** The per-ID handler lookup consumers do with a std::map */
+static void BM_Dispatcher_map(benchmark::State& state)
+{
+    std::vector<uint32_t> ids = makeIDs(state.range(0), state.range(1));
+    std::vector<Message> messages = makeMessages(ids);
+
+    uint64_t counter = 0;
+    std::map<uint32_t, std::vector<Dispatcher::Handler>> handlers;
+    for (uint32_t id : ids)
+        handlers[id].push_back([&counter](Message const&) { ++counter; });
+
+    while (state.KeepRunningBatch(BATCH_SIZE))
+    {
+        for (Message const& msg : messages)
+        {
+            auto it = handlers.find(msg.can_id);
+            if (it == handlers.end())
+                continue;
+            for (auto const& handler : it->second)
+                handler(msg);
+        }
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Dispatcher_map)
+    ->ArgNames({"ids", "extended"})->ArgsProduct({{16, 256}, {0, 1}});
+
+static void BM_Dispatcher_dispatch(benchmark::State& state)
+{
+    std::vector<uint32_t> ids = makeIDs(state.range(0), state.range(1));
+    std::vector<Message> messages = makeMessages(ids);
+
+    uint64_t counter = 0;
+    Dispatcher dispatcher;
+    for (uint32_t id : ids)
+        dispatcher.subscribe(id, [&counter](Message const&) { ++counter; });
+
+    while (state.KeepRunningBatch(BATCH_SIZE))
+    {
+        for (Message const& msg : messages)
+            dispatcher.dispatch(msg);
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Dispatcher_dispatch)
+    ->ArgNames({"ids", "extended"})->ArgsProduct({{16, 256}, {0, 1}});
+
+/** Dispatch with a few wildcard subscriptions next to the per-ID ones */
+static void BM_Dispatcher_dispatchWithWildcards(benchmark::State& state)
+{
+    std::vector<uint32_t> ids = makeIDs(256, state.range(0));
+    std::vector<Message> messages = makeMessages(ids);
+
+    uint64_t counter = 0;
+    Dispatcher dispatcher;
+    for (uint32_t id : ids)
+        dispatcher.subscribe(id, [&counter](Message const&) { ++counter; });
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        dispatcher.subscribe(Filter(i << 8, 0x700),
+                [&counter](Message const&) { ++counter; });
+        dispatcher.subscribe(Filter(0x18000000 | (i << 16), 0x1FFF0000),
+                [&counter](Message const&) { ++counter; });
+    }
+
+    while (state.KeepRunningBatch(BATCH_SIZE))
+    {
+        for (Message const& msg : messages)
+            dispatcher.dispatch(msg);
+    }
+    benchmark::DoNotOptimize(counter);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Dispatcher_dispatchWithWildcards)
+    ->ArgNames({"extended"})->Arg(0)->Arg(1);
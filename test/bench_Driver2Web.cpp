@@ -0,0 +1,47 @@
+#include "bench_Helpers.hpp"
+#include "../src/vendor/can2web_api.h"
+
+using namespace canbus::bench;
+using can2web::can_msg;
+
+static can_msg makeCanMsg()
+{
+    can_msg msg;
+    msg.can_id = 0x12345;
+    msg.rtr_mode_len = CAN_MODE | 8;
+    for (int i = 0; i < 8; ++i)
+        msg.data[i] = 0x11 * (i + 1);
+    return msg;
+}
+
+static void BM_can_msg_decode(benchmark::State& state)
+{
+    // A time-stamped frame, the longest can_msg encoding
+    uint8_t buffer[CAN_MSG_SIZE_MIN + 8 + 8];
+    memset(buffer, 0, sizeof(buffer));
+    buffer[0] = state.range(0);
+    buffer[5] = 0x45;
+    buffer[6] = CAN_MODE | 8;
+    for (int i = 0; i < 8; ++i)
+        buffer[7 + i] = i;
+
+    for (auto _ : state) {
+        can_msg msg;
+        msg << buffer;
+        benchmark::DoNotOptimize(msg);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_can_msg_decode)->ArgName("start")->Arg(CAN_START)->Arg(CAN_START_TIME);
+
+static void BM_can_msg_encode(benchmark::State& state)
+{
+    can_msg msg = makeCanMsg();
+    uint8_t buffer[CAN_MSG_SIZE_MAX];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(msg.encode(buffer));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_can_msg_encode);
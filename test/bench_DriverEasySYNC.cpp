@@ -0,0 +1,108 @@
+#include "bench_Helpers.hpp"
+#include <canbus/DriverEasySYNC.hpp>
+#include <iodrivers_base/Fixture.hpp>
+
+using namespace canbus;
+using namespace canbus::bench;
+
+namespace {
+    struct EasySYNCFixture : iodrivers_base::Fixture<DriverEasySYNC>
+    {
+        EasySYNCFixture(bool use_board_timestamps)
+        {
+            driver.setUseBoardTimestamps(use_board_timestamps);
+            setMockMode(true);
+            EXPECT_REPLY(toBytes("C\r"), toBytes("\r"));
+            EXPECT_REPLY(toBytes("E\r"), toBytes("E\r"));
+            if (use_board_timestamps)
+                EXPECT_REPLY(toBytes("Z1\r"), toBytes("\r"));
+            else
+                EXPECT_REPLY(toBytes("Z0\r"), toBytes("\r"));
+            EXPECT_REPLY(toBytes("O\r"), toBytes("\r"));
+            EXPECT_REPLY(toBytes("E\r"), toBytes("E\r"));
+            driver.open("test://");
+            setMockMode(false);
+        }
+    };
+}
+
+static const char* READ_FRAMES[][2] = {
+    { "t34580123456789ABCDEF\r", "t34580123456789ABCDEF2345\r" },
+    { "T18FEF10080123456789ABCDEF\r", "T18FEF10080123456789ABCDEF2345\r" },
+    { "r3458\r", "r34582345\r" }
+};
+
+static void BM_DriverEasySYNC_read(benchmark::State& state)
+{
+    bool use_board_timestamps = state.range(1);
+    EasySYNCFixture fixture(use_board_timestamps);
+    std::vector<uint8_t> frames = repeat(toBytes(
+        READ_FRAMES[state.range(0)][use_board_timestamps]), BATCH_SIZE);
+
+    while (state.KeepRunningBatch(BATCH_SIZE)) {
+        state.PauseTiming();
+        fixture.pushDataToDriver(frames);
+        state.ResumeTiming();
+
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            benchmark::DoNotOptimize(fixture.driver.read());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+// frame is 0 for standard, 1 for extended and 2 for remote frames
+BENCHMARK(BM_DriverEasySYNC_read)
+    ->ArgNames({ "frame", "board_timestamps" })
+    ->ArgsProduct({ { 0, 1, 2 }, { 0, 1 } });
+
+static void BM_DriverEasySYNC_write(benchmark::State& state)
+{
+    EasySYNCFixture fixture(false);
+    fixture.driver.setMaxInFlight(state.range(0));
+    Message msg = makeMessage(0x345, 8);
+    std::vector<uint8_t> acks = repeat(toBytes("z\r"), BATCH_SIZE);
+
+    while (state.KeepRunningBatch(BATCH_SIZE)) {
+        state.PauseTiming();
+        fixture.readDataFromDriver();
+        fixture.pushDataToDriver(acks);
+        state.ResumeTiming();
+
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            fixture.driver.write(msg);
+        fixture.driver.flush();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DriverEasySYNC_write)->ArgName("max_in_flight")->Arg(1)->Arg(16);
+
+/** Writes while the board sends a frame before each acknowledgement, and
+ * reports how many of the received frames were lost
+ */
+static void BM_DriverEasySYNC_mixedLoad(benchmark::State& state)
+{
+    EasySYNCFixture fixture(false);
+    fixture.driver.setMaxInFlight(state.range(0));
+    fixture.driver.setReceiveQueueSize(BATCH_SIZE);
+    Message msg = makeMessage(0x345, 8);
+    std::vector<uint8_t> traffic = repeat(toBytes("t1238FEDCBA9876543210\rz\r"), BATCH_SIZE);
+
+    int64_t received = 0;
+    while (state.KeepRunningBatch(BATCH_SIZE)) {
+        state.PauseTiming();
+        fixture.readDataFromDriver();
+        fixture.pushDataToDriver(traffic);
+        state.ResumeTiming();
+
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            fixture.driver.write(msg);
+        fixture.driver.flush();
+        while (fixture.driver.getPendingMessagesCount() > 0) {
+            fixture.driver.read();
+            ++received;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    state.counters["rx_lost"] = benchmark::Counter(
+        state.iterations() - received, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_DriverEasySYNC_mixedLoad)->ArgName("max_in_flight")->Arg(1)->Arg(16);
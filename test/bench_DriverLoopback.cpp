@@ -0,0 +1,49 @@
+#include "bench_Helpers.hpp"
+#include <canbus/DriverLoopback.hpp>
+#include <memory>
+#include <sstream>
+
+using namespace canbus;
+using namespace canbus::bench;
+
+/** Writes frames from one node and reads them back from a number of other
+ * nodes, i.e. measures the arbitration and the broadcast ring
+ */
+static void BM_DriverLoopback_write_read(benchmark::State& state)
+{
+    std::ostringstream name;
+    name << "bench_loopback_" << state.range(0);
+
+    DriverLoopback writer;
+    std::vector<std::unique_ptr<DriverLoopback>> readers;
+    bool ok = writer.open(name.str());
+    for (int i = 0; ok && i < state.range(0); ++i)
+    {
+        readers.emplace_back(new DriverLoopback);
+        ok = readers.back()->open(name.str());
+        readers.back()->setReadTimeout(0);
+    }
+    if (!ok)
+    {
+        state.SkipWithError("cannot open the loopback bus");
+        return;
+    }
+
+    Message msg = makeMessage(0x123, 8);
+    Message received;
+    while (state.KeepRunningBatch(BATCH_SIZE))
+    {
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            writer.write(msg);
+        for (auto const& reader : readers)
+        {
+            for (int i = 0; i < BATCH_SIZE; ++i)
+                reader->read(received);
+        }
+        benchmark::DoNotOptimize(received);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DriverLoopback_write_read)
+    ->ArgName("readers")
+    ->Arg(1)->Arg(4)->Arg(16);
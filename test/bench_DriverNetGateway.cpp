@@ -0,0 +1,268 @@
+#include "bench_Helpers.hpp"
+#include <canbus/DriverNetGateway.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <time.h>
+
+using namespace canbus;
+using namespace canbus::bench;
+
+/** How many frames the UDP stand-in puts in one datagram */
+static const int FRAMES_PER_DATAGRAM = 16;
+
+/** A stand-in for the gateway: a connected pair of TCP or UDP sockets on
+ * the loopback interface. The driver uses one end, the benchmark sends the
+ * frames from the other
+ */
+struct StandInGateway
+{
+    bool udp;
+    int gateway;
+    int driver;
+
+    explicit StandInGateway(bool udp)
+        : udp(udp)
+    {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addr_size = sizeof(addr);
+
+        if (udp) {
+            gateway = socket(AF_INET, SOCK_DGRAM, 0);
+            driver = socket(AF_INET, SOCK_DGRAM, 0);
+            sockaddr_in driver_addr = addr;
+            if (bind(gateway, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ||
+                bind(driver, reinterpret_cast<sockaddr*>(&driver_addr), sizeof(driver_addr)) ||
+                getsockname(gateway, reinterpret_cast<sockaddr*>(&addr), &addr_size) ||
+                getsockname(driver, reinterpret_cast<sockaddr*>(&driver_addr), &addr_size) ||
+                connect(gateway, reinterpret_cast<sockaddr*>(&driver_addr), sizeof(driver_addr)) ||
+                connect(driver, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)))
+                throw std::runtime_error("cannot set up the UDP sockets");
+        }
+        else {
+            int server = socket(AF_INET, SOCK_STREAM, 0);
+            driver = socket(AF_INET, SOCK_STREAM, 0);
+            if (bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ||
+                listen(server, 1) ||
+                getsockname(server, reinterpret_cast<sockaddr*>(&addr), &addr_size) ||
+                connect(driver, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)))
+                throw std::runtime_error("cannot set up the TCP sockets");
+            gateway = accept(server, NULL, NULL);
+            ::close(server);
+            if (gateway == -1)
+                throw std::runtime_error("cannot set up the TCP sockets");
+
+            // As DriverNetGateway::open() does
+            int nodelay = 1;
+            setsockopt(driver, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        }
+    }
+
+    ~StandInGateway()
+    {
+        ::close(gateway);
+    }
+
+    void send(std::vector<uint8_t> const& bytes)
+    {
+        size_t chunk = udp ? FRAMES_PER_DATAGRAM * sizeof(CanFrame) : bytes.size();
+        for (size_t offset = 0; offset < bytes.size(); offset += chunk) {
+            size_t size = std::min(chunk, bytes.size() - offset);
+            if (::send(gateway, &bytes[offset], size, 0) != static_cast<ssize_t>(size))
+                throw std::runtime_error("stand-in gateway: short send");
+        }
+    }
+};
+
+static std::vector<uint8_t> makeFrames()
+{
+    CanFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id = 0x345;
+    frame.can_dlc = 8;
+    for (int i = 0; i < 8; ++i)
+        frame.data[i] = i;
+    uint8_t const* frame_bytes = reinterpret_cast<uint8_t const*>(&frame);
+    return repeat(std::vector<uint8_t>(frame_bytes, frame_bytes + sizeof(frame)), BATCH_SIZE);
+}
+
+static void BM_DriverNetGateway_read(benchmark::State& state)
+{
+    StandInGateway gateway(state.range(0));
+    DriverNetGateway driver;
+    driver.setFileDescriptor(gateway.driver);
+    std::vector<uint8_t> frames = makeFrames();
+
+    while (state.KeepRunningBatch(BATCH_SIZE)) {
+        state.PauseTiming();
+        gateway.send(frames);
+        state.ResumeTiming();
+
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            benchmark::DoNotOptimize(driver.read());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DriverNetGateway_read)->ArgNames({"udp"})->Arg(0)->Arg(1);
+
+static double getThreadCPUTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** CPU usage of a consumer blocked in read(Message&), with the stand-in
+ * gateway idle (rate=0) or sending the given number of frames per second
+ */
+static void BM_DriverNetGateway_readCPU(benchmark::State& state)
+{
+    static const double DURATION = 0.5;
+
+    StandInGateway gateway(false);
+    DriverNetGateway driver;
+    driver.setFileDescriptor(gateway.driver);
+    driver.setReadTimeout(10);
+    int rate = state.range(0);
+    std::vector<uint8_t> frame = makeFrames();
+    frame.resize(sizeof(CanFrame));
+
+    for (auto _ : state) {
+        std::atomic<bool> stop(false);
+        std::thread sender([&]() {
+            if (rate == 0)
+                return;
+            timespec next;
+            clock_gettime(CLOCK_MONOTONIC, &next);
+            while (!stop) {
+                gateway.send(frame);
+                next.tv_nsec += 1000000000 / rate;
+                if (next.tv_nsec >= 1000000000) {
+                    next.tv_sec++;
+                    next.tv_nsec -= 1000000000;
+                }
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            }
+        });
+
+        base::Time start = base::Time::now();
+        double cpu_start = getThreadCPUTime();
+        int64_t received = 0;
+        Message msg;
+        while ((base::Time::now() - start).toSeconds() < DURATION) {
+            if (driver.read(msg))
+                ++received;
+        }
+        double cpu = getThreadCPUTime() - cpu_start;
+        double wall = (base::Time::now() - start).toSeconds();
+
+        stop = true;
+        sender.join();
+        state.counters["cpu_percent"] = 100 * cpu / wall;
+        state.counters["frames_per_second"] = received / wall;
+    }
+}
+BENCHMARK(BM_DriverNetGateway_readCPU)
+    ->ArgNames({"rate"})->Arg(0)->Arg(1000)->Arg(10000)
+    ->Iterations(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/** One FIONREAD, then one read per CanFrame, as the driver did before it
+ * read all the available bytes at once. Kept as the baseline
+ */
+static void BM_DriverNetGateway_readPerFrame(benchmark::State& state)
+{
+    StandInGateway gateway(state.range(0));
+    std::vector<uint8_t> frames = makeFrames();
+
+    while (state.KeepRunningBatch(BATCH_SIZE)) {
+        state.PauseTiming();
+        gateway.send(frames);
+        state.ResumeTiming();
+
+        int received = 0;
+        while (received < BATCH_SIZE) {
+            int bytes = 0;
+            ioctl(gateway.driver, FIONREAD, &bytes);
+            for (size_t i = 0; i < bytes / sizeof(CanFrame); ++i) {
+                CanFrame frame;
+                if (::read(gateway.driver, &frame, sizeof(frame)) != sizeof(frame))
+                    break;
+                Message msg;
+                msg.time = base::Time::now();
+                msg.can_time = msg.time;
+                msg.can_id = frame.can_id;
+                memcpy(msg.data, frame.data, 8);
+                msg.size = frame.can_dlc;
+                benchmark::DoNotOptimize(msg);
+                ++received;
+            }
+        }
+    }
+    ::close(gateway.driver);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DriverNetGateway_readPerFrame)->ArgNames({"udp"})->Arg(0);
+
+/** Writes to the TCP stand-in gateway, one frame per write() with
+ * coalescing=0, and with a coalescing window and a flush() at the end of
+ * the batch with coalescing=1
+ */
+static void BM_DriverNetGateway_write(benchmark::State& state)
+{
+    StandInGateway gateway(false);
+    DriverNetGateway driver;
+    driver.setFileDescriptor(gateway.driver);
+    if (state.range(0))
+        driver.setTxCoalescingWindow(1000000);
+    Message msg = makeMessage(0x345, 8);
+    std::vector<uint8_t> received(BATCH_SIZE * sizeof(CanFrame));
+
+    while (state.KeepRunningBatch(BATCH_SIZE)) {
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            driver.write(msg);
+        driver.flush();
+
+        state.PauseTiming();
+        size_t size = 0;
+        while (size < received.size())
+            size += ::read(gateway.gateway, &received[size], received.size() - size);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["frames_per_write"] =
+        static_cast<double>(driver.getTxFrameCount()) / driver.getTxWriteCount();
+}
+BENCHMARK(BM_DriverNetGateway_write)->ArgNames({"coalescing"})->Arg(0)->Arg(1);
+
+static void BM_DriverNetGateway_writeBatch(benchmark::State& state)
+{
+    StandInGateway gateway(false);
+    DriverNetGateway driver;
+    driver.setFileDescriptor(gateway.driver);
+    std::vector<Message> msgs(BATCH_SIZE, makeMessage(0x345, 8));
+    std::vector<uint8_t> received(BATCH_SIZE * sizeof(CanFrame));
+
+    while (state.KeepRunningBatch(BATCH_SIZE)) {
+        driver.writeBatch(msgs.data(), msgs.size());
+
+        state.PauseTiming();
+        size_t size = 0;
+        while (size < received.size())
+            size += ::read(gateway.gateway, &received[size], received.size() - size);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["frames_per_write"] =
+        static_cast<double>(driver.getTxFrameCount()) / driver.getTxWriteCount();
+}
+BENCHMARK(BM_DriverNetGateway_writeBatch);
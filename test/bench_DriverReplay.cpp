@@ -0,0 +1,55 @@
+#include "bench_Helpers.hpp"
+#include <canbus/DriverReplay.hpp>
+
+using namespace canbus;
+using namespace canbus::bench;
+
+/** How many messages the replayed log contains */
+static const int LOG_SIZE = 100000;
+
+/** Writes a log of LOG_SIZE messages, 100us apart */
+static void writeLog(std::string const& path)
+{
+    LogWriter writer;
+    writer.open(path);
+    for (int i = 0; i < LOG_SIZE; ++i)
+    {
+        Message msg = makeMessage(i & 0x7FF, i % 9);
+        msg.time = base::Time::fromMicroseconds(1000000 + i * 100);
+        writer.write(msg);
+    }
+    writer.close();
+}
+
+/** Plays a log back in the max mode, i.e. measures the decoding of the log
+ * without the playback timing
+ */
+static void BM_DriverReplay_read(benchmark::State& state)
+{
+    TemporaryFile log;
+    writeLog(log.path);
+    DriverReplay driver;
+    if (!driver.open(log.path + ":max"))
+    {
+        state.SkipWithError("cannot open the log");
+        return;
+    }
+
+    Message msg;
+    while (state.KeepRunningBatch(BATCH_SIZE))
+    {
+        for (int i = 0; i < BATCH_SIZE; ++i)
+        {
+            if (driver.isFinished())
+            {
+                state.PauseTiming();
+                driver.reset();
+                state.ResumeTiming();
+            }
+            msg = driver.read();
+        }
+        benchmark::DoNotOptimize(msg);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DriverReplay_read);
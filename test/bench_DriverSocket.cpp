@@ -0,0 +1,116 @@
+#include "bench_Helpers.hpp"
+#include <canbus/DriverSocket.hpp>
+#include <canbus/DriverSocketMmap.hpp>
+#include <stdlib.h>
+#include <algorithm>
+
+using namespace canbus;
+using namespace canbus::bench;
+
+/** The benchmarks below need a virtual CAN interface, which they find in the
+ * CANBUS_BENCHMARK_VCAN environment variable (vcan0 by default):
+ *
+ *   ip link add dev vcan0 type vcan && ip link set up vcan0
+ *
+ * They are skipped if it cannot be opened.
+ */
+static std::string getVCANInterface()
+{
+    char const* name = getenv("CANBUS_BENCHMARK_VCAN");
+    return name ? name : "vcan0";
+}
+
+template<typename Reader>
+static bool openPair(benchmark::State& state, DriverSocket& writer, Reader& reader)
+{
+    std::string iface = getVCANInterface();
+    if (!writer.open(iface) || !reader.open(iface)) {
+        state.SkipWithError(("cannot open " + iface + ", set CANBUS_BENCHMARK_VCAN").c_str());
+        return false;
+    }
+    writer.setWriteTimeout(1000);
+    reader.setReadTimeout(1000);
+    return true;
+}
+
+/** Frames written on vcan by one socket and received with read() by another,
+ * i.e. the cost of checkInput() amortized over its recvmmsg() batches
+ *
+ * The frames_per_recvmmsg counter gives how many frames each system call
+ * returned on average, empty polls included
+ */
+static void BM_DriverSocket_read(benchmark::State& state)
+{
+    DriverSocket writer, reader;
+    if (!openPair(state, writer, reader))
+        return;
+    reader.setReceiveBatchSize(state.range(0));
+
+    std::vector<Message> batch(BATCH_SIZE, makeMessage(0x345, 8));
+    while (state.KeepRunningBatch(BATCH_SIZE)) {
+        state.PauseTiming();
+        writer.writeBatch(batch.data(), batch.size());
+        state.ResumeTiming();
+
+        Message msg;
+        for (int i = 0; i < BATCH_SIZE; ++i) {
+            if (!reader.read(msg)) {
+                state.SkipWithError("timeout while reading");
+                return;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["frames_per_recvmmsg"] = static_cast<double>(reader.getRxFrameCount()) /
+        std::max<uint64_t>(1, reader.getRxCallCount());
+}
+BENCHMARK(BM_DriverSocket_read)->ArgName("receive_batch")->Arg(1)->Arg(64);
+
+static void BM_DriverSocket_write(benchmark::State& state)
+{
+    DriverSocket writer, reader;
+    if (!openPair(state, writer, reader))
+        return;
+
+    Message msg = makeMessage(0x345, 8);
+    while (state.KeepRunningBatch(BATCH_SIZE)) {
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            writer.write(msg);
+
+        state.PauseTiming();
+        reader.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DriverSocket_write);
+
+static void BM_DriverSocketMmap_readViews(benchmark::State& state)
+{
+    DriverSocket writer;
+    DriverSocketMmap reader;
+    if (!openPair(state, writer, reader))
+        return;
+
+    std::vector<Message> batch(BATCH_SIZE, makeMessage(0x345, 8));
+    FrameView views[BATCH_SIZE];
+    while (state.KeepRunningBatch(BATCH_SIZE)) {
+        state.PauseTiming();
+        writer.writeBatch(batch.data(), batch.size());
+        state.ResumeTiming();
+
+        int remaining = BATCH_SIZE;
+        while (remaining > 0) {
+            size_t count = reader.readViews(views, remaining);
+            if (count == 0) {
+                state.SkipWithError("timeout while reading");
+                return;
+            }
+            for (size_t i = 0; i < count; ++i)
+                benchmark::DoNotOptimize(views[i].getID());
+            remaining -= count;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DriverSocketMmap_readViews);
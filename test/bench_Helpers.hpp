@@ -0,0 +1,40 @@
+#ifndef CANBUS_BENCH_HELPERS_HPP
+#define CANBUS_BENCH_HELPERS_HPP
+
+#include "test_Helpers.hpp"
+#include <benchmark/benchmark.h>
+#include <canbus/Message.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace canbus
+{
+    namespace bench
+    {
+        /** How many frames are pushed to, or drained from, the test
+         * drivers between two benchmark pauses
+         */
+        static const int BATCH_SIZE = 256;
+
+        using test::makeMessage;
+        using test::TemporaryFile;
+
+        inline std::vector<uint8_t> toBytes(char const* str)
+        {
+            uint8_t const* bytes = reinterpret_cast<uint8_t const*>(str);
+            return std::vector<uint8_t>(bytes, bytes + strlen(str));
+        }
+
+        inline std::vector<uint8_t> repeat(std::vector<uint8_t> const& bytes, int count)
+        {
+            std::vector<uint8_t> result;
+            result.reserve(bytes.size() * count);
+            for (int i = 0; i < count; ++i)
+                result.insert(result.end(), bytes.begin(), bytes.end());
+            return result;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include "bench_Helpers.hpp"
+#include <canbus/Hex.hpp>
+#include <algorithm>
+
+using namespace canbus;
+using namespace canbus::bench;
+
+/** The byte-at-a-time conversions DriverEasySYNC used before canbus::hex,
+ * kept as the baseline
+ */
+namespace legacy
+{
+    static int nibbleToInt(char c)
+    {
+        if (c <= '9')
+            return c - '0';
+        else
+            return 0xA + (c - 'A');
+    }
+
+    static uint8_t const* parseBytes(uint8_t* output, uint8_t const* input, int byte_size)
+    {
+        for (int i = 0; i < byte_size; ++i)
+        {
+            int msn = nibbleToInt(input[i * 2]);
+            int lsn = nibbleToInt(input[i * 2 + 1]);
+            output[i] = msn << 4 | lsn;
+        }
+        return input + byte_size * 2;
+    }
+
+    static char intToNibble(int v)
+    {
+        if (v < 0xA)
+            return v + '0';
+        else
+            return (v - 0xA) + 'A';
+    }
+
+    static uint8_t* dumpBytes(uint8_t* output, uint8_t const* input, int byte_size)
+    {
+        for (int i = 0; i < byte_size; ++i)
+        {
+            output[i * 2]     = intToNibble((input[i] >> 4) & 0xF);
+            output[i * 2 + 1] = intToNibble(input[i] & 0xF);
+        }
+        return output + byte_size * 2;
+    }
+
+    static bool isNibble(char c)
+    {
+        return (c >= '0' && c <= '9') ||
+            (c >= 'A' && c <= 'F');
+    }
+
+    static int checkNibbleSequence(uint8_t const* buffer, int bufferSize, int offset, int expectedSize)
+    {
+        int size = std::min(offset + expectedSize, bufferSize);
+        for (int i = offset; i < size; ++i)
+            if (!isNibble(buffer[i]))
+                return -i;
+        return 0;
+    }
+}
+
+/** A standard frame with 8 bytes of data and a board timestamp */
+static char const FRAME[] = "t34580123456789ABCDEF2345\r";
+static const int FRAME_SIZE = sizeof(FRAME) - 1;
+
+static void BM_Hex_parseFrame_legacy(benchmark::State& state)
+{
+    uint8_t const* frame = reinterpret_cast<uint8_t const*>(FRAME);
+    for (auto _ : state) {
+        // Validation in extractPacket, then decoding in readFromIO
+        benchmark::DoNotOptimize(legacy::checkNibbleSequence(frame, FRAME_SIZE, 1, 4));
+        benchmark::DoNotOptimize(legacy::checkNibbleSequence(frame, FRAME_SIZE, 5, 20));
+
+        uint8_t buffer[FRAME_SIZE];
+        memcpy(buffer, frame, FRAME_SIZE);
+        buffer[0] = '0';
+        uint8_t can_id[2], data[8], can_time[2];
+        uint8_t const* cursor = legacy::parseBytes(can_id, buffer, 2);
+        cursor = legacy::parseBytes(data, cursor + 1, *cursor - '0');
+        legacy::parseBytes(can_time, cursor, 2);
+        benchmark::DoNotOptimize(can_id);
+        benchmark::DoNotOptimize(data);
+        benchmark::DoNotOptimize(can_time);
+    }
+    state.SetBytesProcessed(state.iterations() * FRAME_SIZE);
+}
+BENCHMARK(BM_Hex_parseFrame_legacy);
+
+static void BM_Hex_parseFrame(benchmark::State& state)
+{
+    uint8_t const* frame = reinterpret_cast<uint8_t const*>(FRAME);
+    state.SetLabel(hex::getImplementationName());
+    for (auto _ : state) {
+        // Same as DriverEasySYNC::readFromIO, one pass over the frame
+        uint8_t nibbles[FRAME_SIZE];
+        if (hex::toNibbles(nibbles, frame + 1, FRAME_SIZE - 2) != FRAME_SIZE - 2)
+            state.SkipWithError("invalid frame");
+        uint32_t can_id = nibbles[0] << 8 | nibbles[1] << 4 | nibbles[2];
+        uint8_t data[8];
+        hex::packNibbles(data, nibbles + 4, nibbles[3]);
+        uint32_t can_time = nibbles[20] << 12 | nibbles[21] << 8 | nibbles[22] << 4 | nibbles[23];
+        benchmark::DoNotOptimize(can_id);
+        benchmark::DoNotOptimize(data);
+        benchmark::DoNotOptimize(can_time);
+    }
+    state.SetBytesProcessed(state.iterations() * FRAME_SIZE);
+}
+BENCHMARK(BM_Hex_parseFrame);
+
+static void BM_Hex_decode_legacy(benchmark::State& state)
+{
+    std::vector<uint8_t> input = repeat(toBytes("0123456789ABCDEF"), state.range(0) / 8);
+    std::vector<uint8_t> output(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(legacy::checkNibbleSequence(input.data(), input.size(), 0, input.size()));
+        legacy::parseBytes(output.data(), input.data(), output.size());
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_Hex_decode_legacy)->ArgName("bytes")->Arg(8)->Arg(64);
+
+static void BM_Hex_decode(benchmark::State& state)
+{
+    std::vector<uint8_t> input = repeat(toBytes("0123456789ABCDEF"), state.range(0) / 8);
+    std::vector<uint8_t> output(state.range(0));
+    state.SetLabel(hex::getImplementationName());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hex::decode(output.data(), input.data(), output.size()));
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_Hex_decode)->ArgName("bytes")->Arg(8)->Arg(64);
+
+static void BM_Hex_encode_legacy(benchmark::State& state)
+{
+    Message msg = makeMessage(0x345, 8);
+    uint8_t output[16];
+    for (auto _ : state) {
+        legacy::dumpBytes(output, msg.data, 8);
+        benchmark::DoNotOptimize(output);
+    }
+    state.SetBytesProcessed(state.iterations() * 8);
+}
+BENCHMARK(BM_Hex_encode_legacy);
+
+static void BM_Hex_encode(benchmark::State& state)
+{
+    Message msg = makeMessage(0x345, 8);
+    uint8_t output[16];
+    for (auto _ : state) {
+        hex::encode(output, msg.data, 8);
+        benchmark::DoNotOptimize(output);
+    }
+    state.SetBytesProcessed(state.iterations() * 8);
+}
+BENCHMARK(BM_Hex_encode);
@@ -0,0 +1,92 @@
+#include "bench_Helpers.hpp"
+#include <canbus/LogFile.hpp>
+
+using namespace canbus;
+using namespace canbus::bench;
+
+/** How many messages are written before the log is restarted, and how many
+ * the read benchmark's log contains
+ */
+static const int LOG_SIZE = 100000;
+
+static Message makeRecord(int i)
+{
+    Message msg = makeMessage(i & 0x7FF, i % 9);
+    msg.time = base::Time::fromMicroseconds(1000000 + i * 100);
+    msg.can_time = msg.time;
+    return msg;
+}
+
+/** Appends messages to a log, restarting it outside of the timed section
+ * every LOG_SIZE messages
+ */
+static void BM_LogWriter_write(benchmark::State& state)
+{
+    TemporaryFile log;
+    LogWriter writer;
+    if (!writer.open(log.path))
+    {
+        state.SkipWithError("cannot open the log");
+        return;
+    }
+
+    std::vector<Message> messages;
+    for (int i = 0; i < BATCH_SIZE; ++i)
+        messages.push_back(makeRecord(i));
+
+    while (state.KeepRunningBatch(BATCH_SIZE))
+    {
+        for (Message const& msg : messages)
+            writer.write(msg);
+
+        if (writer.getRecordCount() >= static_cast<uint64_t>(LOG_SIZE))
+        {
+            state.PauseTiming();
+            writer.close();
+            writer.open(log.path);
+            state.ResumeTiming();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogWriter_write);
+
+/** Reads a log sequentially, rewinding it outside of the timed section
+ * when it ends
+ */
+static void BM_LogReader_read(benchmark::State& state)
+{
+    TemporaryFile log;
+    {
+        LogWriter writer;
+        writer.open(log.path);
+        for (int i = 0; i < LOG_SIZE; ++i)
+            writer.write(makeRecord(i));
+        writer.close();
+    }
+
+    LogReader reader;
+    if (!reader.open(log.path))
+    {
+        state.SkipWithError("cannot open the log");
+        return;
+    }
+
+    Message msg;
+    while (state.KeepRunningBatch(BATCH_SIZE))
+    {
+        for (int i = 0; i < BATCH_SIZE; ++i)
+        {
+            if (!reader.read(msg))
+            {
+                state.PauseTiming();
+                reader.rewind();
+                state.ResumeTiming();
+                reader.read(msg);
+            }
+        }
+        benchmark::DoNotOptimize(msg);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogReader_read);
@@ -0,0 +1,108 @@
+#include "bench_Helpers.hpp"
+#include <canbus/Reactor.hpp>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace canbus;
+using namespace canbus::bench;
+
+/** Driver whose file descriptor is the read side of a pipe, readable when
+ * a message has been pushed. It always returns the same message
+ */
+struct PipeDriver : public Driver
+{
+    int fds[2];
+    int pending = 0;
+    Message msg = makeMessage(0x123, 8);
+
+    PipeDriver()
+    {
+        if (pipe2(fds, O_NONBLOCK) != 0)
+            throw std::runtime_error("cannot create pipe");
+    }
+    ~PipeDriver()
+    {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    void push()
+    {
+        ++pending;
+        char byte = 0;
+        if (::write(fds[1], &byte, 1) != 1)
+            throw std::runtime_error("cannot write to pipe");
+    }
+
+    bool open(std::string const&) { return true; }
+    bool resetBoard() { return true; }
+    bool reset() { return true; }
+    void setWriteTimeout(uint32_t) {}
+    uint32_t getWriteTimeout() const { return 0; }
+    void setReadTimeout(uint32_t) {}
+    uint32_t getReadTimeout() const { return 0; }
+    Message read()
+    {
+        --pending;
+        return msg;
+    }
+    void write(Message const&) {}
+    int getPendingMessagesCount()
+    {
+        char buffer[256];
+        while (::read(fds[0], buffer, sizeof(buffer)) > 0) {}
+        return pending;
+    }
+    bool checkBusOk() { return true; }
+    void clear() { pending = 0; }
+    int getFileDescriptor() const { return fds[0]; }
+    bool isValid() const { return true; }
+    void close() {}
+};
+
+/** Dispatches one message per ready bus with N buses registered, either
+ * with a single bus ready (round-robin) or with all of them ready
+ *
+ * The time per iteration is the time runOnce() takes to dispatch them,
+ * i.e. the dispatch latency of the last serviced bus
+ */
+static void BM_Reactor_dispatch(benchmark::State& state)
+{
+    int bus_count = state.range(0);
+    bool all_ready = state.range(1);
+
+    Reactor reactor;
+    std::vector<std::unique_ptr<PipeDriver>> drivers;
+    uint64_t received = 0;
+    for (int i = 0; i < bus_count; ++i)
+    {
+        drivers.emplace_back(new PipeDriver);
+        reactor.addBus(*drivers.back(), [&received](int, Message const&) { ++received; });
+    }
+
+    int next = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        if (all_ready)
+        {
+            for (auto const& driver : drivers)
+                driver->push();
+        }
+        else
+        {
+            drivers[next]->push();
+            next = (next + 1) % bus_count;
+        }
+        state.ResumeTiming();
+
+        reactor.runOnce(0);
+    }
+    benchmark::DoNotOptimize(received);
+    state.SetItemsProcessed(received);
+}
+BENCHMARK(BM_Reactor_dispatch)
+    ->ArgNames({ "buses", "all_ready" })
+    ->ArgsProduct({ { 1, 4, 16, 64, 256 }, { 0, 1 } });
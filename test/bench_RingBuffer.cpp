@@ -0,0 +1,53 @@
+#include "bench_Helpers.hpp"
+#include <canbus/RingBuffer.hpp>
+#include <deque>
+
+using namespace canbus;
+using namespace canbus::bench;
+
+/** The unbounded queue DriverSocket used before RingBuffer, kept as the
+ * baseline
+ */
+static void BM_RingBuffer_deque(benchmark::State& state)
+{
+    std::deque<Message> queue;
+    Message msg = makeMessage(0x123, 8);
+    Message out;
+    while (state.KeepRunningBatch(BATCH_SIZE))
+    {
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            queue.push_back(msg);
+        for (int i = 0; i < BATCH_SIZE; ++i)
+        {
+            out = queue.front();
+            queue.pop_front();
+        }
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RingBuffer_deque);
+
+/** Pushes and pops batches of messages from the same thread, with the given
+ * overflow policy
+ */
+static void BM_RingBuffer_push_pop(benchmark::State& state)
+{
+    RingBuffer<Message> queue(RingBuffer<Message>::DEFAULT_CAPACITY,
+            static_cast<RingBuffer<Message>::OVERFLOW_POLICY>(state.range(0)));
+    Message msg = makeMessage(0x123, 8);
+    Message out;
+    while (state.KeepRunningBatch(BATCH_SIZE))
+    {
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            queue.push(msg);
+        for (int i = 0; i < BATCH_SIZE; ++i)
+            queue.pop(out);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RingBuffer_push_pop)
+    ->ArgName("policy")
+    ->Arg(RingBuffer<Message>::DROP_OLDEST)
+    ->Arg(RingBuffer<Message>::DROP_NEWEST);
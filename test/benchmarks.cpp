@@ -0,0 +1,16 @@
+#include <benchmark/benchmark.h>
+
+/** Runs the benchmarks
+ *
+ * The results are only printed. Pass --benchmark_out=<file> to save them
+ * as well (in JSON unless --benchmark_out_format says otherwise), e.g. to
+ * a file in the build directory.
+ */
+int main(int argc, char **argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,143 @@
+#include "test_Helpers.hpp"
+#include <canbus/AsyncReceiver.hpp>
+#include <canbus/DriverLoopback.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <poll.h>
+#include <sched.h>
+#include <thread>
+
+using namespace std;
+using namespace canbus;
+using canbus::test::makeMessage;
+
+struct AsyncReceiverTest : public ::testing::Test {
+    DriverLoopback writer;
+
+    /** Waits for \c condition to become true, for at most a second */
+    template<typename Condition>
+    bool waitFor(Condition condition)
+    {
+        base::Time deadline = base::Time::now() + base::Time::fromSeconds(1);
+        while (!condition()) {
+            if (base::Time::now() > deadline)
+                return false;
+            this_thread::yield();
+        }
+        return true;
+    }
+
+    bool isReadable(int fd, int timeout)
+    {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        return poll(&pfd, 1, timeout) == 1;
+    }
+};
+
+TEST_F(AsyncReceiverTest, it_hands_the_received_frames_over_to_the_consumer)
+{
+    AsyncReceiver receiver(new DriverLoopback);
+    ASSERT_TRUE(receiver.open("test_async_receive"));
+    ASSERT_TRUE(receiver.isRunning());
+    ASSERT_TRUE(writer.open("test_async_receive"));
+    receiver.setReadTimeout(1000);
+
+    for (int i = 0; i < 10; ++i)
+        writer.write(makeMessage(i));
+    for (int i = 0; i < 10; ++i)
+        ASSERT_EQ(i, receiver.read().can_id);
+}
+
+TEST_F(AsyncReceiverTest, read_throws_on_timeout)
+{
+    AsyncReceiver receiver(new DriverLoopback);
+    ASSERT_TRUE(receiver.open("test_async_timeout"));
+    receiver.setReadTimeout(10);
+    ASSERT_THROW(receiver.read(), iodrivers_base::TimeoutError);
+}
+
+TEST_F(AsyncReceiverTest, its_file_descriptor_is_readable_while_frames_are_pending)
+{
+    AsyncReceiver receiver(new DriverLoopback);
+    ASSERT_TRUE(receiver.open("test_async_notify"));
+    ASSERT_TRUE(writer.open("test_async_notify"));
+    receiver.setReadTimeout(0);
+    ASSERT_FALSE(isReadable(receiver.getFileDescriptor(), 0));
+
+    writer.write(makeMessage(0x1));
+    writer.write(makeMessage(0x2));
+    ASSERT_TRUE(isReadable(receiver.getFileDescriptor(), 1000));
+    ASSERT_TRUE(waitFor([&receiver]() { return receiver.getPendingMessagesCount() == 2; }));
+
+    ASSERT_EQ(0x1, receiver.read().can_id);
+    ASSERT_TRUE(isReadable(receiver.getFileDescriptor(), 0));
+    ASSERT_EQ(0x2, receiver.read().can_id);
+    ASSERT_FALSE(isReadable(receiver.getFileDescriptor(), 0));
+}
+
+TEST_F(AsyncReceiverTest, it_receives_the_frames_queued_while_stopped_on_restart)
+{
+    AsyncReceiver receiver(new DriverLoopback);
+    ASSERT_TRUE(receiver.open("test_async_restart"));
+    ASSERT_TRUE(writer.open("test_async_restart"));
+    receiver.setReadTimeout(1000);
+
+    receiver.stop();
+    ASSERT_FALSE(receiver.isRunning());
+    writer.write(makeMessage(0x1));
+    receiver.setReadTimeout(10);
+    ASSERT_THROW(receiver.read(), iodrivers_base::TimeoutError);
+
+    ASSERT_TRUE(receiver.start());
+    ASSERT_TRUE(receiver.isRunning());
+    receiver.setReadTimeout(1000);
+    ASSERT_EQ(0x1, receiver.read().can_id);
+}
+
+TEST_F(AsyncReceiverTest, it_counts_the_frames_the_consumer_did_not_read_in_time)
+{
+    AsyncReceiver receiver(new DriverLoopback, 4);
+    ASSERT_TRUE(receiver.open("test_async_overflow"));
+    ASSERT_TRUE(writer.open("test_async_overflow"));
+    receiver.setReadTimeout(0);
+
+    for (int i = 0; i < 10; ++i)
+        writer.write(makeMessage(i));
+    ASSERT_TRUE(waitFor([&receiver]() { return receiver.getDroppedCount() == 6; }));
+
+    for (int i = 6; i < 10; ++i)
+        ASSERT_EQ(i, receiver.read().can_id);
+    Message msg;
+    ASSERT_FALSE(receiver.read(msg));
+}
+
+TEST_F(AsyncReceiverTest, it_writes_while_the_rx_thread_reads)
+{
+    AsyncReceiver receiver(new DriverLoopback);
+    ASSERT_TRUE(receiver.open("test_async_write"));
+    ASSERT_TRUE(writer.open("test_async_write"));
+    writer.setReadTimeout(1000);
+    receiver.setReadTimeout(1000);
+
+    thread echo([this]() {
+        for (int i = 0; i < 100; ++i)
+            writer.write(makeMessage(0x100 + i));
+    });
+    for (int i = 0; i < 100; ++i)
+        receiver.write(makeMessage(i));
+    echo.join();
+
+    for (int i = 0; i < 100; ++i)
+        ASSERT_EQ(i, writer.read().can_id);
+    for (int i = 0; i < 100; ++i)
+        ASSERT_EQ(0x100 + i, receiver.read().can_id);
+}
+
+TEST_F(AsyncReceiverTest, start_fails_if_the_rx_thread_cannot_be_pinned)
+{
+    AsyncReceiver receiver(new DriverLoopback);
+    receiver.setCPUAffinity(CPU_SETSIZE - 1);
+    ASSERT_FALSE(receiver.open("test_async_affinity"));
+    ASSERT_FALSE(receiver.isRunning());
+}
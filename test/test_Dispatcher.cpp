@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <canbus/Dispatcher.hpp>
+
+using namespace std;
+using namespace canbus;
+
+struct DispatcherTest : public ::testing::Test {
+    Dispatcher dispatcher;
+    vector<pair<int, uint32_t>> received;
+
+    Dispatcher::Handler recorder(int tag) {
+        return [this, tag](Message const& msg) {
+            received.push_back(make_pair(tag, msg.can_id));
+        };
+    }
+
+    size_t dispatch(uint32_t can_id) {
+        Message msg = Message::Zeroed();
+        msg.can_id = can_id;
+        return dispatcher.dispatch(msg);
+    }
+};
+
+TEST_F(DispatcherTest, it_calls_the_handlers_subscribed_to_a_standard_ID)
+{
+    dispatcher.subscribe(0x10, recorder(0));
+    dispatcher.subscribe(0x10, recorder(1));
+    dispatcher.subscribe(0x7FF, recorder(2));
+
+    ASSERT_EQ(2, dispatch(0x10));
+    ASSERT_EQ(0, dispatch(0x11));
+    ASSERT_EQ(1, dispatch(0x7FF));
+    ASSERT_EQ(3, received.size());
+    ASSERT_EQ(make_pair(0, 0x10u), received[0]);
+    ASSERT_EQ(make_pair(1, 0x10u), received[1]);
+    ASSERT_EQ(make_pair(2, 0x7FFu), received[2]);
+}
+
+TEST_F(DispatcherTest, it_calls_the_handlers_subscribed_to_an_extended_ID)
+{
+    for (uint32_t i = 0; i < 100; ++i)
+        dispatcher.subscribe(0x18FF0000 + i, recorder(i));
+    dispatcher.subscribe(FLAG_REMOTE_TRANSMISSION_REQUEST | 0x10, recorder(100));
+
+    for (uint32_t i = 0; i < 100; ++i)
+        ASSERT_EQ(1, dispatch(0x18FF0000 + i));
+    ASSERT_EQ(0, dispatch(0x18FF0000 + 100));
+    ASSERT_EQ(0, dispatch(0x10));
+    ASSERT_EQ(1, dispatch(FLAG_REMOTE_TRANSMISSION_REQUEST | 0x10));
+    ASSERT_EQ(101, received.size());
+    ASSERT_EQ(make_pair(42, 0x18FF0000u + 42), received[42]);
+    ASSERT_EQ(100, received.back().first);
+}
+
+TEST_F(DispatcherTest, it_calls_the_wildcard_handlers_after_the_ID_handlers)
+{
+    dispatcher.subscribe(Filter(0x100, 0x700), recorder(0));
+    dispatcher.subscribe(0x123, recorder(1));
+    dispatcher.subscribe(Filter(0x18FF0000, 0x1FFF0000), recorder(2));
+    dispatcher.subscribe(0x18FF1234, recorder(3));
+
+    ASSERT_EQ(2, dispatch(0x123));
+    ASSERT_EQ(1, dispatch(0x1FF));
+    ASSERT_EQ(0, dispatch(0x200));
+    ASSERT_EQ(2, dispatch(0x18FF1234));
+    ASSERT_EQ(1, dispatch(0x18FF0001));
+    ASSERT_EQ(0, dispatch(0x18FE1234));
+
+    vector<pair<int, uint32_t>> expected = {
+        { 1, 0x123 }, { 0, 0x123 }, { 0, 0x1FF },
+        { 3, 0x18FF1234 }, { 2, 0x18FF1234 }, { 2, 0x18FF0001 }
+    };
+    ASSERT_EQ(expected, received);
+}
+
+TEST_F(DispatcherTest, it_removes_subscriptions)
+{
+    int handle = dispatcher.subscribe(0x10, recorder(0));
+    dispatcher.subscribe(0x10, recorder(1));
+    dispatcher.subscribe(0x18FF0000, recorder(2));
+    dispatcher.subscribe(Filter(0x10, 0x7FF), recorder(3));
+
+    dispatcher.unsubscribe(handle);
+    ASSERT_EQ(2, dispatch(0x10));
+    dispatcher.unsubscribeID(0x10);
+    ASSERT_EQ(1, dispatch(0x10));
+    ASSERT_EQ(make_pair(3, 0x10u), received.back());
+    dispatcher.unsubscribeID(0x18FF0000);
+    ASSERT_EQ(0, dispatch(0x18FF0000));
+
+    dispatcher.clear();
+    ASSERT_TRUE(dispatcher.empty());
+    ASSERT_EQ(0, dispatch(0x10));
+}
@@ -0,0 +1,125 @@
+#include "test_Helpers.hpp"
+#include <canbus/Driver2Web.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include "../src/vendor/can2web_api.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace canbus;
+using canbus::test::makeMessage;
+using can2web::can_msg;
+
+struct Driver2WebTest : ::testing::Test
+{
+    Driver2Web driver;
+    int fds[2];
+
+    Driver2WebTest()
+    {
+        if (pipe2(fds, O_NONBLOCK) == -1)
+            throw runtime_error("cannot create pipe");
+        driver.setFileDescriptor(fds[1]);
+    }
+
+    ~Driver2WebTest()
+    {
+        driver.close();
+        ::close(fds[0]);
+    }
+
+    vector<uint8_t> readWritten()
+    {
+        vector<uint8_t> result(4096);
+        ssize_t size = ::read(fds[0], result.data(), result.size());
+        result.resize(max<ssize_t>(0, size));
+        return result;
+    }
+};
+
+TEST_F(Driver2WebTest, it_encodes_a_message_the_decoder_reads_back)
+{
+    can_msg msg;
+    msg.can_id = 0x12345678;
+    msg.rtr_mode_len = CAN_MODE | 5;
+    for (int i = 0; i < 5; ++i)
+        msg.data[i] = i + 1;
+
+    uint8_t buffer[CAN_MSG_SIZE_MAX];
+    ASSERT_EQ(CAN_MSG_SIZE_MIN + 5, msg.encode(buffer));
+
+    can_msg decoded;
+    decoded << buffer;
+    ASSERT_EQ(0x12345678u, decoded.can_id);
+    ASSERT_EQ(CAN_MODE | 5, decoded.rtr_mode_len);
+    for (int i = 0; i < 5; ++i)
+        ASSERT_EQ(i + 1, decoded.data[i]);
+}
+
+TEST_F(Driver2WebTest, it_never_encodes_more_than_eight_data_bytes)
+{
+    can_msg msg;
+    msg.rtr_mode_len = CAN_MODE | 0xF;
+    uint8_t buffer[CAN_MSG_SIZE_MAX];
+    ASSERT_EQ(CAN_MSG_SIZE_MAX, msg.encode(buffer));
+}
+
+TEST_F(Driver2WebTest, it_writes_the_encoded_frame)
+{
+    driver.write(makeMessage(0x123, 3));
+
+    vector<uint8_t> expected = { CAN_START, 0, 0, 0, 0x01, 0x23, CAN_MODE | 3, 0x23, 0x24, 0x25 };
+    ASSERT_EQ(expected, readWritten());
+}
+
+TEST_F(Driver2WebTest, it_clamps_the_length_field_to_the_encoded_payload)
+{
+    Message msg = makeMessage(0x123, 8);
+    msg.size = 12;
+    driver.write(msg);
+
+    vector<uint8_t> written = readWritten();
+    ASSERT_EQ(CAN_MSG_SIZE_MIN + 8, written.size());
+    ASSERT_EQ(CAN_MODE | 8, written[6]);
+}
+
+struct Driver2WebReadTest : ::testing::Test, iodrivers_base::Fixture<Driver2Web>
+{
+    Driver2WebReadTest()
+    {
+        driver.open("test://");
+        driver.setReadTimeout(10);
+    }
+
+    void pushFrame(uint32_t can_id)
+    {
+        uint8_t buffer[CAN_MSG_SIZE_MAX];
+        can_msg msg;
+        msg.can_id = can_id;
+        msg.rtr_mode_len = CAN_MODE | 2;
+        msg.data[0] = 1;
+        msg.data[1] = 2;
+        int size = msg.encode(buffer);
+        pushDataToDriver(vector<uint8_t>(buffer, buffer + size));
+    }
+};
+
+TEST_F(Driver2WebReadTest, it_returns_the_frames_passing_the_filters)
+{
+    driver.setFilters(vector<Filter>{ Filter(0x200, 0x7FF) });
+    pushFrame(0x100);
+    pushFrame(0x200);
+    ASSERT_EQ(0x200u, driver.read().can_id);
+}
+
+TEST_F(Driver2WebReadTest, it_throws_on_timeout_instead_of_returning_a_rejected_frame)
+{
+    driver.setFilters(vector<Filter>{ Filter(0x200, 0x7FF) });
+    pushFrame(0x100);
+    ASSERT_THROW(driver.read(), iodrivers_base::TimeoutError);
+}
+
+TEST_F(Driver2WebReadTest, it_throws_on_timeout_when_nothing_arrives)
+{
+    ASSERT_THROW(driver.read(), iodrivers_base::TimeoutError);
+}
@@ -0,0 +1,121 @@
+#include "test_Helpers.hpp"
+#include <canbus/Driver2Web.hpp>
+#include "../src/vendor/can2web_api.h"
+#include <atomic>
+#include <cstdlib>
+#include <fcntl.h>
+#include <new>
+#include <unistd.h>
+
+using namespace std;
+using namespace canbus;
+using canbus::test::makeMessage;
+
+/* The replaced operator new counts the heap allocations made while an
+ * AllocationCounter exists. It lives in its own test executable, so that
+ * the main test suite keeps the standard allocator.
+ */
+static atomic<bool> counting(false);
+static atomic<size_t> allocations(0);
+
+/** Counts the heap allocations made during its lifetime */
+struct AllocationCounter
+{
+    AllocationCounter()
+    {
+        allocations.store(0);
+        counting.store(true);
+    }
+
+    ~AllocationCounter()
+    {
+        counting.store(false);
+    }
+
+    size_t count() const
+    {
+        return allocations.load();
+    }
+};
+
+void* operator new(size_t size)
+{
+    if (counting.load())
+        ++allocations;
+    if (void* ptr = malloc(size ? size : 1))
+        return ptr;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+// Not inlined, so that the compiler does not see free() called on memory
+// returned by operator new (-Wmismatched-new-delete)
+__attribute__((noinline)) void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+struct Driver2WebAllocationsTest : ::testing::Test
+{
+    Driver2Web driver;
+    int fds[2];
+
+    Driver2WebAllocationsTest()
+    {
+        if (pipe2(fds, O_NONBLOCK) == -1)
+            throw runtime_error("cannot create pipe");
+        driver.setFileDescriptor(fds[1]);
+    }
+
+    ~Driver2WebAllocationsTest()
+    {
+        driver.close();
+        ::close(fds[0]);
+    }
+
+    size_t readWritten()
+    {
+        uint8_t buffer[4096];
+        ssize_t size = ::read(fds[0], buffer, sizeof(buffer));
+        return max<ssize_t>(0, size);
+    }
+};
+
+TEST_F(Driver2WebAllocationsTest, it_does_not_allocate_when_writing)
+{
+    Message msg = makeMessage(0x123, 8);
+    driver.write(msg);
+    readWritten();
+
+    size_t count;
+    {
+        AllocationCounter counter;
+        for (int i = 0; i < 100; ++i)
+            driver.write(msg);
+        count = counter.count();
+    }
+
+    ASSERT_EQ(0u, count);
+    ASSERT_EQ(100u * (CAN_MSG_SIZE_MIN + 8), readWritten());
+}
+
+TEST_F(Driver2WebAllocationsTest, it_does_not_allocate_when_resetting)
+{
+    size_t count;
+    {
+        AllocationCounter counter;
+        driver.reset();
+        count = counter.count();
+    }
+
+    ASSERT_EQ(0u, count);
+}
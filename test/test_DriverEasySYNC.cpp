@@ -1,5 +1,6 @@
 #include "test_Helpers.hpp"
 #include <canbus/DriverEasySYNC.hpp>
+#include <iodrivers_base/Exceptions.hpp>
 
 using namespace std;
 using namespace canbus;
@@ -119,6 +120,151 @@ TEST_F(DriverTest, write_throws_if_it_gets_an_error_reply)
     ASSERT_ANY_THROW(driver.write(msg));
 }
 
+TEST_F(DriverTest, write_encodes_an_extended_frame_and_returns_when_it_is_acknowledged)
+{
+    open();
+
+    IODRIVERS_BASE_MOCK();
+    canbus::Message msg = writeTestMessage();
+    msg.can_id = 0x12345678;
+    EXPECT_REPLY("T1234567880123456789ABCDEF\r", "Z\r");
+    driver.write(msg);
+}
+
+TEST_F(DriverTest, pipelined_writes_do_not_wait_for_the_acknowledgements)
+{
+    open();
+    driver.setMaxInFlight(3);
+
+    canbus::Message msg = writeTestMessage();
+    driver.write(msg);
+    driver.write(msg);
+    driver.write(msg);
+    ASSERT_EQ(3, driver.getInFlightCount());
+    ASSERT_EQ(3 * strlen("t34580123456789ABCDEF\r"), readDataFromDriver().size());
+
+    pushDataToDriver("z\r\x7z\r");
+    ASSERT_TRUE(driver.flush());
+    ASSERT_EQ(0, driver.getInFlightCount());
+}
+
+TEST_F(DriverTest, pipelined_writes_report_the_frames_the_board_rejected)
+{
+    open();
+    driver.setMaxInFlight(3);
+
+    canbus::Message msg = writeTestMessage();
+    for (int i = 0; i < 3; ++i)
+    {
+        msg.can_id = 0x100 + i;
+        driver.write(msg);
+    }
+    pushDataToDriver("z\r\x7z\r");
+    ASSERT_TRUE(driver.flush());
+
+    vector<Message> failed = driver.takeFailedWrites();
+    ASSERT_EQ(1, failed.size());
+    ASSERT_EQ(0x101, failed[0].can_id);
+    ASSERT_TRUE(driver.takeFailedWrites().empty());
+}
+
+TEST_F(DriverTest, pipelined_writes_queue_the_frames_received_while_waiting_for_acknowledgements)
+{
+    open();
+    driver.setMaxInFlight(2);
+
+    canbus::Message msg = writeTestMessage();
+    driver.write(msg);
+    driver.write(msg);
+    pushDataToDriver("t1231AB\rz\r");
+    driver.write(msg);
+    ASSERT_EQ(2, driver.getInFlightCount());
+
+    Message received = driver.read();
+    ASSERT_EQ(0x123, received.can_id);
+    ASSERT_EQ(1, received.size);
+    ASSERT_EQ(0xAB, received.data[0]);
+}
+
+TEST_F(DriverTest, pipelined_writes_time_out_if_the_acknowledgements_do_not_come)
+{
+    open();
+    driver.setWriteTimeout(10);
+    driver.setMaxInFlight(2);
+
+    canbus::Message msg = writeTestMessage();
+    driver.write(msg);
+    driver.write(msg);
+    ASSERT_THROW(driver.write(msg), iodrivers_base::TimeoutError);
+    ASSERT_EQ(0, driver.getInFlightCount());
+    ASSERT_EQ(2, driver.takeFailedWrites().size());
+}
+
+TEST_F(DriverTest, flush_times_out_if_the_acknowledgements_do_not_come)
+{
+    open();
+    driver.setWriteTimeout(10);
+    driver.setMaxInFlight(3);
+
+    canbus::Message msg = writeTestMessage();
+    driver.write(msg);
+    driver.write(msg);
+    ASSERT_FALSE(driver.flush());
+    ASSERT_EQ(0, driver.getInFlightCount());
+    ASSERT_EQ(2, driver.takeFailedWrites().size());
+}
+
+TEST_F(DriverTest, pipelined_writes_drop_the_corrupted_frames_received_while_waiting_for_acknowledgements)
+{
+    open();
+    driver.setMaxInFlight(2);
+
+    canbus::Message msg = writeTestMessage();
+    driver.write(msg);
+    driver.write(msg);
+    pushDataToDriver("t12G1AB\rz\r");
+    driver.write(msg);
+    pushDataToDriver("z\rz\r");
+    ASSERT_TRUE(driver.flush());
+    ASSERT_TRUE(driver.takeFailedWrites().empty());
+    ASSERT_EQ(0, driver.getPendingMessagesCount());
+}
+
+TEST_F(DriverTest, it_configures_the_bit_timing_registers_and_the_acceptance_filter)
+{
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY("C\r", "\r");
+    EXPECT_REPLY("E\r", "E\r");
+    EXPECT_REPLY("Z0\r", "\r");
+    EXPECT_REPLY("s0316\r", "\r");
+    EXPECT_REPLY("M24600000\r", "\r");
+    EXPECT_REPLY("m001FFFFF\r", "\r");
+    EXPECT_REPLY("O\r", "\r");
+    EXPECT_REPLY("E\r", "E\r");
+    driver.open("test://:btr=0316,code=24600000,mask=001FFFFF");
+}
+
+TEST_F(DriverTest, it_combines_a_rate_with_an_acceptance_filter)
+{
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY("C\r", "\r");
+    EXPECT_REPLY("E\r", "E\r");
+    EXPECT_REPLY("Z0\r", "\r");
+    EXPECT_REPLY("S6\r", "\r");
+    EXPECT_REPLY("M24600000\r", "\r");
+    EXPECT_REPLY("O\r", "\r");
+    EXPECT_REPLY("E\r", "E\r");
+    driver.open("test://:500k,code=24600000");
+}
+
+TEST_F(DriverTest, it_rejects_invalid_bus_options)
+{
+    ASSERT_THROW(driver.open("test://:btr=03G6"), std::invalid_argument);
+    ASSERT_THROW(driver.open("test://:btr=031"), std::invalid_argument);
+    ASSERT_THROW(driver.open("test://:mask=FFFF"), std::invalid_argument);
+    ASSERT_THROW(driver.open("test://:50k,btr=0316"), std::invalid_argument);
+}
+
 TEST_F(DriverTest, it_parses_a_standard_frame_with_timestamp)
 {
     open(true);
@@ -140,6 +286,70 @@ TEST_F(DriverTest, it_parses_a_standard_frame_with_timestamp)
     ASSERT_EQ(msg.data[7], 0xEF);
 }
 
+TEST_F(DriverTest, it_parses_consecutive_frames)
+{
+    open();
+
+    IODRIVERS_BASE_MOCK();
+    pushDataToDriver("t3452ABCD\rt1230\rt7FF80123456789ABCDEF\r");
+    Message msg = driver.read();
+    ASSERT_EQ(msg.can_id, 0x345);
+    ASSERT_EQ(msg.size, 2);
+    ASSERT_EQ(msg.data[0], 0xAB);
+    ASSERT_EQ(msg.data[1], 0xCD);
+    msg = driver.read();
+    ASSERT_EQ(msg.can_id, 0x123);
+    ASSERT_EQ(msg.size, 0);
+    msg = driver.read();
+    ASSERT_EQ(msg.can_id, 0x7FF);
+    ASSERT_EQ(msg.size, 8);
+    ASSERT_EQ(msg.data[7], 0xEF);
+}
+
+TEST_F(DriverTest, it_parses_an_extended_frame_with_timestamp)
+{
+    open(true);
+
+    IODRIVERS_BASE_MOCK();
+    pushDataToDriver("T18FEF1003A1B2C32345\r");
+    Message msg = driver.read();
+
+    ASSERT_EQ(msg.can_id, 0x18FEF100);
+    ASSERT_EQ(msg.can_time, base::Time::fromMilliseconds(0x2345));
+    ASSERT_EQ(msg.size, 3);
+    ASSERT_EQ(msg.data[0], 0xA1);
+    ASSERT_EQ(msg.data[1], 0xB2);
+    ASSERT_EQ(msg.data[2], 0xC3);
+}
+
+TEST_F(DriverTest, it_parses_remote_frames)
+{
+    open(true);
+
+    IODRIVERS_BASE_MOCK();
+    pushDataToDriver("r12340001\rR18FEF10080002\r");
+    Message msg = driver.read();
+    ASSERT_EQ(msg.can_id, 0x123 | FLAG_REMOTE_TRANSMISSION_REQUEST);
+    ASSERT_EQ(msg.size, 4);
+    ASSERT_EQ(msg.can_time, base::Time::fromMilliseconds(1));
+
+    msg = driver.read();
+    ASSERT_EQ(msg.can_id, 0x18FEF100 | FLAG_REMOTE_TRANSMISSION_REQUEST);
+    ASSERT_EQ(msg.size, 8);
+    ASSERT_EQ(msg.can_time, base::Time::fromMilliseconds(2));
+}
+
+TEST_F(DriverTest, it_resynchronizes_after_a_frame_with_a_wrong_length)
+{
+    open();
+
+    IODRIVERS_BASE_MOCK();
+    pushDataToDriver("T18FEF1003A1\rT18FEF1001A1\r");
+    Message msg = driver.read();
+    ASSERT_EQ(msg.can_id, 0x18FEF100);
+    ASSERT_EQ(msg.size, 1);
+}
+
 TEST_F(DriverTest, it_rejects_a_frame_with_an_invalid_character_in_the_can_ID)
 {
     open();
@@ -212,3 +422,33 @@ TEST_F(DriverTest, it_handles_an_all_OK_message)
     ASSERT_FALSE(status.rx_buffer0_overflow);
     ASSERT_FALSE(status.rx_buffer1_overflow);
 }
+
+TEST_F(DriverTest, it_queues_the_frames_received_while_waiting_for_a_command_reply)
+{
+    open();
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY("F\r", "t1231AB\rt3450\rC6\r");
+    DriverEasySYNC::Status status = driver.getStatus();
+    ASSERT_EQ(status.tx_state, DriverEasySYNC::WARNING);
+
+    Message msg = driver.read();
+    ASSERT_EQ(msg.can_id, 0x123);
+    ASSERT_EQ(msg.data[0], 0xAB);
+    msg = driver.read();
+    ASSERT_EQ(msg.can_id, 0x345);
+}
+
+TEST_F(DriverTest, it_returns_the_queued_frames_in_order_and_drops_the_oldest_on_overflow)
+{
+    open();
+    driver.setReceiveQueueSize(2);
+
+    IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY("F\r", "t1000\rt2000\rt3000\rC6\r");
+    driver.getStatus();
+
+    ASSERT_EQ(1, driver.getReceiveQueueDropCount());
+    ASSERT_EQ(0x200, driver.read().can_id);
+    ASSERT_EQ(0x300, driver.read().can_id);
+}
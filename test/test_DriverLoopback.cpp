@@ -0,0 +1,151 @@
+#include "test_Helpers.hpp"
+#include <canbus/DriverLoopback.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+
+using namespace std;
+using namespace canbus;
+using canbus::test::makeMessage;
+
+struct DriverLoopbackTest : public ::testing::Test {
+};
+
+TEST_F(DriverLoopbackTest, the_other_nodes_receive_the_written_frames)
+{
+    DriverLoopback a, b, c;
+    ASSERT_TRUE(a.open("test_receive"));
+    ASSERT_TRUE(b.open("test_receive"));
+    ASSERT_TRUE(c.open("test_receive"));
+    a.setReadTimeout(0);
+
+    a.write(makeMessage(0x123));
+    ASSERT_EQ(0x123, b.read().can_id);
+    Message msg = c.read();
+    ASSERT_EQ(0x123, msg.can_id);
+    ASSERT_EQ(8, msg.size);
+    ASSERT_EQ((0x123 + 7) & 0xFF, msg.data[7]);
+    ASSERT_THROW(a.read(), iodrivers_base::TimeoutError);
+}
+
+TEST_F(DriverLoopbackTest, the_lowest_id_wins_the_arbitration)
+{
+    DriverLoopback a, b, c, reader;
+    ASSERT_TRUE(a.open("test_arbitration"));
+    ASSERT_TRUE(b.open("test_arbitration"));
+    ASSERT_TRUE(c.open("test_arbitration"));
+    ASSERT_TRUE(reader.open("test_arbitration"));
+
+    a.getBus()->pause();
+    a.write(makeMessage(0x300));
+    b.write(makeMessage(0x100));
+    c.write(makeMessage(0x100 | FLAG_EXTENDED_FRAME));
+    a.getBus()->resume();
+
+    ASSERT_EQ(0x100, reader.read().can_id);
+    ASSERT_EQ(0x100, reader.read().can_id);
+    ASSERT_EQ(0x300, reader.read().can_id);
+}
+
+TEST_F(DriverLoopbackTest, a_node_can_be_closed_while_the_bus_is_paused)
+{
+    DriverLoopback a, b, reader;
+    ASSERT_TRUE(a.open("test_pause_close"));
+    ASSERT_TRUE(b.open("test_pause_close"));
+    ASSERT_TRUE(reader.open("test_pause_close"));
+    reader.setReadTimeout(0);
+
+    shared_ptr<LoopbackBus> bus = a.getBus();
+    bus->pause();
+    a.write(makeMessage(0x100));
+    b.write(makeMessage(0x200));
+    a.close();
+    bus->resume();
+
+    // The frame queued by the closed node is discarded
+    ASSERT_EQ(0x200, reader.read().can_id);
+    ASSERT_THROW(reader.read(), iodrivers_base::TimeoutError);
+}
+
+TEST_F(DriverLoopbackTest, it_timestamps_frames_with_the_virtual_bus_time)
+{
+    DriverLoopback a, b;
+    ASSERT_TRUE(a.open("test_bitrate:bitrate=125000"));
+    ASSERT_TRUE(b.open("test_bitrate"));
+
+    a.write(makeMessage(0x1));
+    a.write(makeMessage(0x1));
+    Message first = b.read();
+    Message second = b.read();
+    // 111 bits for a standard frame with 8 bytes
+    ASSERT_EQ(888, (second.time - first.time).toMicroseconds());
+}
+
+TEST_F(DriverLoopbackTest, it_drops_frames)
+{
+    DriverLoopback a, b;
+    ASSERT_TRUE(a.open("test_drop:drop=1"));
+    ASSERT_TRUE(b.open("test_drop"));
+    b.setReadTimeout(0);
+
+    a.write(makeMessage(0x1));
+    Message msg;
+    ASSERT_FALSE(b.read(msg));
+    ASSERT_EQ(1, a.getBus()->getDroppedCount());
+}
+
+TEST_F(DriverLoopbackTest, it_injects_errors_and_retransmits)
+{
+    DriverLoopback a, b;
+    ASSERT_TRUE(a.open("test_error:error=0.5,seed=42"));
+    ASSERT_TRUE(b.open("test_error"));
+
+    for (int i = 0; i < 100; ++i)
+        a.write(makeMessage(i));
+    for (int i = 0; i < 100; ++i)
+        ASSERT_EQ(i, b.read().can_id);
+    ASSERT_GT(b.getErrorCount(), 0);
+    ASSERT_FALSE(b.checkBusOk());
+    b.clear();
+    ASSERT_TRUE(b.checkBusOk());
+}
+
+TEST_F(DriverLoopbackTest, a_slow_reader_loses_the_oldest_frames)
+{
+    DriverLoopback a, b;
+    ASSERT_TRUE(a.open("test_overrun:capacity=16"));
+    ASSERT_TRUE(b.open("test_overrun"));
+    b.setReadTimeout(0);
+
+    for (int i = 0; i < 100; ++i)
+        a.write(makeMessage(i));
+
+    Message msg;
+    int count = 0;
+    while (b.read(msg))
+        ++count;
+    ASSERT_EQ(99, msg.can_id);
+    ASSERT_LE(count, 16);
+    ASSERT_EQ(100, count + b.getReceiveDropCount());
+}
+
+TEST_F(DriverLoopbackTest, it_applies_the_filters)
+{
+    DriverLoopback a, b;
+    ASSERT_TRUE(a.open("test_filters"));
+    ASSERT_TRUE(b.open("test_filters"));
+    vector<Filter> filters;
+    filters.push_back(Filter(0x10, 0x7FF));
+    b.setFilters(filters);
+
+    a.write(makeMessage(0x1));
+    a.write(makeMessage(0x10));
+    ASSERT_EQ(1, b.getPendingMessagesCount());
+    ASSERT_EQ(0x10, b.read().can_id);
+}
+
+TEST_F(DriverLoopbackTest, it_refuses_a_conflicting_bus_configuration)
+{
+    DriverLoopback a, b;
+    ASSERT_TRUE(a.open("test_config:bitrate=500000"));
+    ASSERT_FALSE(b.open("test_config:bitrate=250000"));
+    ASSERT_TRUE(b.open("test_config"));
+}
@@ -0,0 +1,241 @@
+#include "test_Helpers.hpp"
+#include <canbus/DriverNetGateway.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace canbus;
+using canbus::test::makeMessage;
+
+struct DriverNetGatewayTest : ::testing::Test, iodrivers_base::Fixture<DriverNetGateway>
+{
+    DriverNetGatewayTest()
+    {
+        driver.open("test://");
+    }
+
+    static vector<uint8_t> makeFrame(uint32_t can_id, uint8_t dlc = 8)
+    {
+        CanFrame frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.can_id = can_id;
+        frame.can_dlc = dlc;
+        for (int i = 0; i < dlc; ++i)
+            frame.data[i] = can_id + i;
+        uint8_t const* bytes = reinterpret_cast<uint8_t const*>(&frame);
+        return vector<uint8_t>(bytes, bytes + sizeof(frame));
+    }
+
+    static vector<uint8_t> concat(vector<vector<uint8_t>> const& frames)
+    {
+        vector<uint8_t> result;
+        for (auto const& frame : frames)
+            result.insert(result.end(), frame.begin(), frame.end());
+        return result;
+    }
+};
+
+TEST_F(DriverNetGatewayTest, it_decodes_all_the_frames_available)
+{
+    pushDataToDriver(concat({ makeFrame(0x10), makeFrame(0x20, 2), makeFrame(0x30) }));
+    ASSERT_EQ(3, driver.getPendingMessagesCount());
+
+    Message msg = driver.read();
+    ASSERT_EQ(0x10, msg.can_id);
+    ASSERT_EQ(8, msg.size);
+    ASSERT_EQ(0x17, msg.data[7]);
+    msg = driver.read();
+    ASSERT_EQ(0x20, msg.can_id);
+    ASSERT_EQ(2, msg.size);
+    ASSERT_EQ(0x21, msg.data[1]);
+    ASSERT_EQ(0x30, driver.read().can_id);
+    ASSERT_EQ(0, driver.getPendingMessagesCount());
+}
+
+TEST_F(DriverNetGatewayTest, it_keeps_a_partial_frame_until_it_is_complete)
+{
+    vector<uint8_t> bytes = concat({ makeFrame(0x10), makeFrame(0x20) });
+    pushDataToDriver(vector<uint8_t>(bytes.begin(), bytes.begin() + 20));
+    ASSERT_EQ(1, driver.getPendingMessagesCount());
+    ASSERT_EQ(0x10, driver.read().can_id);
+
+    pushDataToDriver(vector<uint8_t>(bytes.begin() + 20, bytes.end() - 1));
+    ASSERT_EQ(0, driver.getPendingMessagesCount());
+    pushDataToDriver(vector<uint8_t>(bytes.end() - 1, bytes.end()));
+    Message msg = driver.read();
+    ASSERT_EQ(0x20, msg.can_id);
+    ASSERT_EQ(0x27, msg.data[7]);
+}
+
+TEST_F(DriverNetGatewayTest, it_reports_the_error_frames)
+{
+    pushDataToDriver(makeFrame(0x20000004, 8));
+    ASSERT_FALSE(driver.checkBusOk());
+    ASSERT_EQ(1, driver.getErrorCount());
+    ASSERT_EQ(0, driver.getPendingMessagesCount());
+
+    pushDataToDriver(makeFrame(0x20000000, 8));
+    ASSERT_TRUE(driver.checkBusOk());
+}
+
+TEST_F(DriverNetGatewayTest, it_drops_the_messages_rejected_by_the_filters)
+{
+    driver.setFilters(vector<Filter>{ Filter(0x20, 0x7FF) });
+    pushDataToDriver(concat({ makeFrame(0x10), makeFrame(0x20), makeFrame(0x30) }));
+    ASSERT_EQ(1, driver.getPendingMessagesCount());
+    ASSERT_EQ(0x20, driver.read().can_id);
+}
+
+TEST_F(DriverNetGatewayTest, read_throws_TimeoutError_if_no_frame_is_received)
+{
+    driver.setReadTimeout(10);
+    pushDataToDriver(vector<uint8_t>(10, 0));
+    ASSERT_THROW(driver.read(), iodrivers_base::TimeoutError);
+}
+
+TEST_F(DriverNetGatewayTest, it_reads_the_frames_from_a_socket)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    driver.setFileDescriptor(fds[0]);
+
+    vector<uint8_t> bytes = concat({ makeFrame(0x10), makeFrame(0x20) });
+    ASSERT_EQ(bytes.size() - 3, ::write(fds[1], bytes.data(), bytes.size() - 3));
+    ASSERT_EQ(0x10, driver.read().can_id);
+    ASSERT_EQ(3, ::write(fds[1], bytes.data() + bytes.size() - 3, 3));
+    ASSERT_EQ(0x20, driver.read().can_id);
+    ::close(fds[1]);
+}
+
+TEST_F(DriverNetGatewayTest, it_reads_all_the_datagrams_available)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+    driver.setFileDescriptor(fds[0]);
+
+    // The trailing bytes of the first datagram are not part of a frame
+    vector<uint8_t> first = concat({ makeFrame(0x10), makeFrame(0x20), { 1, 2, 3 } });
+    vector<uint8_t> second = makeFrame(0x30);
+    ASSERT_EQ(first.size(), ::write(fds[1], first.data(), first.size()));
+    ASSERT_EQ(second.size(), ::write(fds[1], second.data(), second.size()));
+    ASSERT_EQ(3, driver.getPendingMessagesCount());
+    ASSERT_EQ(0x10, driver.read().can_id);
+    ASSERT_EQ(0x20, driver.read().can_id);
+    ASSERT_EQ(0x30, driver.read().can_id);
+    ::close(fds[1]);
+}
+
+TEST_F(DriverNetGatewayTest, it_sends_each_frame_right_away_by_default)
+{
+    driver.write(makeMessage(0x10));
+    driver.write(makeMessage(0x20));
+    ASSERT_EQ(concat({ makeFrame(0x10), makeFrame(0x20) }), readDataFromDriver());
+    ASSERT_EQ(2, driver.getTxFrameCount());
+    ASSERT_EQ(2, driver.getTxWriteCount());
+}
+
+TEST_F(DriverNetGatewayTest, it_buffers_the_frames_within_the_coalescing_window)
+{
+    driver.setTxCoalescingWindow(1000000);
+    driver.write(makeMessage(0x10));
+    driver.write(makeMessage(0x20));
+    driver.write(makeMessage(0x30));
+    ASSERT_TRUE(readDataFromDriver().empty());
+
+    driver.flush();
+    ASSERT_EQ(concat({ makeFrame(0x10), makeFrame(0x20), makeFrame(0x30) }),
+              readDataFromDriver());
+    ASSERT_EQ(3, driver.getTxFrameCount());
+    ASSERT_EQ(1, driver.getTxWriteCount());
+}
+
+TEST_F(DriverNetGatewayTest, it_sends_the_buffered_frames_once_the_window_elapsed)
+{
+    driver.setTxCoalescingWindow(1000);
+    driver.write(makeMessage(0x10));
+    driver.write(makeMessage(0x20));
+    usleep(2000);
+    driver.getPendingMessagesCount();
+    ASSERT_EQ(concat({ makeFrame(0x10), makeFrame(0x20) }), readDataFromDriver());
+
+    driver.write(makeMessage(0x30));
+    usleep(2000);
+    driver.write(makeMessage(0x40));
+    ASSERT_EQ(concat({ makeFrame(0x30), makeFrame(0x40) }), readDataFromDriver());
+    ASSERT_EQ(2, driver.getTxWriteCount());
+}
+
+TEST_F(DriverNetGatewayTest, it_sends_a_batch_in_one_write)
+{
+    vector<Message> msgs = { makeMessage(0x10), makeMessage(0x20), makeMessage(0x30) };
+    ASSERT_EQ(3, driver.writeBatch(msgs.data(), msgs.size()));
+    ASSERT_EQ(concat({ makeFrame(0x10), makeFrame(0x20), makeFrame(0x30) }),
+              readDataFromDriver());
+    ASSERT_EQ(1, driver.getTxWriteCount());
+}
+
+TEST_F(DriverNetGatewayTest, read_waits_for_a_frame_up_to_the_read_timeout)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    driver.setFileDescriptor(fds[0]);
+    driver.setReadTimeout(50);
+
+    Message msg;
+    base::Time start = base::Time::now();
+    ASSERT_FALSE(driver.read(msg));
+    base::Time duration = base::Time::now() - start;
+    ASSERT_GE(duration, base::Time::fromMilliseconds(45));
+    ASSERT_LT(duration, base::Time::fromMilliseconds(200));
+
+    std::thread gateway([&fds]() {
+        usleep(10000);
+        vector<uint8_t> frame = makeFrame(0x10);
+        ::write(fds[1], frame.data(), frame.size());
+    });
+    ASSERT_TRUE(driver.read(msg));
+    ASSERT_EQ(0x10, msg.can_id);
+    gateway.join();
+    ::close(fds[1]);
+}
+
+TEST_F(DriverNetGatewayTest, read_times_out_on_a_partial_frame)
+{
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    driver.setFileDescriptor(fds[0]);
+    driver.setReadTimeout(20);
+
+    vector<uint8_t> frame = makeFrame(0x10);
+    ASSERT_EQ(8, ::write(fds[1], frame.data(), 8));
+    ASSERT_THROW(driver.read(), iodrivers_base::TimeoutError);
+    ASSERT_EQ(8, ::write(fds[1], frame.data() + 8, 8));
+    ASSERT_EQ(0x10, driver.read().can_id);
+    ::close(fds[1]);
+}
+
+TEST_F(DriverNetGatewayTest, read_sends_the_coalesced_frames_while_waiting)
+{
+    driver.setTxCoalescingWindow(5000);
+    driver.setReadTimeout(20);
+    driver.write(makeMessage(0x10));
+
+    Message msg;
+    ASSERT_FALSE(driver.read(msg));
+    ASSERT_EQ(makeFrame(0x10), readDataFromDriver());
+}
+
+TEST_F(DriverNetGatewayTest, read_sends_the_coalesced_frames_when_messages_are_queued)
+{
+    driver.setTxCoalescingWindow(1000);
+    driver.write(makeMessage(0x10));
+    pushDataToDriver(concat({ makeFrame(0x20), makeFrame(0x30) }));
+    ASSERT_EQ(0x20, driver.read().can_id);
+    ASSERT_TRUE(readDataFromDriver().empty());
+
+    usleep(2000);
+    ASSERT_EQ(0x30, driver.read().can_id);
+    ASSERT_EQ(makeFrame(0x10), readDataFromDriver());
+}
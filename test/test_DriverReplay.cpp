@@ -0,0 +1,90 @@
+#include "test_Helpers.hpp"
+#include <canbus/DriverReplay.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+
+using namespace std;
+using namespace canbus;
+
+struct DriverReplayTest : public ::testing::Test {
+    test::TemporaryFile log;
+
+    /** Writes \c count messages, \c period_us microseconds apart */
+    void writeLog(int count, int period_us) {
+        LogWriter writer;
+        ASSERT_TRUE(writer.open(log.path));
+        for (int i = 0; i < count; ++i) {
+            Message msg = Message::Zeroed();
+            msg.time = base::Time::fromMicroseconds(1000000 + i * period_us);
+            msg.can_id = 0x100 + i;
+            msg.size = 1;
+            msg.data[0] = i;
+            writer.write(msg);
+        }
+        writer.close();
+    }
+};
+
+TEST_F(DriverReplayTest, it_plays_the_log_back_as_fast_as_possible)
+{
+    writeLog(1000, 1000000);
+    DriverReplay driver;
+    ASSERT_TRUE(driver.open(log.path + ":max"));
+    ASSERT_EQ(DriverReplay::SPEED_MAX, driver.getSpeed());
+    for (int i = 0; i < 1000; ++i) {
+        Message msg = driver.read();
+        ASSERT_EQ(0x100 + i, msg.can_id);
+        ASSERT_EQ(base::Time::fromMicroseconds(1000000 + i * 1000000), msg.time);
+    }
+    ASSERT_TRUE(driver.isFinished());
+    ASSERT_THROW(driver.read(), iodrivers_base::TimeoutError);
+}
+
+TEST_F(DriverReplayTest, it_plays_the_log_back_with_its_timing)
+{
+    writeLog(3, 20000);
+    DriverReplay driver;
+    ASSERT_TRUE(driver.open(log.path + ":2"));
+    base::Time start = base::Time::now();
+    Message first = driver.read();
+    driver.read();
+    Message last = driver.read();
+    base::Time elapsed = base::Time::now() - start;
+    ASSERT_GE(elapsed.toMicroseconds(), 20000);
+    ASSERT_EQ(20000, (last.time - first.time).toMicroseconds());
+    ASSERT_EQ(base::Time::fromMicroseconds(1040000), last.can_time);
+}
+
+TEST_F(DriverReplayTest, it_times_out_if_the_next_message_is_not_due)
+{
+    writeLog(2, 10000000);
+    DriverReplay driver;
+    ASSERT_TRUE(driver.open(log.path));
+    driver.setReadTimeout(10);
+    driver.read();
+    ASSERT_EQ(0, driver.getPendingMessagesCount());
+    ASSERT_THROW(driver.read(), iodrivers_base::TimeoutError);
+    ASSERT_FALSE(driver.isFinished());
+}
+
+TEST_F(DriverReplayTest, it_applies_the_filters)
+{
+    writeLog(16, 0);
+    DriverReplay driver;
+    ASSERT_TRUE(driver.open(log.path, DriverReplay::SPEED_MAX));
+    vector<Filter> filters;
+    filters.push_back(Filter(0x104, 0x7FF));
+    driver.setFilters(filters);
+    ASSERT_EQ(0x104, driver.read().can_id);
+    ASSERT_THROW(driver.read(), iodrivers_base::TimeoutError);
+}
+
+TEST_F(DriverReplayTest, reset_restarts_the_playback)
+{
+    writeLog(2, 0);
+    DriverReplay driver;
+    ASSERT_TRUE(driver.open(log.path + ":max"));
+    driver.read();
+    driver.read();
+    ASSERT_TRUE(driver.reset());
+    ASSERT_EQ(0x100, driver.read().can_id);
+}
@@ -0,0 +1,218 @@
+#include "test_VCAN.hpp"
+#include <canbus/DriverSocket.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <unistd.h>
+
+using namespace std;
+using namespace canbus;
+using canbus::test::makeMessage;
+
+/** The CAN FD tests also need the interface to accept CAN FD frames (ip
+ * link set vcan0 mtu 72)
+ */
+struct DriverSocketTest : public canbus::test::VCANTest {
+    DriverSocket reader;
+
+    void SetUp()
+    {
+        VCANTest::SetUp();
+        if (IsSkipped())
+            return;
+        if (!reader.open(iface))
+            GTEST_SKIP() << "cannot open " << iface << ", set CANBUS_TEST_VCAN";
+        reader.setReadTimeout(1000);
+    }
+};
+
+TEST_F(DriverSocketTest, it_receives_the_pending_frames_in_batches)
+{
+    reader.setReceiveBatchSize(16);
+    for (int i = 0; i < 40; ++i)
+        writer.write(makeMessage(0x100 + i));
+    // vcan delivers the frames from a softirq
+    usleep(50000);
+
+    ASSERT_EQ(40, reader.getPendingMessagesCount());
+    ASSERT_EQ(40u, reader.getRxFrameCount());
+    // 16 + 16 + 8, and the call that finds the socket empty
+    ASSERT_EQ(4u, reader.getRxCallCount());
+
+    for (int i = 0; i < 40; ++i) {
+        Message msg = reader.read();
+        ASSERT_EQ(0x100u + i, msg.can_id);
+        ASSERT_EQ(8, msg.size);
+        ASSERT_EQ(static_cast<uint8_t>(0x100 + i + 7), msg.data[7]);
+    }
+}
+
+TEST_F(DriverSocketTest, it_leaves_a_backlog_larger_than_the_queue_in_the_socket)
+{
+    reader.setReceiveBatchSize(16);
+    reader.setReceiveQueueSize(32);
+    for (int i = 0; i < 100; ++i)
+        writer.write(makeMessage(0x100 + i));
+    usleep(50000);
+
+    ASSERT_EQ(32, reader.getPendingMessagesCount());
+    for (int i = 0; i < 100; ++i)
+        ASSERT_EQ(0x100u + i, reader.read().can_id);
+    ASSERT_EQ(0u, reader.getReceiveQueueDropCount());
+}
+
+TEST_F(DriverSocketTest, it_reads_the_available_frames_with_readBatch)
+{
+    for (int i = 0; i < 10; ++i)
+        writer.write(makeMessage(0x200 + i));
+
+    Message msgs[16];
+    ASSERT_EQ(10u, reader.readBatch(msgs, 16));
+    for (int i = 0; i < 10; ++i)
+        ASSERT_EQ(0x200u + i, msgs[i].can_id);
+}
+
+TEST_F(DriverSocketTest, read_returns_false_on_timeout)
+{
+    reader.setReadTimeout(10);
+    Message msg;
+    ASSERT_FALSE(reader.read(msg));
+}
+
+TEST_F(DriverSocketTest, it_writes_a_batch_of_frames)
+{
+    vector<Message> msgs;
+    for (int i = 0; i < 100; ++i)
+        msgs.push_back(makeMessage(0x300 + i, i % 9));
+    ASSERT_EQ(100u, writer.writeBatch(msgs.data(), msgs.size()));
+
+    for (int i = 0; i < 100; ++i) {
+        Message msg = reader.read();
+        ASSERT_EQ(0x300u + i, msg.can_id);
+        ASSERT_EQ(i % 9, msg.size);
+        for (int b = 0; b < msg.size; ++b)
+            ASSERT_EQ(msgs[i].data[b], msg.data[b]);
+    }
+}
+
+TEST_F(DriverSocketTest, it_filters_the_frames_in_the_kernel)
+{
+    ASSERT_TRUE(reader.setFilters(vector<Filter>{ Filter(0x400, 0x7F0) }));
+    writer.write(makeMessage(0x123));
+    writer.write(makeMessage(0x405));
+    writer.write(makeMessage(0x413));
+    writer.write(makeMessage(0x40A));
+    usleep(50000);
+
+    ASSERT_EQ(2, reader.getPendingMessagesCount());
+    ASSERT_EQ(2u, reader.getRxFrameCount());
+    ASSERT_EQ(0x405u, reader.read().can_id);
+    ASSERT_EQ(0x40Au, reader.read().can_id);
+}
+
+TEST_F(DriverSocketTest, it_keeps_the_filters_across_reset)
+{
+    ASSERT_TRUE(reader.setFilters(vector<Filter>{ Filter(0x400, 0x7F0, true) }));
+    ASSERT_TRUE(reader.reset());
+    writer.write(makeMessage(0x405));
+    writer.write(makeMessage(0x123));
+
+    ASSERT_EQ(0x123u, reader.read().can_id);
+    ASSERT_EQ(1u, reader.getRxFrameCount());
+}
+
+TEST_F(DriverSocketTest, it_timestamps_the_frames_in_software_by_default)
+{
+    ASSERT_EQ(DriverSocket::TIMESTAMP_SOFTWARE, reader.getTimestampMode());
+    base::Time before = base::Time::now();
+    writer.write(makeMessage(0x500));
+    Message msg = reader.read();
+    ASSERT_LE(before.toMicroseconds(), msg.time.toMicroseconds());
+    ASSERT_GE(base::Time::now().toMicroseconds(), msg.time.toMicroseconds());
+    ASSERT_EQ(msg.time, msg.can_time);
+}
+
+TEST_F(DriverSocketTest, it_selects_the_timestamping_mode_from_the_path_suffix)
+{
+    DriverSocket ns;
+    ASSERT_TRUE(ns.open(iface + ":ns"));
+    ASSERT_EQ(DriverSocket::TIMESTAMP_SOFTWARE_NS, ns.getTimestampMode());
+    ns.setReadTimeout(1000);
+
+    base::Time before = base::Time::now();
+    writer.write(makeMessage(0x501));
+    Message msg = ns.read();
+    ASSERT_EQ(0x501u, msg.can_id);
+    ASSERT_LE(before.toMicroseconds(), msg.time.toMicroseconds());
+    ASSERT_GE(base::Time::now().toMicroseconds(), msg.time.toMicroseconds());
+}
+
+TEST_F(DriverSocketTest, it_falls_back_to_system_timestamps_without_hardware_ones)
+{
+    // vcan has no hardware clock, the frames get the system time in both
+    // fields
+    DriverSocket hw;
+    ASSERT_TRUE(hw.open(iface + ":hw"));
+    hw.setReadTimeout(1000);
+
+    writer.write(makeMessage(0x502));
+    Message msg = hw.read();
+    ASSERT_FALSE(msg.time.isNull());
+    ASSERT_FALSE(msg.can_time.isNull());
+}
+
+TEST_F(DriverSocketTest, it_considers_an_unknown_suffix_part_of_the_interface_name)
+{
+    DriverSocket socket;
+    ASSERT_FALSE(socket.open(iface + ":unknown"));
+    ASSERT_TRUE(socket.open(iface + ":sw"));
+}
+
+TEST_F(DriverSocketTest, can_fd_frames_are_disabled_by_default)
+{
+    ASSERT_FALSE(reader.isFDEnabled());
+    ASSERT_EQ(0, reader.getPendingFDMessagesCount());
+    MessageFD msg;
+    ASSERT_FALSE(reader.readFD(msg));
+}
+
+TEST_F(DriverSocketTest, it_exchanges_can_fd_frames_once_enabled)
+{
+    ASSERT_TRUE(writer.setFDFramesEnabled(true));
+    ASSERT_TRUE(reader.setFDFramesEnabled(true));
+    ASSERT_TRUE(reader.isFDEnabled());
+
+    MessageFD sent = MessageFD::Zeroed();
+    sent.can_id = 0x600;
+    sent.size = 64;
+    for (int i = 0; i < sent.size; ++i)
+        sent.data[i] = i;
+    sent.flags = FLAG_BIT_RATE_SWITCH;
+    try {
+        writer.writeFD(sent);
+    }
+    catch(iodrivers_base::UnixError&) {
+        GTEST_SKIP() << iface << " does not accept CAN FD frames";
+    }
+    writer.write(makeMessage(0x601));
+
+    MessageFD received;
+    ASSERT_TRUE(reader.readFD(received));
+    ASSERT_EQ(0x600u, received.can_id);
+    ASSERT_EQ(64, received.size);
+    ASSERT_EQ(FLAG_BIT_RATE_SWITCH, received.flags);
+    for (int i = 0; i < received.size; ++i)
+        ASSERT_EQ(i, received.data[i]);
+    // Classic frames are still received by read()
+    ASSERT_EQ(0x601u, reader.read().can_id);
+    ASSERT_EQ(0, reader.getPendingFDMessagesCount());
+}
+
+TEST_F(DriverSocketTest, it_keeps_the_can_fd_setting_across_open)
+{
+    DriverSocket socket;
+    ASSERT_TRUE(socket.setFDFramesEnabled(true));
+    ASSERT_FALSE(socket.isFDEnabled());
+    ASSERT_TRUE(socket.open(iface));
+    ASSERT_TRUE(socket.isFDEnabled());
+    ASSERT_TRUE(socket.setFDFramesEnabled(false));
+    ASSERT_FALSE(socket.isFDEnabled());
+}
@@ -0,0 +1,137 @@
+#include "test_VCAN.hpp"
+#include <canbus/DriverSocketMmap.hpp>
+#include <linux/can/error.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace canbus;
+using canbus::test::makeMessage;
+
+struct DriverSocketMmapTest : public canbus::test::VCANTest {
+    DriverSocketMmap reader;
+
+    void SetUp()
+    {
+        VCANTest::SetUp();
+        if (IsSkipped())
+            return;
+        // Small blocks, so that a few frames spread over several of them
+        reader.setRingSize(getpagesize(), 16);
+        if (!reader.open(iface))
+            GTEST_SKIP() << "cannot map the RX ring of " << iface;
+        reader.setReadTimeout(1000);
+    }
+
+    /** Waits for the kernel to hand over the partially filled blocks */
+    void waitForBlocks()
+    {
+        usleep(50000);
+    }
+};
+
+TEST_F(DriverSocketMmapTest, it_reads_the_frames_in_place)
+{
+    for (int i = 0; i < 10; ++i)
+        writer.write(makeMessage(0x100 + i, i % 9));
+
+    FrameView views[16];
+    size_t count = 0;
+    while (count < 10) {
+        size_t read = reader.readViews(views + count, 16 - count);
+        ASSERT_GT(read, 0u);
+        count += read;
+    }
+    ASSERT_EQ(10u, count);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_FALSE(views[i].fd);
+        ASSERT_EQ(0x100u + i, views[i].getID());
+        ASSERT_EQ(i % 9, views[i].getSize());
+        ASSERT_FALSE(views[i].time.isNull());
+    }
+}
+
+TEST_F(DriverSocketMmapTest, read_copies_the_frames_into_messages)
+{
+    Message sent = makeMessage(0x123, 5);
+    writer.write(sent);
+
+    Message msg = reader.read();
+    ASSERT_EQ(0x123u, msg.can_id);
+    ASSERT_EQ(5, msg.size);
+    for (int i = 0; i < 5; ++i)
+        ASSERT_EQ(sent.data[i], msg.data[i]);
+    ASSERT_FALSE(msg.time.isNull());
+}
+
+TEST_F(DriverSocketMmapTest, read_returns_false_on_timeout)
+{
+    reader.setReadTimeout(10);
+    Message msg;
+    ASSERT_FALSE(reader.read(msg));
+}
+
+TEST_F(DriverSocketMmapTest, it_applies_the_filters_in_user_space)
+{
+    reader.setFilters(vector<Filter>{ Filter(0x400, 0x7F0) });
+    writer.write(makeMessage(0x123));
+    writer.write(makeMessage(0x405));
+    writer.write(makeMessage(0x413));
+    writer.write(makeMessage(0x40A));
+    waitForBlocks();
+
+    ASSERT_EQ(2, reader.getPendingMessagesCount());
+    ASSERT_EQ(0x405u, reader.read().can_id);
+    ASSERT_EQ(0x40Au, reader.read().can_id);
+}
+
+TEST_F(DriverSocketMmapTest, it_reports_the_error_frames_through_checkBusOk)
+{
+    Message error = makeMessage(CAN_ERR_FLAG | CAN_ERR_BUSOFF, 8);
+    Message lostarb = makeMessage(CAN_ERR_FLAG | CAN_ERR_LOSTARB, 8);
+    writer.write(lostarb);
+    writer.write(makeMessage(0x100));
+    waitForBlocks();
+
+    // Lost arbitration is counted, but is not a bus error
+    ASSERT_EQ(0x100u, reader.read().can_id);
+    ASSERT_TRUE(reader.checkBusOk());
+    ASSERT_EQ(1u, reader.getErrorCount());
+
+    writer.write(error);
+    writer.write(makeMessage(0x101));
+    ASSERT_EQ(0x101u, reader.read().can_id);
+    ASSERT_FALSE(reader.checkBusOk());
+    ASSERT_EQ(2u, reader.getErrorCount());
+
+    reader.clear();
+    ASSERT_TRUE(reader.checkBusOk());
+}
+
+TEST_F(DriverSocketMmapTest, it_counts_the_pending_frames_across_blocks)
+{
+    for (int i = 0; i < 100; ++i)
+        writer.write(makeMessage(0x100 + i));
+    waitForBlocks();
+
+    ASSERT_EQ(100, reader.getPendingMessagesCount());
+    ASSERT_EQ(0x100u, reader.read().can_id);
+    // The rest of the held block, and the blocks after it
+    ASSERT_EQ(99, reader.getPendingMessagesCount());
+    for (int i = 1; i < 100; ++i)
+        ASSERT_EQ(0x100u + i, reader.read().can_id);
+    ASSERT_EQ(0, reader.getPendingMessagesCount());
+}
+
+TEST_F(DriverSocketMmapTest, clear_releases_the_held_block)
+{
+    for (int i = 0; i < 10; ++i)
+        writer.write(makeMessage(0x100 + i));
+    waitForBlocks();
+    ASSERT_EQ(0x100u, reader.read().can_id);
+
+    reader.clear();
+    ASSERT_EQ(0, reader.getPendingMessagesCount());
+
+    writer.write(makeMessage(0x200));
+    ASSERT_EQ(0x200u, reader.read().can_id);
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include <canbus/Filter.hpp>
+
+using namespace std;
+using namespace canbus;
+
+struct FilterTest : public ::testing::Test {
+};
+
+TEST_F(FilterTest, an_empty_set_accepts_all_messages)
+{
+    FilterSet filters;
+    ASSERT_TRUE(filters.accepts(0x0));
+    ASSERT_TRUE(filters.accepts(0x7FF));
+    ASSERT_TRUE(filters.accepts(0x1FFFFFFF));
+}
+
+TEST_F(FilterTest, it_accepts_the_IDs_that_match_id_and_mask)
+{
+    vector<Filter> list;
+    list.push_back(Filter(0x120, 0x7F0));
+    FilterSet filters(list);
+    ASSERT_TRUE(filters.accepts(0x120));
+    ASSERT_TRUE(filters.accepts(0x12F));
+    ASSERT_FALSE(filters.accepts(0x130));
+    ASSERT_FALSE(filters.accepts(0x20));
+}
+
+TEST_F(FilterTest, it_accepts_the_IDs_that_match_any_of_the_filters)
+{
+    vector<Filter> list;
+    list.push_back(Filter(0x100, 0x7FF));
+    list.push_back(Filter(0x18FF0000, 0x1FFF0000));
+    FilterSet filters(list);
+    ASSERT_TRUE(filters.accepts(0x100));
+    ASSERT_TRUE(filters.accepts(0x18FF1234));
+    ASSERT_FALSE(filters.accepts(0x101));
+    ASSERT_FALSE(filters.accepts(0x18FE1234));
+}
+
+TEST_F(FilterTest, an_inverted_filter_accepts_the_IDs_that_do_not_match)
+{
+    vector<Filter> list;
+    list.push_back(Filter(0x100, 0x7FF, true));
+    FilterSet filters(list);
+    ASSERT_FALSE(filters.accepts(0x100));
+    ASSERT_TRUE(filters.accepts(0x101));
+    ASSERT_TRUE(filters.accepts(0x18FF1234));
+}
@@ -4,5 +4,45 @@
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 #include <iodrivers_base/FixtureGTest.hpp>
+#include <canbus/Message.hpp>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+
+namespace canbus
+{
+    namespace test
+    {
+        /** A message whose payload bytes are can_id + i */
+        inline Message makeMessage(uint32_t can_id, uint8_t size = 8)
+        {
+            Message msg = Message::Zeroed();
+            msg.can_id = can_id;
+            msg.size = size;
+            for (int i = 0; i < size; ++i)
+                msg.data[i] = can_id + i;
+            return msg;
+        }
+
+        /** A temporary file, removed on destruction */
+        struct TemporaryFile
+        {
+            std::string path;
+
+            TemporaryFile()
+            {
+                char tmpl[] = "/tmp/canbus-test-XXXXXX";
+                int fd = mkstemp(tmpl);
+                ::close(fd);
+                path = tmpl;
+            }
+
+            ~TemporaryFile()
+            {
+                unlink(path.c_str());
+            }
+        };
+    }
+}
 
 #endif
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <canbus/Hex.hpp>
+#include <string>
+#include <string.h>
+
+using namespace std;
+using namespace canbus;
+
+struct HexTest : public ::testing::Test {
+    uint8_t const* bytes(string const& str) {
+        return reinterpret_cast<uint8_t const*>(str.c_str());
+    }
+};
+
+TEST_F(HexTest, it_decodes_uppercase_hex_digits)
+{
+    uint8_t output[8];
+    ASSERT_TRUE(hex::decode(output, bytes("0123456789ABCDEF"), 8));
+    uint8_t expected[8] = { 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF };
+    ASSERT_EQ(0, memcmp(expected, output, 8));
+}
+
+TEST_F(HexTest, it_rejects_non_hex_characters)
+{
+    uint8_t output[8];
+    ASSERT_FALSE(hex::decode(output, bytes("0123456789abcdef"), 8));
+    ASSERT_FALSE(hex::decode(output, bytes("01@3"), 2));
+    ASSERT_FALSE(hex::decode(output, bytes("01G3"), 2));
+    ASSERT_FALSE(hex::decode(output, bytes("01:3"), 2));
+}
+
+TEST_F(HexTest, it_matches_the_scalar_implementation_for_all_characters_at_all_positions)
+{
+    // Covers the vector code, its overlapping tail and the scalar fallback
+    for (int size = 1; size <= 40; ++size)
+    {
+        for (int pos = 0; pos < size; ++pos)
+        {
+            for (int c = 0; c < 256; ++c)
+            {
+                uint8_t input[40];
+                for (int i = 0; i < size; ++i)
+                    input[i] = "0123456789ABCDEF"[(i * 7) % 16];
+                input[pos] = c;
+
+                uint8_t expected[40], actual[40];
+                int expected_valid = hex::scalar::toNibbles(expected, input, size);
+                int actual_valid = hex::toNibbles(actual, input, size);
+                ASSERT_EQ(expected_valid, actual_valid) << "size=" << size << " pos=" << pos << " c=" << c;
+                ASSERT_EQ(actual_valid, hex::findInvalid(input, size));
+                ASSERT_EQ(0, memcmp(expected, actual, expected_valid));
+            }
+        }
+    }
+}
+
+TEST_F(HexTest, it_packs_nibbles_like_the_scalar_implementation)
+{
+    uint8_t nibbles[48];
+    for (int i = 0; i < 48; ++i)
+        nibbles[i] = (i * 5) & 0xF;
+
+    for (int size = 1; size <= 24; ++size)
+    {
+        uint8_t expected[24], actual[24];
+        hex::scalar::packNibbles(expected, nibbles, size);
+        hex::packNibbles(actual, nibbles, size);
+        ASSERT_EQ(0, memcmp(expected, actual, size)) << "size=" << size;
+    }
+}
+
+TEST_F(HexTest, it_encodes_all_byte_values_and_decodes_them_back)
+{
+    uint8_t input[256];
+    for (int i = 0; i < 256; ++i)
+        input[i] = i;
+
+    uint8_t encoded[512];
+    ASSERT_EQ(encoded + 512, hex::encode(encoded, input, 256));
+    ASSERT_EQ("00", string(reinterpret_cast<char*>(encoded), 2));
+    ASSERT_EQ("A5", string(reinterpret_cast<char*>(encoded) + 0xA5 * 2, 2));
+    ASSERT_EQ("FF", string(reinterpret_cast<char*>(encoded) + 510, 2));
+
+    uint8_t decoded[256];
+    ASSERT_TRUE(hex::decode(decoded, encoded, 256));
+    ASSERT_EQ(0, memcmp(input, decoded, 256));
+}
@@ -0,0 +1,176 @@
+#include "test_Helpers.hpp"
+#include <canbus/LogFile.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <signal.h>
+#include <string.h>
+#include <sys/resource.h>
+
+using namespace std;
+using namespace canbus;
+
+struct LogFileTest : public ::testing::Test {
+    test::TemporaryFile log;
+
+    /** The i-th message of the test logs */
+    static Message makeRecord(int i) {
+        Message msg = test::makeMessage(i & 0x7FF, i % 9);
+        msg.time = base::Time::fromMicroseconds(1000 + i * 10);
+        msg.can_time = base::Time::fromMicroseconds(2000 + i * 10);
+        return msg;
+    }
+
+    void writeMessages(LogWriter& writer, int first, int count) {
+        for (int i = first; i < first + count; ++i)
+            writer.write(makeRecord(i));
+    }
+};
+
+TEST_F(LogFileTest, it_reads_back_the_written_messages)
+{
+    LogWriter writer(4);
+    ASSERT_TRUE(writer.open(log.path));
+    writeMessages(writer, 0, 1000);
+    writer.close();
+
+    LogReader reader;
+    ASSERT_TRUE(reader.open(log.path));
+    Message msg;
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(reader.read(msg));
+        Message expected = makeRecord(i);
+        ASSERT_EQ(expected.time, msg.time);
+        ASSERT_EQ(expected.can_time, msg.can_time);
+        ASSERT_EQ(expected.can_id, msg.can_id);
+        ASSERT_EQ(expected.size, msg.size);
+        for (int b = 0; b < 8; ++b)
+            ASSERT_EQ(expected.data[b], msg.data[b]);
+    }
+    ASSERT_FALSE(reader.read(msg));
+}
+
+TEST_F(LogFileTest, it_indexes_the_blocks)
+{
+    LogWriter writer(4);
+    ASSERT_TRUE(writer.open(log.path));
+    writeMessages(writer, 0, LOG_RECORDS_PER_BLOCK * 2 + 1);
+    writer.close();
+
+    LogReader reader;
+    ASSERT_TRUE(reader.open(log.path));
+    ASSERT_EQ(3, reader.getBlockCount());
+    for (size_t i = 0; i < 3; ++i) {
+        LogBlockHeader const& header = reader.getBlockHeader(i);
+        ASSERT_EQ(LOG_BLOCK_MAGIC, header.magic);
+        ASSERT_EQ(i, header.index);
+        ASSERT_EQ(1000 + i * LOG_RECORDS_PER_BLOCK * 10, header.first_time);
+    }
+    ASSERT_EQ(LOG_RECORDS_PER_BLOCK, reader.getBlockHeader(0).count);
+    ASSERT_EQ(1, reader.getBlockHeader(2).count);
+}
+
+TEST_F(LogFileTest, flush_writes_partial_blocks_and_starts_a_new_one)
+{
+    LogWriter writer(4);
+    ASSERT_TRUE(writer.open(log.path));
+    writeMessages(writer, 0, 10);
+    writer.flush();
+    writer.flush();
+    writeMessages(writer, 10, 10);
+    writer.close();
+
+    LogReader reader;
+    ASSERT_TRUE(reader.open(log.path));
+    ASSERT_EQ(2, reader.getBlockCount());
+    ASSERT_EQ(0, reader.getBlockHeader(0).index);
+    ASSERT_EQ(1, reader.getBlockHeader(1).index);
+    Message msg;
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(reader.read(msg));
+        ASSERT_EQ(makeRecord(i).time, msg.time);
+    }
+    ASSERT_FALSE(reader.read(msg));
+}
+
+TEST_F(LogFileTest, it_seeks_to_the_first_record_at_or_after_a_time)
+{
+    LogWriter writer(2);
+    ASSERT_TRUE(writer.open(log.path));
+    writeMessages(writer, 0, 1000);
+    writer.close();
+
+    LogReader reader;
+    ASSERT_TRUE(reader.open(log.path));
+    reader.seek(base::Time::fromMicroseconds(1000 + 500 * 10 - 5));
+    Message msg;
+    ASSERT_TRUE(reader.read(msg));
+    ASSERT_EQ(makeRecord(500).time, msg.time);
+
+    reader.seek(base::Time::fromMicroseconds(1000000));
+    ASSERT_FALSE(reader.read(msg));
+}
+
+TEST_F(LogFileTest, it_rejects_files_that_are_not_logs)
+{
+    FILE* file = fopen(log.path.c_str(), "w");
+    for (int i = 0; i < 8192; ++i)
+        fputc('x', file);
+    fclose(file);
+
+    LogReader reader;
+    ASSERT_FALSE(reader.open(log.path));
+}
+
+/** Limits the size of the files the process writes, for the lifetime of
+ * the object. Writes past the limit fail with EFBIG instead of raising
+ * SIGXFSZ
+ */
+struct FileSizeLimit
+{
+    struct rlimit saved_limit;
+    struct sigaction saved_action;
+
+    explicit FileSizeLimit(rlim_t size)
+    {
+        struct sigaction ignore;
+        memset(&ignore, 0, sizeof(ignore));
+        ignore.sa_handler = SIG_IGN;
+        sigaction(SIGXFSZ, &ignore, &saved_action);
+
+        getrlimit(RLIMIT_FSIZE, &saved_limit);
+        struct rlimit limit = saved_limit;
+        limit.rlim_cur = size;
+        setrlimit(RLIMIT_FSIZE, &limit);
+    }
+
+    ~FileSizeLimit()
+    {
+        setrlimit(RLIMIT_FSIZE, &saved_limit);
+        sigaction(SIGXFSZ, &saved_action, NULL);
+    }
+};
+
+TEST_F(LogFileTest, it_keeps_working_after_a_failed_write)
+{
+    LogWriter writer(1);
+    ASSERT_TRUE(writer.open(log.path));
+    {
+        // Only room for the file header
+        FileSizeLimit limit(LOG_BLOCK_SIZE);
+        ASSERT_THROW(writeMessages(writer, 0, LOG_RECORDS_PER_BLOCK),
+                     iodrivers_base::UnixError);
+        ASSERT_THROW(writeMessages(writer, 0, LOG_RECORDS_PER_BLOCK),
+                     iodrivers_base::UnixError);
+    }
+
+    writeMessages(writer, 0, 10);
+    writer.close();
+
+    LogReader reader;
+    ASSERT_TRUE(reader.open(log.path));
+    Message msg;
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(reader.read(msg));
+        ASSERT_EQ(makeRecord(i).can_id, msg.can_id);
+    }
+    ASSERT_FALSE(reader.read(msg));
+}
@@ -18,3 +18,16 @@ TEST_F(MessageTest, it_produces_a_zeroed_message)
         ASSERT_EQ(0, msg.data[i]);
     }
 }
+
+TEST_F(MessageTest, it_produces_a_zeroed_fd_message)
+{
+    auto msg = MessageFD::Zeroed();
+    ASSERT_TRUE(msg.time.isNull());
+    ASSERT_TRUE(msg.can_time.isNull());
+    ASSERT_EQ(0, msg.can_id);
+    ASSERT_EQ(0, msg.size);
+    ASSERT_EQ(0, msg.flags);
+    for (int i = 0; i < MessageFD::MAX_SIZE; ++i) {
+        ASSERT_EQ(0, msg.data[i]);
+    }
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <canbus/Reactor.hpp>
+#include <canbus/DriverLoopback.hpp>
+#include <deque>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace canbus;
+
+/** Driver whose file descriptor is the read side of a pipe, readable when
+ * messages have been pushed
+ */
+struct PipeDriver : public Driver
+{
+    int fds[2];
+    deque<Message> queue;
+
+    PipeDriver() {
+        if (pipe2(fds, O_NONBLOCK) != 0)
+            throw std::runtime_error("cannot create pipe");
+    }
+    ~PipeDriver() {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    void push(uint32_t can_id) {
+        Message msg = Message::Zeroed();
+        msg.can_id = can_id;
+        queue.push_back(msg);
+        char byte = 0;
+        if (::write(fds[1], &byte, 1) != 1)
+            throw std::runtime_error("cannot write to pipe");
+    }
+
+    bool open(std::string const&) { return true; }
+    bool resetBoard() { return true; }
+    bool reset() { return true; }
+    void setWriteTimeout(uint32_t) {}
+    uint32_t getWriteTimeout() const { return 0; }
+    void setReadTimeout(uint32_t) {}
+    uint32_t getReadTimeout() const { return 0; }
+    Message read() {
+        Message msg = queue.front();
+        queue.pop_front();
+        return msg;
+    }
+    void write(Message const&) {}
+    int getPendingMessagesCount() {
+        char buffer[256];
+        while (::read(fds[0], buffer, sizeof(buffer)) > 0) {}
+        return queue.size();
+    }
+    bool checkBusOk() { return true; }
+    void clear() { queue.clear(); }
+    int getFileDescriptor() const { return fds[0]; }
+    bool isValid() const { return true; }
+    void close() {}
+};
+
+struct ReactorTest : public ::testing::Test {
+    Reactor reactor;
+    vector<pair<int, uint32_t>> received;
+
+    Reactor::Callback recorder() {
+        return [this](int bus, Message const& msg) {
+            received.push_back(make_pair(bus, msg.can_id));
+        };
+    }
+};
+
+TEST_F(ReactorTest, it_dispatches_the_messages_to_the_bus_callbacks)
+{
+    PipeDriver a, b;
+    int bus_a = reactor.addBus(a, recorder());
+    int bus_b = reactor.addBus(b, recorder());
+    a.push(0x10);
+    b.push(0x20);
+    a.push(0x11);
+
+    ASSERT_EQ(3, reactor.runOnce(0));
+    ASSERT_EQ(3, received.size());
+    ASSERT_EQ(make_pair(bus_a, 0x10u), received[0]);
+    ASSERT_EQ(make_pair(bus_a, 0x11u), received[1]);
+    ASSERT_EQ(make_pair(bus_b, 0x20u), received[2]);
+}
+
+TEST_F(ReactorTest, it_dispatches_the_messages_to_the_ID_subscribers)
+{
+    PipeDriver a, b;
+    reactor.addBus(a);
+    int bus_b = reactor.addBus(b);
+    int any_count = 0;
+    reactor.subscribe(0x10, [&any_count](int, Message const&) { ++any_count; });
+    reactor.subscribe(0x10, recorder(), bus_b);
+
+    a.push(0x10);
+    b.push(0x10);
+    a.push(0x20);
+    reactor.runOnce(0);
+
+    ASSERT_EQ(2, any_count);
+    ASSERT_EQ(1, received.size());
+    ASSERT_EQ(make_pair(bus_b, 0x10u), received[0]);
+
+    reactor.unsubscribe(0x10);
+    b.push(0x10);
+    reactor.runOnce(0);
+    ASSERT_EQ(2, any_count);
+    ASSERT_EQ(2, received.size());
+}
+
+TEST_F(ReactorTest, it_services_the_other_buses_when_one_runs_out_of_budget)
+{
+    PipeDriver a, b;
+    reactor.setBudget(4);
+    int bus_a = reactor.addBus(a, recorder());
+    int bus_b = reactor.addBus(b, recorder());
+    for (int i = 0; i < 10; ++i)
+        a.push(i);
+    b.push(0x20);
+
+    ASSERT_EQ(5, reactor.runOnce(0));
+    ASSERT_EQ(make_pair(bus_b, 0x20u), received.back());
+    ASSERT_EQ(4, reactor.runOnce(0));
+    ASSERT_EQ(2, reactor.runOnce(0));
+    ASSERT_EQ(0, reactor.runOnce(0));
+    ASSERT_EQ(11, received.size());
+    ASSERT_EQ(make_pair(bus_a, 9u), received.back());
+}
+
+TEST_F(ReactorTest, it_stops_dispatching_the_messages_of_a_removed_bus)
+{
+    PipeDriver a;
+    int bus = reactor.addBus(a, recorder());
+    reactor.removeBus(bus);
+    a.push(0x10);
+    ASSERT_EQ(0, reactor.runOnce(0));
+    ASSERT_TRUE(received.empty());
+}
+
+TEST_F(ReactorTest, run_returns_when_stop_is_called)
+{
+    PipeDriver a;
+    reactor.addBus(a, [this](int, Message const&) { reactor.stop(); });
+    a.push(0x10);
+    reactor.run();
+
+    std::thread stopper([this]() { reactor.stop(); });
+    reactor.run();
+    stopper.join();
+}
+
+TEST_F(ReactorTest, it_rejects_drivers_without_file_descriptor)
+{
+    DriverLoopback driver;
+    ASSERT_TRUE(driver.open("test_reactor"));
+    ASSERT_THROW(reactor.addBus(driver), std::invalid_argument);
+}
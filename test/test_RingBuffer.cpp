@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <canbus/RingBuffer.hpp>
+#include <thread>
+
+using namespace std;
+using namespace canbus;
+
+struct RingBufferTest : public ::testing::Test {
+};
+
+TEST_F(RingBufferTest, it_returns_the_elements_in_order)
+{
+    RingBuffer<int> queue(4);
+    for (int i = 0; i < 3; ++i)
+        ASSERT_TRUE(queue.push(i));
+    ASSERT_EQ(3, queue.size());
+
+    int value;
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(queue.pop(value));
+        ASSERT_EQ(i, value);
+    }
+    ASSERT_FALSE(queue.pop(value));
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST_F(RingBufferTest, it_drops_the_oldest_elements_on_overflow)
+{
+    RingBuffer<int> queue(3, RingBuffer<int>::DROP_OLDEST);
+    for (int i = 0; i < 5; ++i)
+        ASSERT_TRUE(queue.push(i));
+    ASSERT_EQ(3, queue.size());
+    ASSERT_EQ(2, queue.getDroppedCount());
+
+    int value;
+    for (int i = 2; i < 5; ++i) {
+        ASSERT_TRUE(queue.pop(value));
+        ASSERT_EQ(i, value);
+    }
+}
+
+TEST_F(RingBufferTest, it_drops_the_newest_elements_on_overflow)
+{
+    RingBuffer<int> queue(3, RingBuffer<int>::DROP_NEWEST);
+    for (int i = 0; i < 3; ++i)
+        ASSERT_TRUE(queue.push(i));
+    ASSERT_FALSE(queue.push(3));
+    ASSERT_FALSE(queue.push(4));
+    ASSERT_EQ(2, queue.getDroppedCount());
+
+    int value;
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(queue.pop(value));
+        ASSERT_EQ(i, value);
+    }
+}
+
+TEST_F(RingBufferTest, clear_removes_all_elements)
+{
+    RingBuffer<int> queue(3);
+    queue.push(0);
+    queue.push(1);
+    queue.clear();
+    int value;
+    ASSERT_FALSE(queue.pop(value));
+    ASSERT_EQ(0, queue.getDroppedCount());
+}
+
+TEST_F(RingBufferTest, it_hands_elements_over_between_two_threads)
+{
+    const int count = 100000;
+    RingBuffer<int> queue(64, RingBuffer<int>::DROP_NEWEST);
+    std::thread producer([&queue, count]() {
+        for (int i = 0; i < count; ++i) {
+            while (!queue.push(i))
+                std::this_thread::yield();
+        }
+    });
+
+    int expected = 0;
+    while (expected < count) {
+        int value;
+        if (queue.pop(value)) {
+            ASSERT_EQ(expected, value);
+            ++expected;
+        }
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+}
+
+TEST_F(RingBufferTest, a_consumer_never_sees_a_dropped_element_out_of_order)
+{
+    const int count = 100000;
+    RingBuffer<int> queue(16, RingBuffer<int>::DROP_OLDEST);
+    std::thread producer([&queue, count]() {
+        for (int i = 0; i < count; ++i)
+            queue.push(i);
+        queue.push(-1);
+    });
+
+    int last = -1;
+    while (true) {
+        int value;
+        if (!queue.pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (value == -1)
+            break;
+        ASSERT_GT(value, last);
+        last = value;
+    }
+    producer.join();
+}
+
+TEST_F(RingBufferTest, a_consumer_never_sees_a_partially_overwritten_element)
+{
+    struct Element { int values[16]; };
+    const int count = 100000;
+    RingBuffer<Element> queue(4, RingBuffer<Element>::DROP_OLDEST);
+    std::thread producer([&queue, count]() {
+        for (int i = 0; i <= count; ++i) {
+            Element element;
+            for (int& value : element.values)
+                value = i;
+            // the last element must get through for the consumer to stop
+            while (!queue.push(element) && i == count)
+                std::this_thread::yield();
+        }
+    });
+
+    Element element = Element();
+    do {
+        if (!queue.pop(element)) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (int value : element.values)
+            ASSERT_EQ(element.values[0], value);
+    }
+    while (element.values[0] != count);
+    producer.join();
+}
+
+TEST_F(RingBufferTest, the_default_capacity_fills_a_power_of_two_slot_count)
+{
+    RingBuffer<int> queue;
+    ASSERT_EQ(4095, queue.capacity());
+    for (int i = 0; i < 4095; ++i)
+        queue.push(i);
+    ASSERT_EQ(0, queue.getDroppedCount());
+    queue.push(4095);
+    ASSERT_EQ(1, queue.getDroppedCount());
+}
@@ -0,0 +1,165 @@
+#include "test_Helpers.hpp"
+#include <canbus/TxScheduler.hpp>
+#include <iodrivers_base/Driver.hpp>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace canbus;
+using canbus::test::makeMessage;
+
+/** Driver recording the batches it is given */
+struct RecordingDriver : public Driver
+{
+    vector<vector<Message>> batches;
+    vector<base::Time> times;
+    size_t max_written = 1000;
+
+    bool open(std::string const&) { return true; }
+    bool resetBoard() { return true; }
+    bool reset() { return true; }
+    void setWriteTimeout(uint32_t) {}
+    uint32_t getWriteTimeout() const { return 0; }
+    void setReadTimeout(uint32_t) {}
+    uint32_t getReadTimeout() const { return 0; }
+    Message read() { return Message::Zeroed(); }
+    void write(Message const& msg) { writeBatch(&msg, 1); }
+    size_t writeBatch(Message const* msgs, size_t count) {
+        count = std::min(count, max_written);
+        batches.push_back(vector<Message>(msgs, msgs + count));
+        times.push_back(base::Time::now());
+        return count;
+    }
+    int getPendingMessagesCount() { return 0; }
+    bool checkBusOk() { return true; }
+    void clear() {}
+    int getFileDescriptor() const { return iodrivers_base::Driver::INVALID_FD; }
+    bool isValid() const { return true; }
+    void close() {}
+};
+
+struct TxSchedulerTest : public ::testing::Test {
+    RecordingDriver* driver;
+    TxScheduler scheduler;
+
+    TxSchedulerTest()
+        : driver(new RecordingDriver)
+        , scheduler(driver) {}
+};
+
+TEST_F(TxSchedulerTest, it_sends_a_frame_count_times_at_its_period)
+{
+    base::Time period = base::Time::fromMilliseconds(5);
+    base::Time start = base::Time::now();
+    int handle = scheduler.add(makeMessage(0x10), period, period,
+            TxScheduler::UpdateCallback(), 5);
+    scheduler.run();
+
+    ASSERT_TRUE(scheduler.empty());
+    ASSERT_EQ(5, driver->batches.size());
+    // Each occurrence is sent at most a tick early, the upper bound leaves
+    // room for the scheduling latency
+    base::Time tick = base::Time::fromMicroseconds(scheduler.getTick());
+    for (size_t i = 0; i < driver->times.size(); ++i)
+    {
+        base::Time due = start + period * (i + 1);
+        ASSERT_GE(driver->times[i], due - tick);
+        ASSERT_LT(driver->times[i], due + base::Time::fromMilliseconds(10));
+    }
+    ASSERT_EQ(5, scheduler.getStatistics(handle).sent);
+}
+
+TEST_F(TxSchedulerTest, it_sends_the_frames_due_in_the_same_tick_in_one_batch)
+{
+    base::Time period = base::Time::fromMilliseconds(5);
+    scheduler.add(makeMessage(0x30), period, base::Time(), TxScheduler::UpdateCallback(), 2);
+    scheduler.add(makeMessage(0x20), period, period, TxScheduler::UpdateCallback(), 2);
+    scheduler.add(makeMessage(0x10), period, period, TxScheduler::UpdateCallback(), 2);
+    scheduler.run();
+
+    ASSERT_EQ(3, driver->batches.size());
+    ASSERT_EQ(1, driver->batches[0].size());
+    ASSERT_EQ(0x30, driver->batches[0][0].can_id);
+    ASSERT_EQ(3, driver->batches[1].size());
+    ASSERT_EQ(0x30, driver->batches[1][0].can_id);
+    ASSERT_EQ(0x20, driver->batches[1][1].can_id);
+    ASSERT_EQ(0x10, driver->batches[1][2].can_id);
+    ASSERT_EQ(2, driver->batches[2].size());
+}
+
+TEST_F(TxSchedulerTest, it_calls_the_update_callback_before_each_transmission)
+{
+    int counter = 0;
+    scheduler.add(makeMessage(0x10), base::Time::fromMilliseconds(1), base::Time(),
+            [&counter](Message& msg) { msg.data[0] = counter++; }, 3);
+    scheduler.run();
+
+    ASSERT_EQ(3, driver->batches.size());
+    for (int i = 0; i < 3; ++i)
+        ASSERT_EQ(i, driver->batches[i][0].data[0]);
+}
+
+TEST_F(TxSchedulerTest, it_skips_the_occurrences_missed_while_late)
+{
+    base::Time period = base::Time::fromMilliseconds(2);
+    int handle = scheduler.add(makeMessage(0x10), period, period);
+    usleep(11000);
+    ASSERT_EQ(1, scheduler.runOnce());
+
+    TxScheduler::Statistics stats = scheduler.getStatistics(handle);
+    ASSERT_EQ(1, stats.sent);
+    ASSERT_LE(4, stats.missed);
+    ASSERT_GE(stats.jitter_min, base::Time::fromMilliseconds(1));
+    ASSERT_EQ(stats.jitter_min, stats.jitter_max);
+}
+
+TEST_F(TxSchedulerTest, it_sends_a_frame_once_per_batch_if_its_period_is_shorter_than_the_tick)
+{
+    scheduler.setTick(5000);
+    int handle = scheduler.add(makeMessage(0x10), base::Time::fromMilliseconds(1));
+    ASSERT_EQ(1, scheduler.runOnce());
+    ASSERT_EQ(1, driver->batches.size());
+    ASSERT_EQ(1, driver->batches[0].size());
+    ASSERT_LE(4, scheduler.getStatistics(handle).missed);
+}
+
+TEST_F(TxSchedulerTest, it_counts_the_frames_the_driver_did_not_write_as_failed)
+{
+    driver->max_written = 1;
+    base::Time period = base::Time::fromMilliseconds(2);
+    int first = scheduler.add(makeMessage(0x10), period);
+    int second = scheduler.add(makeMessage(0x20), period);
+    ASSERT_EQ(1, scheduler.runOnce());
+    ASSERT_EQ(1, scheduler.getStatistics(first).sent);
+    ASSERT_EQ(1, scheduler.getStatistics(second).failed);
+    ASSERT_EQ(1, scheduler.getStatistics().failed);
+}
+
+TEST_F(TxSchedulerTest, it_stops_sending_removed_frames)
+{
+    base::Time period = base::Time::fromMilliseconds(1);
+    int handle = scheduler.add(makeMessage(0x10), period);
+    scheduler.add(makeMessage(0x20), period, base::Time(), TxScheduler::UpdateCallback(), 3);
+    scheduler.remove(handle);
+    scheduler.run();
+    for (auto const& batch : driver->batches)
+        ASSERT_EQ(0x20, batch.at(0).can_id);
+}
+
+TEST_F(TxSchedulerTest, run_returns_when_stop_is_called)
+{
+    scheduler.add(makeMessage(0x10), base::Time::fromMilliseconds(1));
+    std::thread stopper([this]() {
+        usleep(10000);
+        scheduler.stop();
+    });
+    scheduler.run();
+    stopper.join();
+    ASSERT_FALSE(scheduler.empty());
+    ASSERT_LT(0, driver->batches.size());
+}
+
+TEST_F(TxSchedulerTest, it_rejects_a_null_period)
+{
+    ASSERT_THROW(scheduler.add(makeMessage(0x10), base::Time()), std::invalid_argument);
+}
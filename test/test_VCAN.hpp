@@ -0,0 +1,44 @@
+#ifndef CANBUS_TEST_VCAN_HPP
+#define CANBUS_TEST_VCAN_HPP
+
+#include "test_Helpers.hpp"
+#include <canbus/DriverSocket.hpp>
+#include <stdlib.h>
+#include <string>
+
+namespace canbus
+{
+    namespace test
+    {
+        /** Base fixture of the tests that need a virtual CAN interface,
+         * which they find in the CANBUS_TEST_VCAN environment variable
+         * (vcan0 by default):
+         *
+         *   ip link add dev vcan0 type vcan && ip link set up vcan0
+         *
+         * The tests are skipped if it cannot be opened. Derived fixtures
+         * must return from their SetUp when IsSkipped() is true.
+         */
+        struct VCANTest : public ::testing::Test
+        {
+            std::string iface;
+            /** A socket on the interface, to send the test frames */
+            DriverSocket writer;
+
+            VCANTest()
+            {
+                char const* name = getenv("CANBUS_TEST_VCAN");
+                iface = name ? name : "vcan0";
+            }
+
+            void SetUp()
+            {
+                if (!writer.open(iface))
+                    GTEST_SKIP() << "cannot open " << iface << ", set CANBUS_TEST_VCAN";
+                writer.setWriteTimeout(1000);
+            }
+        };
+    }
+}
+
+#endif